@@ -0,0 +1,424 @@
+/** @file
+ * Test obciążeniowy współbieżnych zapytań do struktury PhoneForward.
+ *
+ * Program włącza współbieżne zapytania (@ref phfwdEnableConcurrentReads)
+ * i uruchamia kilka wątków czytelników, które bez przerwy wykonują
+ * zapytania, podczas gdy jeden pisarz dodaje i usuwa przekierowania,
+ * zwalnia odłączone poddrzewa, zamraża strukturę i wykonuje transakcje.
+ * Czytelnicy sprawdzają własności wyników niezależne od równoczesnych
+ * modyfikacji (np. to, że wynik @ref phfwdReverse jest posortowany
+ * i zawiera numer, o który pytano). Pisarz powtarza każdą modyfikację na
+ * drugiej strukturze, bez współbieżnych zapytań, a na końcu program
+ * porównuje wyniki zapytań do obu struktur. Dodawanie wielu przekierowań
+ * naraz i wycofywanie transakcji trwają na tyle długo, że czytelnicy
+ * proszą pisarza o pierwszeństwo, więc program sprawdza również
+ * przerywanie długich modyfikacji.
+ *
+ * Numery składają się z kilku cyfr 0–2, więc modyfikacje często dotyczą
+ * węzłów, które czytelnicy właśnie odwiedzają. Program należy skompilować
+ * (z katalogiem @p src na ścieżce plików nagłówkowych) razem z plikami
+ * źródłowymi biblioteki i opcją @p -fsanitize=thread, która wykrywa
+ * wyścigi w dostępie do pamięci:
+ *
+ *     ./concurrent_stress [liczba modyfikacji] [liczba czytelników] [ziarno]
+ *
+ * Program kończy się kodem 0, jeśli nie wykrył błędu.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "phone_forward.h"
+
+/** Domyślna liczba modyfikacji wykonywanych przez pisarza. */
+#define DEFAULT_OPERATION_COUNT 50000
+
+/** Domyślna liczba wątków czytelników. */
+#define DEFAULT_READER_COUNT 4
+
+/** Największa liczba wątków czytelników. */
+#define MAX_READER_COUNT 64
+
+/** Maksymalna długość numeru modyfikowanego przez pisarza. */
+#define MAX_RULE_LENGTH 4
+
+/** Maksymalna długość numeru, o który pytają czytelnicy. */
+#define MAX_QUERY_LENGTH 7
+
+/**
+ * Liczba numerów, o które pytają czytelnicy w jednym wywołaniu
+ * @ref phfwdGetBatch.
+ */
+#define BATCH_SIZE 3
+
+/**
+ * Liczba par numerów dodawanych przez pisarza w jednym wywołaniu
+ * @ref phfwdAddBulk.
+ */
+#define BULK_SIZE 64
+
+/**
+ * Stan wątku czytelnika.
+ */
+typedef struct Reader {
+    pthread_t thread; ///< wątek czytelnika
+    PhoneForward const *pf; ///< struktura, do której czytelnik wysyła zapytania
+    atomic_bool const *stop; ///< czy czytelnik ma zakończyć pracę
+    uint64_t state; ///< stan generatora liczb pseudolosowych
+    size_t queries; ///< liczba wykonanych zapytań
+    bool failed; ///< czy czytelnik otrzymał niepoprawny wynik
+} Reader;
+
+/**
+ * Wyznacza kolejną wartość generatora liczb pseudolosowych (xorshift64).
+ * @param[in, out] state – wskaźnik na stan generatora.
+ * @return Wylosowana wartość.
+ */
+static uint64_t nextRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * Losuje numer złożony z cyfr 0–2.
+ * @param[in, out] state – wskaźnik na stan generatora;
+ * @param[out] num       – bufor o rozmiarze co najmniej @p maxLength + 1;
+ * @param[in] maxLength  – maksymalna długość numeru.
+ */
+static void randomNumber(uint64_t *state, char *num, size_t maxLength) {
+    size_t length = 1 + nextRandom(state) % maxLength;
+
+    for (size_t i = 0; i < length; ++i)
+        num[i] = (char) ('0' + nextRandom(state) % 3);
+    num[length] = '\0';
+}
+
+/**
+ * Wyznacza liczbę numerów ciągu.
+ * @param[in] pnum – wskaźnik na ciąg numerów.
+ * @return Liczba numerów ciągu.
+ */
+static size_t numbersLength(PhoneNumbers const *pnum) {
+    size_t length = 0;
+
+    while (phnumGet(pnum, length) != NULL)
+        ++length;
+
+    return length;
+}
+
+/**
+ * Sprawdza, czy ciąg numerów jest posortowany ściśle rosnąco (numery
+ * składają się z cyfr, więc wystarcza porównanie napisów).
+ * @param[in] pnum – wskaźnik na ciąg numerów.
+ * @return Wartość @p true, jeśli ciąg jest posortowany i nie ma powtórzeń.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool isSorted(PhoneNumbers const *pnum) {
+    for (size_t k = 1; phnumGet(pnum, k) != NULL; ++k)
+        if (strcmp(phnumGet(pnum, k - 1), phnumGet(pnum, k)) >= 0)
+            return false;
+
+    return true;
+}
+
+/**
+ * Sprawdza, czy ciąg numerów zawiera numer.
+ * @param[in] pnum – wskaźnik na ciąg numerów;
+ * @param[in] num  – wskaźnik na napis reprezentujący numer.
+ * @return Wartość @p true, jeśli ciąg zawiera @p num.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool contains(PhoneNumbers const *pnum, char const *num) {
+    for (size_t k = 0; phnumGet(pnum, k) != NULL; ++k)
+        if (strcmp(phnumGet(pnum, k), num) == 0)
+            return true;
+
+    return false;
+}
+
+/**
+ * Wykonuje jedną serię zapytań o numer i sprawdza ich wyniki.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wartość @p true, jeśli wyniki są poprawne.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool queryNumber(PhoneForward const *pf, char const *num) {
+    bool correct = true;
+    char buffer[MAX_RULE_LENGTH + MAX_QUERY_LENGTH + 1];
+
+    PhoneNumbers *get = phfwdGet(pf, num);
+    PhoneNumbers *reverse = phfwdReverse(pf, num);
+    PhoneNumbers *getReverse = phfwdGetReverse(pf, num);
+
+    if (get == NULL || numbersLength(get) != 1 || reverse == NULL ||
+        !isSorted(reverse) || !contains(reverse, num) ||
+        getReverse == NULL || !isSorted(getReverse))
+        correct = false;
+
+    // prefiks numeru może zostać zastąpiony co najwyżej
+    // MAX_RULE_LENGTH cyframi, więc wynik zawsze mieści się w buforze
+    size_t length = phfwdGetInto(pf, num, buffer, sizeof(buffer));
+    if (length == 0 || length >= sizeof(buffer) ||
+        strlen(buffer) != length)
+        correct = false;
+
+    phnumDelete(get);
+    phnumDelete(reverse);
+    phnumDelete(getReverse);
+
+    phfwdReverseCount(pf, num);
+    phfwdGetReverseCount(pf, num);
+
+    // numery kursora można odczytywać tylko wtedy, gdy struktura nie jest
+    // modyfikowana, więc kursor jest jedynie otwierany
+    PhfwdReverseCursor *cursor = phfwdGetReverseOpen(pf, num);
+    if (cursor == NULL)
+        correct = false;
+    phfwdReverseClose(cursor);
+
+    return correct;
+}
+
+/**
+ * Wykonuje zapytania czytelnika do chwili zatrzymania.
+ * @param[in, out] arg – wskaźnik na stan czytelnika.
+ * @return NULL.
+ */
+static void *readerMain(void *arg) {
+    Reader *reader = arg;
+    char nums[BATCH_SIZE][MAX_QUERY_LENGTH + 1];
+    char const *batch[BATCH_SIZE];
+    PhoneNumbers *results[BATCH_SIZE];
+
+    while (!atomic_load_explicit(reader->stop, memory_order_relaxed)) {
+        for (size_t k = 0; k < BATCH_SIZE; ++k) {
+            randomNumber(&reader->state, nums[k], MAX_QUERY_LENGTH);
+            batch[k] = nums[k];
+        }
+
+        if (!queryNumber(reader->pf, nums[0]))
+            reader->failed = true;
+
+        phfwdGetBatch(reader->pf, batch, BATCH_SIZE, results);
+        for (size_t k = 0; k < BATCH_SIZE; ++k) {
+            if (results[k] == NULL || numbersLength(results[k]) != 1)
+                reader->failed = true;
+            phnumDelete(results[k]);
+        }
+
+        reader->queries += BATCH_SIZE + 1;
+    }
+
+    return NULL;
+}
+
+/**
+ * Losuje pary numerów dodawane funkcją @ref phfwdAddBulk. Jeśli numery
+ * w parze są równe, wydłuża drugi z nich o cyfrę.
+ * @param[in, out] state – wskaźnik na stan generatora;
+ * @param[out] nums      – tablica na numery par;
+ * @param[out] pairs     – tablica na pary.
+ */
+static void randomPairs(uint64_t *state,
+                        char nums[BULK_SIZE][2][MAX_RULE_LENGTH + 2],
+                        PhoneForwardPair pairs[BULK_SIZE]) {
+    for (size_t i = 0; i < BULK_SIZE; ++i) {
+        randomNumber(state, nums[i][0], MAX_RULE_LENGTH);
+        randomNumber(state, nums[i][1], MAX_RULE_LENGTH);
+        if (strcmp(nums[i][0], nums[i][1]) == 0)
+            strcat(nums[i][1], "0");
+
+        pairs[i].num1 = nums[i][0];
+        pairs[i].num2 = nums[i][1];
+    }
+}
+
+/**
+ * Wykonuje losową modyfikację jednocześnie na obu strukturach.
+ * @param[in, out] state  – wskaźnik na stan generatora;
+ * @param[in, out] shared – wskaźnik na strukturę odczytywaną współbieżnie;
+ * @param[in, out] model  – wskaźnik na strukturę wzorcową.
+ */
+static void modify(uint64_t *state, PhoneForward *shared,
+                   PhoneForward *model) {
+    char num1[MAX_RULE_LENGTH + 1];
+    char num2[MAX_RULE_LENGTH + 1];
+    PhoneForward *pfs[] = {shared, model};
+
+    randomNumber(state, num1, MAX_RULE_LENGTH);
+    randomNumber(state, num2, MAX_RULE_LENGTH);
+    char bulkNums[BULK_SIZE][2][MAX_RULE_LENGTH + 2];
+    PhoneForwardPair pairs[BULK_SIZE];
+    uint64_t kind = nextRandom(state) % 20;
+
+    if (kind == 14)
+        randomPairs(state, bulkNums, pairs);
+
+    for (size_t k = 0; k < 2; ++k) {
+        PhoneForward *pf = pfs[k];
+
+        if (kind < 9)
+            phfwdAdd(pf, num1, num2);
+        else if (kind < 13)
+            phfwdRemove(pf, num1);
+        else if (kind < 14)
+            phfwdReclaim(pf, 8);
+        else if (kind < 15)
+            phfwdAddBulk(pf, pairs, BULK_SIZE);
+        else if (kind < 16)
+            phfwdBegin(pf);
+        else if (kind < 17)
+            phfwdCommit(pf);
+        else if (kind < 18)
+            phfwdRollback(pf);
+        else if (kind < 19)
+            phfwdFreeze(pf);
+        else
+            phfwdAdd(pf, num2, num1);
+    }
+}
+
+/**
+ * Porównuje wyniki zapytań do obu struktur o wszystkie numery złożone
+ * z cyfr 0–2 o długości nie większej niż @ref MAX_RULE_LENGTH + 1.
+ * @param[in] shared – wskaźnik na strukturę odczytywaną współbieżnie;
+ * @param[in] model  – wskaźnik na strukturę wzorcową.
+ * @return Wartość @p true, jeśli wszystkie wyniki są równe.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool compareStructures(PhoneForward const *shared,
+                              PhoneForward const *model) {
+    char num[MAX_RULE_LENGTH + 2];
+
+    for (size_t length = 1; length <= MAX_RULE_LENGTH + 1; ++length) {
+        size_t total = 1;
+        for (size_t i = 0; i < length; ++i)
+            total *= 3;
+
+        for (size_t code = 0; code < total; ++code) {
+            size_t rest = code;
+            for (size_t i = 0; i < length; ++i, rest /= 3)
+                num[i] = (char) ('0' + rest % 3);
+            num[length] = '\0';
+
+            PhoneNumbers *results[2][3] = {
+                {phfwdGet(shared, num), phfwdReverse(shared, num),
+                 phfwdGetReverse(shared, num)},
+                {phfwdGet(model, num), phfwdReverse(model, num),
+                 phfwdGetReverse(model, num)}
+            };
+            bool equal = true;
+
+            for (size_t q = 0; q < 3; ++q) {
+                size_t count = numbersLength(results[0][q]);
+
+                if (count != numbersLength(results[1][q]))
+                    equal = false;
+                for (size_t k = 0; equal && k < count; ++k)
+                    if (strcmp(phnumGet(results[0][q], k),
+                               phnumGet(results[1][q], k)) != 0)
+                        equal = false;
+
+                phnumDelete(results[0][q]);
+                phnumDelete(results[1][q]);
+            }
+
+            if (!equal) {
+                fprintf(stderr, "results differ for %s\n", num);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Uruchamia test.
+ * @param[in] argc – liczba argumentów;
+ * @param[in] argv – argumenty: liczba modyfikacji, liczba czytelników
+ *                   i ziarno generatora.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    size_t operations = argc > 1 ? strtoull(argv[1], NULL, 10)
+                                 : DEFAULT_OPERATION_COUNT;
+    size_t readerCount = argc > 2 ? strtoull(argv[2], NULL, 10)
+                                  : DEFAULT_READER_COUNT;
+    uint64_t state = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+    if (state == 0)
+        state = 1;
+    if (readerCount == 0 || readerCount > MAX_READER_COUNT)
+        readerCount = DEFAULT_READER_COUNT;
+
+    PhoneForward *shared = phfwdNew();
+    PhoneForward *model = phfwdNew();
+    if (shared == NULL || model == NULL ||
+        !phfwdEnableConcurrentReads(shared)) {
+        phfwdDelete(shared);
+        phfwdDelete(model);
+        return 1;
+    }
+
+    atomic_bool stop;
+    atomic_init(&stop, false);
+    Reader readers[MAX_READER_COUNT];
+    size_t started = 0;
+
+    for (; started < readerCount; ++started) {
+        Reader *reader = &readers[started];
+
+        reader->pf = shared;
+        reader->stop = &stop;
+        reader->state = state + 1 + started;
+        reader->queries = 0;
+        reader->failed = false;
+        if (pthread_create(&reader->thread, NULL, readerMain, reader) != 0)
+            break;
+    }
+
+    for (size_t i = 0; i < operations; ++i)
+        modify(&state, shared, model);
+    phfwdCommit(shared);
+    phfwdCommit(model);
+
+    atomic_store_explicit(&stop, true, memory_order_relaxed);
+    bool correct = started == readerCount;
+    size_t queries = 0;
+
+    for (size_t k = 0; k < started; ++k) {
+        pthread_join(readers[k].thread, NULL);
+        queries += readers[k].queries;
+        if (readers[k].failed)
+            correct = false;
+    }
+
+    if (correct)
+        correct = compareStructures(shared, model);
+
+    phfwdDelete(shared);
+    phfwdDelete(model);
+
+    printf("operations: %zu\n", operations);
+    printf("readers: %zu\n", started);
+    printf("queries: %zu\n", queries);
+    printf("result: %s\n", correct ? "ok" : "FAILED");
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/** @file
+ * Pomiar czasu wczytywania przekierowań i usuwania struktury PhoneForward.
+ *
+ * Program dodaje zadaną liczbę pseudolosowych przekierowań za pomocą funkcji
+ * @ref phfwdAdd, a następnie usuwa strukturę funkcją @ref phfwdDelete,
+ * wypisując czas obu faz. Ciąg przekierowań zależy wyłącznie od parametrów
+ * wywołania, więc w celu porównania dwóch implementacji (np. alokatora
+ * opartego na pulach pamięci z przydzielaniem każdego węzła funkcją malloc)
+ * wystarczy skompilować program (z optymalizacjami i z katalogiem @p src na
+ * ścieżce plików nagłówkowych) razem z plikami źródłowymi każdej z nich
+ * i uruchomić go z tymi samymi parametrami:
+ *
+ *     ./load_bench [liczba przekierowań] [ziarno]
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "phone_forward.h"
+
+/** Domyślna liczba dodawanych przekierowań. */
+#define DEFAULT_RULE_COUNT 1000000
+
+/** Maksymalna długość generowanego numeru. */
+#define MAX_NUMBER_LENGTH 15
+
+/**
+ * Wyznacza kolejną wartość generatora liczb pseudolosowych (xorshift64).
+ * @param[in, out] state – wskaźnik na stan generatora.
+ * @return Wylosowana wartość.
+ */
+static uint64_t nextRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * Losuje numer o długości od 6 do @ref MAX_NUMBER_LENGTH cyfr.
+ * @param[in, out] state – wskaźnik na stan generatora;
+ * @param[out] num       – bufor o rozmiarze co najmniej
+ *                         @ref MAX_NUMBER_LENGTH + 1.
+ */
+static void randomNumber(uint64_t *state, char *num) {
+    size_t length = 6 + nextRandom(state) % (MAX_NUMBER_LENGTH - 5);
+
+    for (size_t i = 0; i < length; ++i)
+        num[i] = (char) ('0' + nextRandom(state) % 10);
+    num[length] = '\0';
+}
+
+/**
+ * Wyznacza czas w sekundach od ustalonej chwili.
+ * @return Czas w sekundach.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Uruchamia pomiar.
+ * @param[in] argc – liczba argumentów;
+ * @param[in] argv – argumenty: liczba przekierowań i ziarno generatora.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_RULE_COUNT;
+    uint64_t state = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    if (state == 0)
+        state = 1;
+
+    PhoneForward *pf = phfwdNew();
+    if (pf == NULL)
+        return 1;
+
+    char num1[MAX_NUMBER_LENGTH + 1];
+    char num2[MAX_NUMBER_LENGTH + 1];
+
+    double start = now();
+    for (size_t i = 0; i < count; ++i) {
+        randomNumber(&state, num1);
+        randomNumber(&state, num2);
+        if (!phfwdAdd(pf, num1, num2)) {
+            fprintf(stderr, "phfwdAdd failed after %zu rules\n", i);
+            phfwdDelete(pf);
+            return 1;
+        }
+    }
+    double loaded = now();
+
+    phfwdDelete(pf);
+    double deleted = now();
+
+    printf("rules: %zu\n", count);
+    printf("load: %.3f s (%.0f rules/s)\n", loaded - start,
+           (double) count / (loaded - start));
+    printf("teardown: %.3f s\n", deleted - loaded);
+    return 0;
+}
@@ -0,0 +1,574 @@
+/** @file
+ * Zestaw pomiarów wydajności operacji struktury PhoneForward.
+ *
+ * Program generuje syntetyczne zbiory przekierowań (scenariusze opisane przy
+ * funkcjach je generujących), dodaje je do nowej struktury, a następnie
+ * wykonuje na niej zapytania i usunięcia. Dla każdej z funkcji
+ * @ref phfwdAdd, @ref phfwdRemove, @ref phfwdGet, @ref phfwdReverse,
+ * @ref phfwdGetReverse i @ref phfwdDelete mierzony jest czas każdego
+ * wywołania z osobna, na podstawie którego wyznaczana jest przepustowość
+ * oraz mediana i percentyle 99 i 99,9 opóźnienia. Wyniki wypisywane są na
+ * standardowe wyjście w formacie JSON, razem z maksymalnym zużyciem pamięci
+ * rezydentnej procesu.
+ *
+ * Dane zależą wyłącznie od parametrów wywołania, więc dwie wersje biblioteki
+ * porównuje się, kompilując program (z optymalizacjami i z katalogiem
+ * @p src na ścieżce plików nagłówkowych) razem z plikami źródłowymi każdej
+ * z nich i uruchamiając go z tymi samymi parametrami:
+ *
+ *     ./phfwd_bench [scenariusz|all] [liczba przekierowań] [ziarno]
+ *
+ * Maksymalne zużycie pamięci jest wspólne dla całego procesu i obejmuje też
+ * wygenerowane dane scenariusza, więc do porównań zużycia pamięci należy
+ * uruchamiać każdy scenariusz osobno, z tymi samymi parametrami.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "phone_forward.h"
+
+/** Domyślna liczba przekierowań scenariusza. */
+#define DEFAULT_RULE_COUNT 200000
+
+/** Maksymalna liczba zapytań każdego rodzaju w scenariuszu. */
+#define MAX_QUERY_COUNT 100000
+
+/** Liczba zapytań o odwrotność w scenariuszu zbiegających się
+ * przekierowań, w którym każde z nich zwraca wszystkie przekierowania. */
+#define FAN_IN_QUERY_COUNT 50
+
+/** Rozmiar bufora na generowany numer. */
+#define NUMBER_SIZE 96
+
+/** Głębokość łańcucha zagnieżdżonych prefiksów w scenariuszu łańcuchów. */
+#define CHAIN_DEPTH 64
+
+/**
+ * Para numerów przechowywana w tablicy przekierowań scenariusza.
+ */
+typedef struct Rule {
+    char num1[NUMBER_SIZE]; ///< prefiks numerów przekierowywanych
+    char num2[NUMBER_SIZE]; ///< prefiks numerów docelowych
+} Rule;
+
+/**
+ * Scenariusz pomiaru: zbiór przekierowań, zapytań i usunięć.
+ */
+typedef struct Workload {
+    Rule *rules; ///< przekierowania w kolejności dodawania
+    size_t ruleCount; ///< liczba przekierowań
+    char (*forward)[NUMBER_SIZE]; ///< numery zapytań phfwdGet
+    char (*reverse)[NUMBER_SIZE]; ///< numery zapytań o odwrotność
+    char (*removed)[NUMBER_SIZE]; ///< prefiksy usuwanych przekierowań
+    size_t forwardCount; ///< liczba zapytań phfwdGet
+    size_t reverseCount; ///< liczba zapytań o odwrotność
+    size_t removedCount; ///< liczba usunięć
+    /** co ile przekierowań wykonywane jest jedno usunięcie (0, jeśli
+        usunięcia wykonywane są dopiero po zapytaniach) */
+    size_t churnPeriod;
+} Workload;
+
+/**
+ * Opis scenariusza: nazwa i funkcja generująca jego dane.
+ */
+typedef struct WorkloadKind {
+    char const *name; ///< nazwa scenariusza
+    /** funkcja wypełniająca tablice scenariusza */
+    void (*generate)(Workload *workload, uint64_t *state);
+} WorkloadKind;
+
+/**
+ * Wyniki pomiarów jednej funkcji.
+ */
+typedef struct Samples {
+    uint64_t *nanoseconds; ///< czasy kolejnych wywołań w nanosekundach
+    size_t count; ///< liczba zmierzonych wywołań
+} Samples;
+
+/**
+ * Wyznacza kolejną wartość generatora liczb pseudolosowych (xorshift64).
+ * @param[in, out] state – wskaźnik na stan generatora.
+ * @return Wylosowana wartość.
+ */
+static uint64_t nextRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * Losuje liczbę z przedziału [@p low, @p high].
+ * @param[in, out] state – wskaźnik na stan generatora;
+ * @param[in] low        – dolna granica przedziału;
+ * @param[in] high       – górna granica przedziału.
+ * @return Wylosowana liczba.
+ */
+static size_t randomBetween(uint64_t *state, size_t low, size_t high) {
+    return low + (size_t) (nextRandom(state) % (high - low + 1));
+}
+
+/**
+ * Dopisuje do numeru losowe cyfry (dziesiętne oraz, rzadziej, * i #).
+ * @param[in, out] state – wskaźnik na stan generatora;
+ * @param[in, out] num   – bufor o rozmiarze @ref NUMBER_SIZE z numerem;
+ * @param[in] count      – liczba dopisywanych cyfr.
+ */
+static void appendDigits(uint64_t *state, char *num, size_t count) {
+    static char const digits[] = "0123456789012345678901234567890123456789*#";
+    size_t length = strlen(num);
+
+    if (length + count >= NUMBER_SIZE)
+        count = NUMBER_SIZE - 1 - length;
+
+    for (size_t i = 0; i < count; ++i)
+        num[length + i] = digits[nextRandom(state) % (sizeof(digits) - 1)];
+    num[length + count] = '\0';
+}
+
+/**
+ * Tworzy numer zapytania: numer @p base przedłużony o kilka losowych cyfr.
+ * @param[in, out] state – wskaźnik na stan generatora;
+ * @param[out] num       – bufor o rozmiarze @ref NUMBER_SIZE;
+ * @param[in] base       – wskaźnik na napis reprezentujący numer.
+ */
+static void extendNumber(uint64_t *state, char *num, char const *base) {
+    strcpy(num, base);
+    appendDigits(state, num, randomBetween(state, 0, 6));
+}
+
+/**
+ * Wypełnia zapytania scenariusza numerami opartymi na jego przekierowaniach:
+ * zapytania phfwdGet przedłużają numery przekierowywane, zapytania
+ * o odwrotność – numery docelowe, a usunięcia dotyczą prefiksów numerów
+ * przekierowywanych.
+ * @param[in, out] workload – wskaźnik na scenariusz z wygenerowanymi
+ *                            przekierowaniami;
+ * @param[in, out] state    – wskaźnik na stan generatora.
+ */
+static void deriveQueries(Workload *workload, uint64_t *state) {
+    for (size_t i = 0; i < workload->forwardCount; ++i) {
+        size_t r = randomBetween(state, 0, workload->ruleCount - 1);
+        extendNumber(state, workload->forward[i], workload->rules[r].num1);
+    }
+
+    for (size_t i = 0; i < workload->reverseCount; ++i) {
+        size_t r = randomBetween(state, 0, workload->ruleCount - 1);
+        extendNumber(state, workload->reverse[i], workload->rules[r].num2);
+    }
+
+    // usuwamy głównie całe przekierowania, a czasem krótszy prefiks,
+    // usuwający całe poddrzewo; usunięcia przeplatane z dodawaniem dotyczą
+    // przekierowań już dodanych
+    for (size_t i = 0; i < workload->removedCount; ++i) {
+        size_t last = workload->churnPeriod > 0 ? i * workload->churnPeriod :
+                                                  workload->ruleCount - 1;
+        size_t r = randomBetween(state, 0, last);
+        char *num = workload->removed[i];
+        size_t length = strlen(workload->rules[r].num1);
+
+        strcpy(num, workload->rules[r].num1);
+        if (nextRandom(state) % 8 == 0 && length > 3)
+            num[randomBetween(state, 3, length - 1)] = '\0';
+    }
+}
+
+/**
+ * Scenariusz losowych prefiksów: oba numery każdego przekierowania mają
+ * od 4 do 15 losowych cyfr.
+ * @param[in, out] workload – wskaźnik na wypełniany scenariusz;
+ * @param[in, out] state    – wskaźnik na stan generatora.
+ */
+static void generateRandom(Workload *workload, uint64_t *state) {
+    for (size_t i = 0; i < workload->ruleCount; ++i) {
+        Rule *rule = &workload->rules[i];
+
+        do {
+            rule->num1[0] = rule->num2[0] = '\0';
+            appendDigits(state, rule->num1, randomBetween(state, 4, 15));
+            appendDigits(state, rule->num2, randomBetween(state, 4, 15));
+        } while (strcmp(rule->num1, rule->num2) == 0);
+    }
+
+    deriveQueries(workload, state);
+}
+
+/**
+ * Scenariusz planu numeracji: numery przekierowywane składają się z kodu
+ * kraju, strefy i prefiksu numeru abonenta (jak przy przenoszeniu numerów
+ * między operatorami), a numery docelowe – z kodu kraju i jednego z kilkuset
+ * kodów kierowania ruchu.
+ * @param[in, out] workload – wskaźnik na wypełniany scenariusz;
+ * @param[in, out] state    – wskaźnik na stan generatora.
+ */
+static void generatePlan(Workload *workload, uint64_t *state) {
+    static char const *const countries[] = {"48", "49", "44", "1", "380"};
+    size_t countryCount = sizeof(countries) / sizeof(countries[0]);
+
+    for (size_t i = 0; i < workload->ruleCount; ++i) {
+        Rule *rule = &workload->rules[i];
+        char const *country = countries[nextRandom(state) % countryCount];
+
+        snprintf(rule->num1, NUMBER_SIZE, "%s%02u", country,
+                 (unsigned int) randomBetween(state, 10, 99));
+        appendDigits(state, rule->num1, randomBetween(state, 3, 7));
+        snprintf(rule->num2, NUMBER_SIZE, "%s0%03u", country,
+                 (unsigned int) randomBetween(state, 0, 399));
+    }
+
+    deriveQueries(workload, state);
+}
+
+/**
+ * Scenariusz głębokich łańcuchów: przekierowania tworzą łańcuchy
+ * @ref CHAIN_DEPTH zagnieżdżonych prefiksów (każdy numer przekierowywany
+ * jest prefiksem następnego), a każdy numer docelowy jest numerem
+ * przekierowywanym poprzedniego przekierowania.
+ * @param[in, out] workload – wskaźnik na wypełniany scenariusz;
+ * @param[in, out] state    – wskaźnik na stan generatora.
+ */
+static void generateChains(Workload *workload, uint64_t *state) {
+    char chain[NUMBER_SIZE] = "";
+
+    for (size_t i = 0; i < workload->ruleCount; ++i) {
+        Rule *rule = &workload->rules[i];
+
+        if (i % CHAIN_DEPTH == 0) {
+            chain[0] = '\0';
+            appendDigits(state, chain, 4);
+        }
+        appendDigits(state, chain, 1);
+        strcpy(rule->num1, chain);
+
+        if (i % CHAIN_DEPTH == 0) {
+            strcpy(rule->num2, "9");
+            appendDigits(state, rule->num2, 8);
+        } else {
+            strcpy(rule->num2, workload->rules[i - 1].num1);
+        }
+    }
+
+    deriveQueries(workload, state);
+}
+
+/**
+ * Scenariusz zbiegających się przekierowań: wszystkie przekierowania
+ * prowadzą na ten sam numer, więc każde zapytanie o odwrotność zwraca je
+ * wszystkie.
+ * @param[in, out] workload – wskaźnik na wypełniany scenariusz;
+ * @param[in, out] state    – wskaźnik na stan generatora.
+ */
+static void generateFanIn(Workload *workload, uint64_t *state) {
+    for (size_t i = 0; i < workload->ruleCount; ++i) {
+        Rule *rule = &workload->rules[i];
+
+        strcpy(rule->num1, "1");
+        appendDigits(state, rule->num1, randomBetween(state, 5, 14));
+        strcpy(rule->num2, "800");
+    }
+
+    if (workload->reverseCount > FAN_IN_QUERY_COUNT)
+        workload->reverseCount = FAN_IN_QUERY_COUNT;
+    deriveQueries(workload, state);
+}
+
+/**
+ * Scenariusz intensywnych usunięć: przekierowania losowe jak w scenariuszu
+ * losowych prefiksów, ale co czwarte dodanie przeplatane jest usunięciem
+ * prefiksu dodanego wcześniej przekierowania.
+ * @param[in, out] workload – wskaźnik na wypełniany scenariusz;
+ * @param[in, out] state    – wskaźnik na stan generatora.
+ */
+static void generateChurn(Workload *workload, uint64_t *state) {
+    workload->churnPeriod = 4;
+    workload->removedCount = workload->ruleCount / workload->churnPeriod;
+    generateRandom(workload, state);
+}
+
+/** Dostępne scenariusze. */
+static WorkloadKind const workloadKinds[] = {
+    {"random", generateRandom},
+    {"plan", generatePlan},
+    {"chains", generateChains},
+    {"fanin", generateFanIn},
+    {"churn", generateChurn},
+};
+
+/**
+ * Wyznacza czas w nanosekundach od ustalonej chwili.
+ * @return Czas w nanosekundach.
+ */
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * Zapisuje czas wywołania.
+ * @param[in, out] samples – wskaźnik na wyniki pomiarów funkcji;
+ * @param[in] start        – chwila rozpoczęcia wywołania.
+ */
+static void record(Samples *samples, uint64_t start) {
+    samples->nanoseconds[samples->count++] = now() - start;
+}
+
+/**
+ * Porównuje dwa czasy wywołań.
+ * @param[in] a – wskaźnik na pierwszy czas;
+ * @param[in] b – wskaźnik na drugi czas.
+ * @return Wartość ujemna, zero lub dodatnia, jeśli pierwszy czas jest
+ *         odpowiednio krótszy, równy lub dłuższy niż drugi.
+ */
+static int compareSamples(void const *a, void const *b) {
+    uint64_t x = *(uint64_t const *) a;
+    uint64_t y = *(uint64_t const *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Wypisuje wyniki pomiarów funkcji jako obiekt JSON.
+ * @param[in] name         – nazwa funkcji;
+ * @param[in, out] samples – wskaźnik na wyniki pomiarów (są sortowane);
+ * @param[in] last         – czy jest to ostatni obiekt tablicy.
+ */
+static void printSamples(char const *name, Samples *samples, bool last) {
+    uint64_t total = 0;
+
+    qsort(samples->nanoseconds, samples->count, sizeof(uint64_t),
+          compareSamples);
+    for (size_t i = 0; i < samples->count; ++i)
+        total += samples->nanoseconds[i];
+
+    printf("        {\"operation\": \"%s\", \"count\": %zu, "
+           "\"total_s\": %.6f, \"ops_per_s\": %.1f", name, samples->count,
+           (double) total * 1e-9,
+           total > 0 ? (double) samples->count / ((double) total * 1e-9) : 0);
+
+    // percentyl p to najmniejszy czas, od którego nie dłużej trwał ułamek
+    // p wywołań
+    static struct {
+        char const *name;
+        size_t permille;
+    } const percentiles[] = {{"p50", 500}, {"p99", 990}, {"p999", 999}};
+    for (size_t p = 0; p < 3; ++p) {
+        uint64_t value = 0;
+
+        if (samples->count > 0) {
+            size_t rank = (samples->count * percentiles[p].permille + 999) /
+                          1000;
+            value = samples->nanoseconds[rank > 0 ? rank - 1 : 0];
+        }
+        printf(", \"%s_ns\": %llu", percentiles[p].name,
+               (unsigned long long) value);
+    }
+    printf("}%s\n", last ? "" : ",");
+}
+
+/**
+ * Wyznacza maksymalne dotychczasowe zużycie pamięci rezydentnej procesu.
+ * @return Zużycie pamięci w kilobajtach lub 0, jeśli nie udało się go
+ *         odczytać.
+ */
+static long peakRssKilobytes(void) {
+    struct rusage usage;
+
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+/**
+ * Wykonuje operacje scenariusza na nowej strukturze, mierząc czas każdego
+ * wywołania.
+ * @param[in] workload – wskaźnik na scenariusz;
+ * @param[out] add     – wskaźnik na wyniki pomiarów @ref phfwdAdd;
+ * @param[out] remove  – wskaźnik na wyniki pomiarów @ref phfwdRemove;
+ * @param[out] get     – wskaźnik na wyniki pomiarów @ref phfwdGet;
+ * @param[out] reverse – wskaźnik na wyniki pomiarów @ref phfwdReverse;
+ * @param[out] getReverse – wskaźnik na wyniki pomiarów
+ *                          @ref phfwdGetReverse;
+ * @param[out] del     – wskaźnik na wyniki pomiarów @ref phfwdDelete.
+ * @return Wartość @p true, jeśli wszystkie operacje się powiodły.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool runWorkload(Workload const *workload, Samples *add,
+                        Samples *remove, Samples *get, Samples *reverse,
+                        Samples *getReverse, Samples *del) {
+    PhoneForward *pf = phfwdNew();
+    if (pf == NULL)
+        return false;
+
+    size_t nextRemoved = 0;
+    for (size_t i = 0; i < workload->ruleCount; ++i) {
+        Rule const *rule = &workload->rules[i];
+        uint64_t start = now();
+
+        if (!phfwdAdd(pf, rule->num1, rule->num2)) {
+            phfwdDelete(pf);
+            return false;
+        }
+        record(add, start);
+
+        if (workload->churnPeriod > 0 && i % workload->churnPeriod == 0 &&
+            nextRemoved < workload->removedCount) {
+            start = now();
+            phfwdRemove(pf, workload->removed[nextRemoved++]);
+            record(remove, start);
+        }
+    }
+
+    for (size_t i = 0; i < workload->forwardCount; ++i) {
+        uint64_t start = now();
+        PhoneNumbers *result = phfwdGet(pf, workload->forward[i]);
+        record(get, start);
+        phnumDelete(result);
+    }
+
+    for (size_t i = 0; i < workload->reverseCount; ++i) {
+        uint64_t start = now();
+        PhoneNumbers *result = phfwdReverse(pf, workload->reverse[i]);
+        record(reverse, start);
+        phnumDelete(result);
+    }
+
+    for (size_t i = 0; i < workload->reverseCount; ++i) {
+        uint64_t start = now();
+        PhoneNumbers *result = phfwdGetReverse(pf, workload->reverse[i]);
+        record(getReverse, start);
+        phnumDelete(result);
+    }
+
+    while (nextRemoved < workload->removedCount) {
+        uint64_t start = now();
+        phfwdRemove(pf, workload->removed[nextRemoved++]);
+        record(remove, start);
+    }
+
+    uint64_t start = now();
+    phfwdDelete(pf);
+    record(del, start);
+    return true;
+}
+
+/**
+ * Generuje scenariusz, wykonuje go i wypisuje wyniki jako obiekt JSON.
+ * @param[in] kind  – wskaźnik na opis scenariusza;
+ * @param[in] count – liczba przekierowań;
+ * @param[in] seed  – ziarno generatora;
+ * @param[in] last  – czy jest to ostatni wypisywany scenariusz.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool benchWorkload(WorkloadKind const *kind, size_t count,
+                          uint64_t seed, bool last) {
+    uint64_t state = seed;
+    size_t queries = count < MAX_QUERY_COUNT ? count : MAX_QUERY_COUNT;
+    Workload workload = {
+        .ruleCount = count,
+        .forwardCount = queries,
+        .reverseCount = queries,
+        .removedCount = queries / 4,
+    };
+    Samples samples[6] = {{NULL, 0}};
+    bool result = false;
+
+    workload.rules = malloc(count * sizeof(Rule));
+    workload.forward = malloc(queries * NUMBER_SIZE);
+    workload.reverse = malloc(queries * NUMBER_SIZE);
+    // w scenariuszu usunięć ich liczba zależy od liczby przekierowań
+    workload.removed = malloc((count / 4 + queries) * NUMBER_SIZE);
+    for (size_t s = 0; s < 6; ++s)
+        samples[s].nanoseconds = malloc((count + 1) * sizeof(uint64_t));
+
+    bool allocated = workload.rules != NULL && workload.forward != NULL &&
+                     workload.reverse != NULL && workload.removed != NULL;
+    for (size_t s = 0; s < 6; ++s)
+        allocated = allocated && samples[s].nanoseconds != NULL;
+
+    if (allocated) {
+        kind->generate(&workload, &state);
+        result = runWorkload(&workload, &samples[0], &samples[1],
+                             &samples[2], &samples[3], &samples[4],
+                             &samples[5]);
+    }
+
+    if (result) {
+        static char const *const names[] = {
+            "phfwdAdd", "phfwdRemove", "phfwdGet", "phfwdReverse",
+            "phfwdGetReverse", "phfwdDelete"
+        };
+
+        printf("    {\"workload\": \"%s\", \"rules\": %zu, \"seed\": %llu, "
+               "\"operations\": [\n", kind->name, count,
+               (unsigned long long) seed);
+        for (size_t s = 0; s < 6; ++s)
+            printSamples(names[s], &samples[s], s == 5);
+        printf("      ], \"peak_rss_kb\": %ld}%s\n", peakRssKilobytes(),
+               last ? "" : ",");
+    }
+
+    free(workload.rules);
+    free(workload.forward);
+    free(workload.reverse);
+    free(workload.removed);
+    for (size_t s = 0; s < 6; ++s)
+        free(samples[s].nanoseconds);
+    return result;
+}
+
+/**
+ * Uruchamia pomiary.
+ * @param[in] argc – liczba argumentów;
+ * @param[in] argv – argumenty: nazwa scenariusza (lub all), liczba
+ *                   przekierowań i ziarno generatora.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    char const *name = argc > 1 ? argv[1] : "all";
+    size_t count = argc > 2 ? strtoull(argv[2], NULL, 10) : DEFAULT_RULE_COUNT;
+    uint64_t seed = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+    size_t kindCount = sizeof(workloadKinds) / sizeof(workloadKinds[0]);
+    size_t first = 0;
+    size_t end = kindCount;
+
+    if (seed == 0)
+        seed = 1;
+    if (count == 0 || count > SIZE_MAX / sizeof(Rule)) {
+        fprintf(stderr, "invalid rule count\n");
+        return 1;
+    }
+
+    if (strcmp(name, "all") != 0) {
+        while (first < kindCount && strcmp(workloadKinds[first].name, name))
+            ++first;
+        if (first == kindCount) {
+            fprintf(stderr, "unknown workload: %s\n", name);
+            return 1;
+        }
+        end = first + 1;
+    }
+
+    printf("{\"benchmark\": \"phfwd\", \"workloads\": [\n");
+    for (size_t k = first; k < end; ++k) {
+        if (!benchWorkload(&workloadKinds[k], count, seed, k + 1 == end)) {
+            fprintf(stderr, "workload %s failed\n", workloadKinds[k].name);
+            return 1;
+        }
+    }
+    printf("]}\n");
+    return 0;
+}
@@ -0,0 +1,411 @@
+/** @file
+ * Implementacja klasy synchronizującej jednego pisarza z wieloma
+ * czytelnikami bez blokowania czytelników.
+ *
+ * Czytelnicy nie zakładają blokad. Spójność odczytu zapewnia licznik wersji
+ * (ang. seqlock): pisarz zwiększa go przed modyfikacją i po niej, więc
+ * nieparzysta wartość oznacza trwającą modyfikację, a zmiana wartości
+ * w trakcie odczytu – konieczność jego powtórzenia. Aby niespójny odczyt
+ * nie mógł odwołać się do zwolnionej pamięci, obiekty usuwane przez pisarza
+ * zwalniane są z opóźnieniem (epokami): obiekt usunięty w epoce @p e jest
+ * zwalniany dopiero po przejściu do epoki @p e + 2, co jest możliwe, gdy
+ * zakończą się wszystkie odczyty rozpoczęte w epoce @p e. Liczby trwających
+ * odczytów przechowywane są osobno dla epok parzystych i nieparzystych,
+ * a każda z nich rozbita jest na kilka liczników w osobnych liniach pamięci
+ * podręcznej, aby czytelnicy z różnych wątków nie współdzielili jednej
+ * linii.
+ *
+ * Czytelnik czekający na koniec modyfikacji najpierw krótko próbuje
+ * ponownie, a potem oddaje procesor innym wątkom. Długa modyfikacja
+ * wywołuje co pewien czas funkcję @ref epochWriteYield, a czytelnik, który
+ * czeka zbyt długo lub którego odczyty kilka razy z rzędu okazały się
+ * niespójne, prosi pisarza o pierwszeństwo. Pisarz, który to zauważy
+ * w @ref epochWriteYield, kończy modyfikację i nie rozpoczyna kolejnej, aż
+ * proszący czytelnicy zakończą odczyty. Dzięki temu odczyt nie musi czekać
+ * na koniec całej długiej modyfikacji ani nie może być bez końca
+ * unieważniany przez kolejne krótkie modyfikacje.
+ *
+ * Pisarz może zarezerwować miejsce na kolejne odraczane obiekty (zob.
+ * @ref epochReserve). Obie tablice obiektów mają wtedy zapas miejsca na
+ * zarezerwowane obiekty: bieżąca ponad obiekty, które już zawiera, a druga,
+ * opróżniana przy przejściu do kolejnej epoki, w całości. Pozostałe
+ * odroczenia nie zajmują tego zapasu, więc zarezerwowane nie alokują
+ * pamięci.
+ *
+ * Zapisy pisarza publikujące nowe obiekty muszą mieć semantykę zwolnienia
+ * (ang. release), a czytelnicy polegają na zależności adresowej między
+ * odczytanym indeksem obiektu a odczytem jego zawartości.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "epoch.h"
+
+/**
+ * Liczba liczników trwających odczytów dla każdej parzystości epoki.
+ */
+#define EPOCH_STRIPES 16
+
+/**
+ * Liczba prób, po których oczekujący wątek zaczyna oddawać procesor innym
+ * wątkom, a czytelnik czekający na koniec modyfikacji prosi pisarza
+ * o pierwszeństwo.
+ */
+#define EPOCH_SPIN_LIMIT 64
+
+/**
+ * Liczba kolejnych niespójnych odczytów wątku, po których czytelnik prosi
+ * pisarza o pierwszeństwo.
+ */
+#define EPOCH_PRIORITY_RETRIES 2
+
+/**
+ * Struktura przechowująca liczniki trwających odczytów jednej grupy wątków,
+ * zajmująca osobną linię pamięci podręcznej.
+ */
+typedef struct ReaderStripe {
+    _Alignas(64) atomic_size_t active[2]; /**< liczby trwających odczytów
+                                          rozpoczętych w epokach parzystych
+                                          i nieparzystych */
+} ReaderStripe;
+
+/**
+ * Struktura reprezentująca obiekt oczekujący na zwolnienie.
+ */
+typedef struct Retired {
+    EpochReclaim reclaim; ///< funkcja zwalniająca obiekt
+    void *owner; ///< wskaźnik przekazywany do funkcji @p reclaim
+    uintptr_t object; ///< zwalniany obiekt
+} Retired;
+
+/**
+ * Struktura przechowująca dynamicznie powiększaną tablicę obiektów
+ * oczekujących na zwolnienie.
+ */
+typedef struct RetiredList {
+    Retired *items; ///< tablica obiektów
+    size_t count; ///< liczba obiektów w tablicy
+    size_t capacity; ///< rozmiar tablicy
+} RetiredList;
+
+/**
+ * Struktura synchronizująca pisarza z czytelnikami.
+ */
+struct Epoch {
+    _Alignas(64) atomic_uint sequence; /**< licznik wersji danych,
+                                       nieparzysty w trakcie modyfikacji */
+    atomic_uint priority; /**< liczba czytelników, którzy poprosili pisarza
+                          o pierwszeństwo */
+    atomic_uint epoch; ///< numer aktualnej epoki
+    size_t reserved; /**< liczba zarezerwowanych miejsc na odraczane
+                     obiekty */
+    RetiredList retired[2]; /**< obiekty usunięte w epokach parzystych
+                            i nieparzystych */
+    ReaderStripe stripes[EPOCH_STRIPES]; ///< liczniki trwających odczytów
+};
+
+/**
+ * Wyznacza numer licznika odczytów używanego przez bieżący wątek.
+ * @return Numer licznika.
+ */
+static size_t readerStripe(void) {
+    static atomic_uint nextStripe;
+    static _Thread_local size_t stripe = EPOCH_STRIPES;
+
+    if (stripe == EPOCH_STRIPES)
+        stripe = atomic_fetch_add_explicit(&nextStripe, 1,
+                                           memory_order_relaxed) %
+                 EPOCH_STRIPES;
+
+    return stripe;
+}
+
+/**
+ * Liczba kolejnych niespójnych odczytów bieżącego wątku.
+ */
+static _Thread_local unsigned int failedReads;
+
+/**
+ * Czeka chwilę przed ponowną próbą: początkowo jedynie wraca do
+ * wywołującego, a po @ref EPOCH_SPIN_LIMIT próbach oddaje procesor innym
+ * wątkom.
+ * @param[in, out] attempt – wskaźnik na liczbę dotychczasowych prób.
+ */
+static void backoff(unsigned int *attempt) {
+    if (*attempt < EPOCH_SPIN_LIMIT)
+        ++*attempt;
+    else
+        sched_yield();
+}
+
+/**
+ * Zapewnia tablicy miejsce na co najmniej @p capacity obiektów, powiększając
+ * ją w razie potrzeby co najmniej półtorakrotnie.
+ * @param[in, out] list – wskaźnik na tablicę obiektów;
+ * @param[in] capacity  – wymagany rozmiar tablicy.
+ * @return Wartość @p true, jeśli tablica ma wymagany rozmiar.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool reserveList(RetiredList *list, size_t capacity) {
+    if (list->capacity >= capacity)
+        return true;
+
+    size_t newCapacity = list->capacity * 3 / 2 + 16;
+    if (newCapacity < capacity)
+        newCapacity = capacity;
+    if (newCapacity > SIZE_MAX / sizeof(Retired))
+        return false;
+
+    Retired *tmp = realloc(list->items, newCapacity * sizeof(Retired));
+    if (tmp == NULL)
+        return false;
+
+    list->items = tmp;
+    list->capacity = newCapacity;
+    return true;
+}
+
+/**
+ * Zwalnia wszystkie obiekty z tablicy i opróżnia ją.
+ * @param[in, out] list – wskaźnik na tablicę obiektów.
+ */
+static void reclaimAll(RetiredList *list) {
+    for (size_t i = 0; i < list->count; ++i)
+        list->items[i].reclaim(list->items[i].owner, list->items[i].object);
+    list->count = 0;
+}
+
+/**
+ * Sprawdza, czy trwa odczyt rozpoczęty w epoce o danej parzystości.
+ * @param[in] epoch  – wskaźnik na strukturę synchronizującą;
+ * @param[in] parity – parzystość epoki.
+ * @return Wartość @p true, jeśli trwa taki odczyt.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool readersActive(Epoch *epoch, unsigned int parity) {
+    for (size_t s = 0; s < EPOCH_STRIPES; ++s)
+        if (atomic_load(&epoch->stripes[s].active[parity]) != 0)
+            return true;
+
+    return false;
+}
+
+/** @brief Przechodzi do kolejnej epoki.
+ * Jeśli zakończyły się wszystkie odczyty rozpoczęte w poprzedniej epoce, to
+ * zwalnia obiekty usunięte w tamtej epoce i przechodzi do kolejnej epoki.
+ * @param[in, out] epoch – wskaźnik na strukturę synchronizującą;
+ * @param[in] wait       – czy czekać na zakończenie odczytów.
+ * @return Wartość @p true, jeśli nastąpiło przejście do kolejnej epoki.
+ *         Wartość @p false, jeśli trwają odczyty z poprzedniej epoki,
+ *         a @p wait ma wartość @p false.
+ */
+static bool advance(Epoch *epoch, bool wait) {
+    unsigned int current = atomic_load(&epoch->epoch);
+    unsigned int previous = (current + 1) & 1;
+    unsigned int attempt = 0;
+
+    while (readersActive(epoch, previous)) {
+        if (!wait)
+            return false;
+        backoff(&attempt);
+    }
+
+    reclaimAll(&epoch->retired[previous]);
+    atomic_store(&epoch->epoch, current + 1);
+    return true;
+}
+
+Epoch *epochNew(void) {
+    Epoch *newStruct = aligned_alloc(_Alignof(struct Epoch),
+                                     sizeof(struct Epoch));
+
+    if (newStruct != NULL) {
+        atomic_init(&newStruct->sequence, 0);
+        atomic_init(&newStruct->priority, 0);
+        atomic_init(&newStruct->epoch, 0);
+        newStruct->reserved = 0;
+
+        for (unsigned int p = 0; p < 2; ++p) {
+            newStruct->retired[p].items = NULL;
+            newStruct->retired[p].count = 0;
+            newStruct->retired[p].capacity = 0;
+
+            for (size_t s = 0; s < EPOCH_STRIPES; ++s)
+                atomic_init(&newStruct->stripes[s].active[p], 0);
+        }
+    }
+
+    return newStruct;
+}
+
+void epochDelete(Epoch *epoch) {
+    if (epoch == NULL)
+        return;
+
+    for (unsigned int p = 0; p < 2; ++p) {
+        reclaimAll(&epoch->retired[p]);
+        free(epoch->retired[p].items);
+    }
+    free(epoch);
+}
+
+void epochReadBegin(Epoch *epoch, EpochRead *read) {
+    if (epoch == NULL)
+        return;
+
+    size_t stripe = readerStripe();
+    unsigned int attempt = 0;
+
+    // czytelnik, którego poprzednie odczyty były niespójne, od razu prosi
+    // o pierwszeństwo, a pozostali – dopiero gdy czekają zbyt długo
+    read->priority = failedReads >= EPOCH_PRIORITY_RETRIES;
+    if (read->priority)
+        atomic_fetch_add(&epoch->priority, 1);
+
+    for (;;) {
+        unsigned int current = atomic_load(&epoch->epoch);
+        unsigned int parity = current & 1;
+
+        atomic_fetch_add(&epoch->stripes[stripe].active[parity], 1);
+
+        // pisarz mógł przejść do kolejnej epoki, zanim odczyt został
+        // policzony, a w trakcie modyfikacji nie ma sensu czytać; odczyt
+        // licznika jest sekwencyjnie spójny, aby pisarz, który rozpocznie
+        // modyfikację po nim, zobaczył prośbę o pierwszeństwo
+        if (atomic_load(&epoch->epoch) == current) {
+            unsigned int sequence = atomic_load(&epoch->sequence);
+
+            if ((sequence & 1) == 0) {
+                read->stripe = stripe;
+                read->parity = parity;
+                read->sequence = sequence;
+                return;
+            }
+        }
+
+        // wycofujemy się, aby pisarz czekający na koniec odczytów nie
+        // czekał na ten wątek
+        atomic_fetch_sub(&epoch->stripes[stripe].active[parity], 1);
+
+        if (!read->priority && attempt == EPOCH_SPIN_LIMIT) {
+            read->priority = true;
+            atomic_fetch_add(&epoch->priority, 1);
+        }
+        backoff(&attempt);
+    }
+}
+
+bool epochReadEnd(Epoch *epoch, EpochRead const *read) {
+    if (epoch == NULL)
+        return true;
+
+    atomic_thread_fence(memory_order_acquire);
+    bool consistent = atomic_load_explicit(&epoch->sequence,
+                                           memory_order_relaxed) ==
+                      read->sequence;
+
+    atomic_fetch_sub(&epoch->stripes[read->stripe].active[read->parity], 1);
+    if (read->priority)
+        atomic_fetch_sub(&epoch->priority, 1);
+
+    failedReads = consistent ? 0 : failedReads + 1;
+    return consistent;
+}
+
+void epochWriteBegin(Epoch *epoch) {
+    if (epoch == NULL)
+        return;
+
+    unsigned int sequence = atomic_load_explicit(&epoch->sequence,
+                                                 memory_order_relaxed);
+    unsigned int attempt = 0;
+
+    for (;;) {
+        while (atomic_load(&epoch->priority) != 0)
+            backoff(&attempt);
+
+        // czytelnik mógł poprosić o pierwszeństwo po sprawdzeniu, ale przed
+        // rozpoczęciem modyfikacji; wtedy przywracamy poprzednią wartość
+        // licznika, bo dane się nie zmieniły, a czytelnik, który ją odczytał,
+        // może dokończyć odczyt (ustalenie kolejności między tymi zapisami
+        // i odczytami wymaga operacji sekwencyjnie spójnych)
+        atomic_store(&epoch->sequence, sequence + 1);
+        if (atomic_load(&epoch->priority) == 0)
+            break;
+        atomic_store(&epoch->sequence, sequence);
+    }
+    atomic_thread_fence(memory_order_release);
+}
+
+void epochWriteEnd(Epoch *epoch) {
+    if (epoch == NULL)
+        return;
+
+    unsigned int sequence = atomic_load_explicit(&epoch->sequence,
+                                                 memory_order_relaxed);
+    atomic_store_explicit(&epoch->sequence, sequence + 1,
+                          memory_order_release);
+    advance(epoch, false);
+}
+
+void epochWriteYield(Epoch *epoch) {
+    if (epoch == NULL ||
+        atomic_load_explicit(&epoch->priority, memory_order_relaxed) == 0)
+        return;
+
+    epochWriteEnd(epoch);
+    epochWriteBegin(epoch);
+}
+
+void epochRetire(Epoch *epoch, EpochReclaim reclaim, void *owner,
+                 uintptr_t object) {
+    if (epoch == NULL) {
+        reclaim(owner, object);
+        return;
+    }
+
+    RetiredList *list = &epoch->retired[atomic_load(&epoch->epoch) & 1];
+
+    // bez pamięci na odroczenie czekamy, aż zakończą się wszystkie odczyty,
+    // które mogły widzieć obiekt, i zwalniamy go od razu; zarezerwowane
+    // miejsca pozostają wolne, więc odroczenia, na które je zarezerwowano,
+    // nie powiększają tablicy
+    if (!reserveList(list, list->count + epoch->reserved + 1)) {
+        advance(epoch, true);
+        advance(epoch, true);
+        reclaim(owner, object);
+        return;
+    }
+
+    list->items[list->count].reclaim = reclaim;
+    list->items[list->count].owner = owner;
+    list->items[list->count].object = object;
+    ++list->count;
+}
+
+bool epochReserve(Epoch *epoch, size_t count) {
+    if (epoch == NULL)
+        return true;
+
+    unsigned int parity = atomic_load(&epoch->epoch) & 1;
+    RetiredList *current = &epoch->retired[parity];
+    RetiredList *next = &epoch->retired[parity ^ 1];
+
+    // druga tablica jest opróżniana przy przejściu do kolejnej epoki, a potem
+    // to do niej trafiają odraczane obiekty
+    if (count > SIZE_MAX - current->count ||
+        !reserveList(current, current->count + count) ||
+        !reserveList(next, count))
+        return false;
+
+    epoch->reserved = count;
+    return true;
+}
@@ -0,0 +1,145 @@
+/** @file
+ * Interfejs klasy synchronizującej jednego pisarza z wieloma czytelnikami
+ * bez blokowania czytelników, z odroczonym zwalnianiem pamięci (epokami).
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Struktura synchronizująca dostęp do danych współdzielonych przez jednego
+ * pisarza i dowolną liczbę czytelników. Opis algorytmu znajduje się w pliku
+ * epoch.c.
+ */
+struct Epoch;
+
+/**
+ * Typ @p Epoch reprezentuje strukturę @p Epoch.
+ */
+typedef struct Epoch Epoch;
+
+/**
+ * Stan czytelnika w trakcie odczytu, wypełniany przez funkcję
+ * @ref epochReadBegin.
+ */
+typedef struct EpochRead {
+    size_t stripe; ///< numer licznika czytelników, który został zwiększony
+    unsigned int parity; ///< parzystość epoki, w której czytelnik wszedł
+    unsigned int sequence; ///< numer wersji danych na początku odczytu
+    bool priority; ///< czy czytelnik poprosił pisarza o pierwszeństwo
+} EpochRead;
+
+/**
+ * Typ funkcji zwalniającej obiekt @p object należący do @p owner.
+ */
+typedef void (*EpochReclaim)(void *owner, uintptr_t object);
+
+/**
+ * Tworzy nową strukturę synchronizującą.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+Epoch *epochNew(void);
+
+/** @brief Usuwa strukturę synchronizującą.
+ * Zwalnia wszystkie obiekty oczekujące na zwolnienie, a następnie usuwa
+ * strukturę. W trakcie wywołania nie może trwać żaden odczyt. Nic nie robi,
+ * jeśli wskaźnik @p epoch ma wartość NULL.
+ * @param[in] epoch – wskaźnik na usuwaną strukturę.
+ */
+void epochDelete(Epoch *epoch);
+
+/** @brief Rozpoczyna odczyt.
+ * Czeka na koniec trwającej modyfikacji, ale nie dłużej niż trwa jej
+ * fragment między kolejnymi wywołaniami @ref epochWriteYield. Czytelnik,
+ * który czeka zbyt długo lub którego poprzednie odczyty były niespójne,
+ * wstrzymuje kolejne modyfikacje do końca odczytu, więc jego odczyt się
+ * powiedzie. Nic nie robi, jeśli wskaźnik @p epoch ma wartość NULL.
+ * @param[in, out] epoch – wskaźnik na strukturę synchronizującą;
+ * @param[out] read      – wskaźnik na stan odczytu.
+ */
+void epochReadBegin(Epoch *epoch, EpochRead *read);
+
+/** @brief Kończy odczyt.
+ * Każde wywołanie @ref epochReadBegin musi zostać zakończone wywołaniem tej
+ * funkcji. Jeśli w trakcie odczytu pisarz modyfikował dane, to odczytane
+ * dane mogą być niespójne i odczyt należy powtórzyć.
+ * @param[in, out] epoch – wskaźnik na strukturę synchronizującą;
+ * @param[in] read       – wskaźnik na stan odczytu.
+ * @return Wartość @p true, jeśli odczytane dane są spójne (w szczególności,
+ *         jeśli wskaźnik @p epoch ma wartość NULL).
+ *         Wartość @p false, jeśli odczyt należy powtórzyć.
+ */
+bool epochReadEnd(Epoch *epoch, EpochRead const *read);
+
+/**
+ * Rozpoczyna modyfikację danych, czekając najpierw na koniec odczytów
+ * czytelników, którzy poprosili o pierwszeństwo. Modyfikacje nie mogą być
+ * wykonywane jednocześnie przez kilka wątków. Nic nie robi, jeśli wskaźnik
+ * @p epoch ma wartość NULL.
+ * @param[in, out] epoch – wskaźnik na strukturę synchronizującą.
+ */
+void epochWriteBegin(Epoch *epoch);
+
+/**
+ * Kończy modyfikację danych i zwalnia te spośród oczekujących obiektów,
+ * których nie może już odczytywać żaden czytelnik. Nic nie robi, jeśli
+ * wskaźnik @p epoch ma wartość NULL.
+ * @param[in, out] epoch – wskaźnik na strukturę synchronizującą.
+ */
+void epochWriteEnd(Epoch *epoch);
+
+/** @brief Przerywa modyfikację, jeśli czekają na to czytelnicy.
+ * Jeśli któryś czytelnik poprosił o pierwszeństwo, to kończy modyfikację
+ * tak jak @ref epochWriteEnd i rozpoczyna kolejną tak jak
+ * @ref epochWriteBegin, pozwalając czytelnikom wykonać odczyty pomiędzy
+ * nimi. Długie modyfikacje powinny wywoływać tę funkcję regularnie,
+ * w chwilach, w których dane są spójne. Nic nie robi, jeśli wskaźnik
+ * @p epoch ma wartość NULL.
+ * @param[in, out] epoch – wskaźnik na strukturę synchronizującą.
+ */
+void epochWriteYield(Epoch *epoch);
+
+/** @brief Odracza zwolnienie obiektu.
+ * Odracza wywołanie @p reclaim(@p owner, @p object) do chwili, w której
+ * żaden czytelnik nie może już odczytywać obiektu. Obiekt musi być wcześniej
+ * niedostępny dla nowych czytelników. Jeśli wskaźnik @p epoch ma wartość
+ * NULL, obiekt jest zwalniany natychmiast. Jeśli nie uda się alokować
+ * pamięci (co nie zdarza się w ramach miejsc zarezerwowanych funkcją
+ * @ref epochReserve), funkcja czeka na zakończenie trwających odczytów
+ * i zwalnia obiekt natychmiast.
+ * @param[in, out] epoch – wskaźnik na strukturę synchronizującą;
+ * @param[in] reclaim    – funkcja zwalniająca obiekt;
+ * @param[in] owner      – wskaźnik przekazywany do funkcji @p reclaim;
+ * @param[in] object     – zwalniany obiekt.
+ */
+void epochRetire(Epoch *epoch, EpochReclaim reclaim, void *owner,
+                 uintptr_t object);
+
+/** @brief Rezerwuje miejsce na odraczane obiekty.
+ * Ustala liczbę zarezerwowanych miejsc na @p count (również wtedy, gdy
+ * wcześniej zarezerwowano ich więcej). Odroczenia nie zajmują
+ * zarezerwowanych miejsc, więc aby wykorzystać @p k z nich, należy
+ * najpierw zmniejszyć ich liczbę o @p k; kolejne @p k wywołań
+ * @ref epochRetire nie alokuje wtedy pamięci ani nie czeka na czytelników,
+ * nawet jeśli w międzyczasie nastąpi przejście do kolejnej epoki.
+ * Zmniejszenie liczby miejsc zawsze się udaje. Nic nie robi, jeśli
+ * wskaźnik @p epoch ma wartość NULL.
+ * @param[in, out] epoch – wskaźnik na strukturę synchronizującą;
+ * @param[in] count      – liczba zarezerwowanych miejsc.
+ * @return Wartość @p true, jeśli miejsca zostały zarezerwowane (w
+ *         szczególności, jeśli wskaźnik @p epoch ma wartość NULL).
+ *         Wartość @p false, jeśli nie udało się alokować pamięci (liczba
+ *         zarezerwowanych miejsc się wtedy nie zmienia).
+ */
+bool epochReserve(Epoch *epoch, size_t count);
+
+#endif /* EPOCH_H */
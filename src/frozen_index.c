@@ -0,0 +1,864 @@
+/** @file
+ * Implementacja klasy implementującej niemodyfikowalny, spłaszczony obraz
+ * drzew struktury PhoneForward.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+// odwzorowanie plików w pamięci wymaga interfejsu POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "frozen_index.h"
+#include "phone_numbers.h"
+#include "reverse_cursor.h"
+
+/**
+ * Indeks oznaczający brak węzła obrazu.
+ */
+#define FROZEN_NULL UINT32_MAX
+
+/**
+ * Struktura reprezentująca węzeł obrazu drzewa. Węzły każdego drzewa
+ * ułożone są w kolejności przeszukiwania wszerz, więc synowie węzła zajmują
+ * spójny fragment tablicy węzłów, uporządkowany według cyfr. Syn
+ * odpowiadający cyfrze @p d ma indeks równy sumie indeksu węzła, odległości
+ * @p firstChild i liczby synów odpowiadających cyfrom mniejszym niż @p d.
+ */
+typedef struct FrozenNode {
+    uint32_t label; /**< etykieta krawędzi prowadzącej od ojca do węzła,
+                    zakodowana tak jak w węźle drzewa trie */
+    uint32_t firstChild; ///< odległość od węzła do jego pierwszego syna
+    uint32_t firstRef; /**< indeks pierwszego odwołania węzła; odwołania
+                       węzła kończą się przed pierwszym odwołaniem węzła
+                       następującego po nim w tablicy */
+    uint16_t childMask; /**< maska bitowa, której @p d-ty bit jest
+                        ustawiony, jeśli węzeł ma syna odpowiadającego
+                        cyfrze @p d */
+    uint16_t padding; /**< zawsze 0, aby zapisywany do pliku obraz nie
+                      zawierał nieokreślonych bajtów */
+} FrozenNode;
+
+_Static_assert(sizeof(FrozenNode) == 16,
+               "węzeł obrazu powinien zajmować 16 bajtów");
+
+/**
+ * Struktura reprezentująca odwołanie do numeru przechowywanego w węźle
+ * obrazu. Węzeł drzewa przekierowań ma co najwyżej jedno odwołanie – do
+ * numeru, na który jest przekierowany. Węzeł drzewa odwrotności
+ * przekierowań ma po jednym odwołaniu dla każdego numeru, który został na
+ * niego przekierowany.
+ */
+typedef struct FrozenRef {
+    uint32_t string; ///< położenie numeru w tablicy znaków obrazu
+    uint32_t node; /**< w drzewie odwrotności przekierowań indeks węzła
+                   drzewa przekierowań odpowiadającego numerowi, w drzewie
+                   przekierowań @ref FROZEN_NULL */
+} FrozenRef;
+
+/**
+ * Struktura przechowująca obraz drzew. Bezpośrednio za nią, w tym samym
+ * bloku pamięci, znajdują się kolejno: tablica węzłów (najpierw drzewa
+ * przekierowań z korzeniem o indeksie 0, potem drzewa odwrotności
+ * przekierowań, a na końcu węzeł-wartownik wyznaczający koniec odwołań
+ * ostatniego węzła), tablica odwołań i tablica znaków zakończonych znakami
+ * '\0' numerów. Obraz odwołuje się do swoich elementów wyłącznie przez
+ * indeksy, więc tablice można zapisać do pliku i odczytywać bezpośrednio
+ * z jego odwzorowania w pamięci – wtedy struktura wskazuje na tablice
+ * w odwzorowaniu.
+ */
+struct FrozenIndex {
+    size_t nodeCount; ///< liczba węzłów obu drzew (bez wartownika)
+    size_t refCount; ///< liczba odwołań
+    size_t charCount; ///< liczba znaków w tablicy znaków
+    uint32_t rootReverse; ///< indeks korzenia drzewa odwrotności
+    FrozenNode *nodes; ///< tablica węzłów
+    FrozenRef *refs; ///< tablica odwołań
+    char *chars; ///< tablica znaków
+    void *mapping; /**< odwzorowanie pliku, w którym znajdują się tablice,
+                   lub NULL, jeśli znajdują się one za strukturą */
+    size_t mappingSize; ///< rozmiar odwzorowania pliku
+};
+
+/**
+ * Nagłówek pliku z obrazem drzew. Za nagłówkiem znajdują się kolejno
+ * tablica węzłów (wraz z wartownikiem), tablica odwołań i tablica znaków
+ * uzupełniona zerami do wielokrotności 8 bajtów. Liczby zapisane są
+ * w porządku bajtów komputera, który zapisał plik; plik zapisany na
+ * komputerze o innym porządku bajtów jest odrzucany.
+ */
+typedef struct FrozenFileHeader {
+    char magic[8]; ///< napis identyfikujący format pliku
+    uint32_t version; ///< wersja formatu pliku
+    uint32_t byteOrder; ///< liczba @ref FROZEN_BYTE_ORDER
+    uint64_t nodeCount; ///< liczba węzłów obu drzew (bez wartownika)
+    uint64_t refCount; ///< liczba odwołań
+    uint64_t charCount; ///< liczba znaków w tablicy znaków
+    uint64_t checksum; ///< suma kontrolna tablic zapisanych za nagłówkiem
+    uint32_t rootReverse; ///< indeks korzenia drzewa odwrotności
+    uint32_t padding; ///< zawsze 0
+} FrozenFileHeader;
+
+_Static_assert(sizeof(FrozenFileHeader) % 8 == 0,
+               "tablice obrazu w pliku powinny być wyrównane do 8 bajtów");
+
+/**
+ * Napis identyfikujący format pliku z obrazem drzew.
+ */
+#define FROZEN_MAGIC "PHFWDIMG"
+
+/**
+ * Wersja formatu pliku z obrazem drzew.
+ */
+#define FROZEN_VERSION 1
+
+/**
+ * Liczba, której zapis pozwala rozpoznać porządek bajtów pliku.
+ */
+#define FROZEN_BYTE_ORDER 0x01020304u
+
+/**
+ * Wyznacza syna węzła obrazu odpowiadającego danej cyfrze.
+ * @param[in] index – wskaźnik na obraz drzew;
+ * @param[in] node  – indeks węzła;
+ * @param[in] digit – wartość cyfry.
+ * @return Indeks syna lub @ref FROZEN_NULL, jeśli taki syn nie istnieje.
+ */
+static uint32_t childAt(FrozenIndex const *index, uint32_t node,
+                        unsigned int digit) {
+    FrozenNode const *current = &index->nodes[node];
+
+    if (((current->childMask >> digit) & 1) == 0)
+        return FROZEN_NULL;
+
+    unsigned int lower = current->childMask & ((1u << digit) - 1);
+    return node + current->firstChild + (uint32_t) __builtin_popcount(lower);
+}
+
+/**
+ * Sprawdza, czy węzeł obrazu nie ma odwołań.
+ * @param[in] index – wskaźnik na obraz drzew;
+ * @param[in] node  – indeks węzła.
+ * @return Wartość @p true, jeśli węzeł nie ma odwołań.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool isEmpty(FrozenIndex const *index, uint32_t node) {
+    return index->nodes[node].firstRef == index->nodes[node + 1].firstRef;
+}
+
+/**
+ * Znajduje pierwszy niepusty węzeł obrazu odpowiadający fragmentowi numeru.
+ * Działa tak samo jak funkcja @ref trieFindNextNonEmpty.
+ * @param[in] index          – wskaźnik na obraz drzew;
+ * @param[in] node           – indeks węzła;
+ * @param[in] num            – wskaźnik na napis reprezentujący numer;
+ * @param[in, out] currIndex – wskaźnik na aktualny indeks @p num.
+ * @return Indeks znalezionego węzła lub @ref FROZEN_NULL, jeśli taki nie
+ *         istnieje.
+ */
+static uint32_t findNextNonEmpty(FrozenIndex const *index, uint32_t node,
+                                 char const *num, size_t *currIndex) {
+    size_t i = *currIndex;
+    uint32_t current = node;
+
+    while (num[i] != '\0') {
+        current = childAt(index, current, charToDigit(num[i]));
+        if (current == FROZEN_NULL)
+            return FROZEN_NULL;
+
+        uint32_t label = index->nodes[current].label;
+        unsigned int length = labelLength(label);
+        if (labelMatch(label, num + i) < length)
+            return FROZEN_NULL;
+
+        i += length;
+        if (!isEmpty(index, current)) {
+            *currIndex = i;
+            return current;
+        }
+    }
+
+    return FROZEN_NULL;
+}
+
+/**
+ * Zapisuje do tablicy @p order indeksy węzłów drzewa o korzeniu @p root
+ * w kolejności przeszukiwania wszerz, odwiedzając synów według cyfr.
+ * @param[in] ctx    – wskaźnik na pule pamięci drzewa;
+ * @param[in] root   – indeks korzenia drzewa;
+ * @param[out] order – tablica na indeksy węzłów.
+ * @return Liczba węzłów drzewa.
+ */
+static size_t breadthFirst(TrieContext const *ctx, PoolIndex root,
+                           PoolIndex *order) {
+    size_t count = 1;
+    order[0] = root;
+
+    // tablica order jest jednocześnie kolejką przeszukiwania
+    for (size_t k = 0; k < count; ++k) {
+        for (unsigned int digit = 0; digit < 12; ++digit) {
+            PoolIndex child = getChild(ctx, order[k], digit);
+            if (child != POOL_NULL)
+                order[count++] = child;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Wypełnia węzeł obrazu (poza odwołaniami) na podstawie węzła drzewa.
+ * @param[out] node          – wskaźnik na węzeł obrazu;
+ * @param[in] ctx            – wskaźnik na pule pamięci drzewa;
+ * @param[in] source         – indeks węzła drzewa;
+ * @param[in] position       – indeks węzła obrazu;
+ * @param[in, out] nextChild – wskaźnik na indeks, który otrzyma pierwszy syn
+ *                             węzła; zwiększany o liczbę synów.
+ */
+static void fillNode(FrozenNode *node, TrieContext const *ctx,
+                     PoolIndex source, size_t position, size_t *nextChild) {
+    node->label = getLabel(ctx, source);
+    node->firstChild = (uint32_t) (*nextChild - position);
+    node->childMask = 0;
+    node->padding = 0;
+
+    for (unsigned int digit = 0; digit < 12; ++digit) {
+        if (getChild(ctx, source, digit) != POOL_NULL) {
+            node->childMask |= (uint16_t) (1u << digit);
+            ++*nextChild;
+        }
+    }
+}
+
+/**
+ * Kopiuje napis na koniec tablicy znaków obrazu.
+ * @param[in, out] index – wskaźnik na obraz drzew;
+ * @param[in] string     – wskaźnik na kopiowany napis.
+ * @return Położenie kopii napisu w tablicy znaków.
+ */
+static uint32_t appendString(FrozenIndex *index, char const *string) {
+    size_t length = strlen(string) + 1;
+    uint32_t position = (uint32_t) index->charCount;
+
+    memcpy(index->chars + index->charCount, string, length);
+    index->charCount += length;
+    return position;
+}
+
+/**
+ * Wypełnia obraz drzew. Obraz musi mieć zaalokowane tablice o rozmiarach
+ * wyznaczonych przez funkcję @ref frozenNew.
+ * @param[in, out] index  – wskaźnik na obraz drzew;
+ * @param[in] ctx         – wskaźnik na pule pamięci drzew;
+ * @param[in] order       – indeksy węzłów obu drzew w kolejności
+ *                          przeszukiwania wszerz;
+ * @param[in] fwdCount    – liczba węzłów drzewa przekierowań;
+ * @param[in] fwdRefCount – liczba przekierowanych węzłów;
+ * @param[in] position    – tablica indeksów węzłów obrazu odpowiadających
+ *                          węzłom drzewa przekierowań;
+ * @param[out] target     – tablica na położenia numerów, na które
+ *                          przekierowane są węzły drzewa przekierowań.
+ */
+static void fillIndex(FrozenIndex *index, TrieContext const *ctx,
+                      PoolIndex const *order, size_t fwdCount,
+                      size_t fwdRefCount, uint32_t const *position,
+                      uint32_t *target) {
+    // najpierw drzewo odwrotności przekierowań, bo położenia numerów, na
+    // które przekierowane są węzły, wyznaczane są przy kopiowaniu tablic
+    size_t nextChild = fwdCount + 1;
+    size_t ref = fwdRefCount;
+    for (size_t k = fwdCount; k < index->nodeCount; ++k) {
+        FrozenNode *node = &index->nodes[k];
+        fillNode(node, ctx, order[k], k, &nextChild);
+        node->firstRef = (uint32_t) ref;
+
+        SourceArray const *sources = getSources(ctx, order[k]);
+        if (sources == NULL)
+            continue;
+
+        // napis target jest wspólny dla wszystkich elementów tablicy
+        uint32_t fwdNumber = appendString(index, sourceArrayTarget(sources));
+        size_t length = sourceArrayLength(sources);
+        for (size_t s = 0; s < length; ++s) {
+            PoolIndex key = sourceArrayNode(sources, s);
+
+            target[key] = fwdNumber;
+            index->refs[ref].string =
+                    appendString(index, sourceArraySource(sources, s));
+            index->refs[ref].node = position[key];
+            ++ref;
+        }
+    }
+
+    nextChild = 1;
+    ref = 0;
+    for (size_t k = 0; k < fwdCount; ++k) {
+        FrozenNode *node = &index->nodes[k];
+        fillNode(node, ctx, order[k], k, &nextChild);
+        node->firstRef = (uint32_t) ref;
+
+        if (getFwdNode(ctx, order[k]) != POOL_NULL) {
+            index->refs[ref].string = target[order[k]];
+            index->refs[ref].node = FROZEN_NULL;
+            ++ref;
+        }
+    }
+
+    FrozenNode *sentinel = &index->nodes[index->nodeCount];
+    sentinel->label = 0;
+    sentinel->firstChild = 0;
+    sentinel->firstRef = (uint32_t) index->refCount;
+    sentinel->childMask = 0;
+    sentinel->padding = 0;
+}
+
+FrozenIndex *frozenNew(TrieContext const *ctx, PoolIndex rootFwd,
+                       PoolIndex rootReverse) {
+    // pula węzłów jest wspólna dla obu drzew, więc jej rozmiar ogranicza
+    // łączną liczbę ich węzłów
+    size_t poolSize = (size_t) ctx->nodePool->allocated + 1;
+    PoolIndex *order = malloc(poolSize * sizeof(PoolIndex));
+    uint32_t *position = malloc(poolSize * sizeof(uint32_t));
+    uint32_t *target = malloc(poolSize * sizeof(uint32_t));
+    FrozenIndex *index = NULL;
+
+    if (order != NULL && position != NULL && target != NULL) {
+        size_t fwdCount = breadthFirst(ctx, rootFwd, order);
+        size_t nodeCount = fwdCount +
+                           breadthFirst(ctx, rootReverse, order + fwdCount);
+
+        for (size_t k = 0; k < fwdCount; ++k)
+            position[order[k]] = (uint32_t) k;
+
+        size_t fwdRefCount = 0;
+        for (size_t k = 0; k < fwdCount; ++k)
+            if (getFwdNode(ctx, order[k]) != POOL_NULL)
+                ++fwdRefCount;
+
+        size_t refCount = fwdRefCount;
+        size_t charCount = 0;
+        for (size_t k = fwdCount; k < nodeCount; ++k) {
+            SourceArray const *sources = getSources(ctx, order[k]);
+            if (sources == NULL)
+                continue;
+
+            charCount += strlen(sourceArrayTarget(sources)) + 1;
+            size_t length = sourceArrayLength(sources);
+            for (size_t s = 0; s < length; ++s)
+                charCount += strlen(sourceArraySource(sources, s)) + 1;
+            refCount += length;
+        }
+
+        // położenia napisów przechowywane są na 32 bitach
+        if (charCount <= UINT32_MAX)
+            index = malloc(sizeof(struct FrozenIndex) +
+                           (nodeCount + 1) * sizeof(FrozenNode) +
+                           refCount * sizeof(FrozenRef) + charCount);
+
+        if (index != NULL) {
+            index->nodeCount = nodeCount;
+            index->refCount = refCount;
+            index->charCount = 0;
+            index->rootReverse = (uint32_t) fwdCount;
+            index->nodes = (FrozenNode *) (index + 1);
+            index->refs = (FrozenRef *) (index->nodes + nodeCount + 1);
+            index->chars = (char *) (index->refs + refCount);
+            index->mapping = NULL;
+            index->mappingSize = 0;
+
+            fillIndex(index, ctx, order, fwdCount, fwdRefCount, position,
+                      target);
+        }
+    }
+
+    free(order);
+    free(position);
+    free(target);
+    return index;
+}
+
+void frozenDelete(FrozenIndex *index) {
+    if (index != NULL && index->mapping != NULL)
+        munmap(index->mapping, index->mappingSize);
+    free(index);
+}
+
+/**
+ * Początkowa wartość sumy kontrolnej.
+ */
+#define CHECKSUM_BASIS UINT64_C(14695981039346656037)
+
+/**
+ * Rozszerza sumę kontrolną o blok pamięci.
+ * @param[in] hash – suma kontrolna poprzedzających danych;
+ * @param[in] data – wskaźnik na początek bloku;
+ * @param[in] size – rozmiar bloku w bajtach, podzielny przez 8.
+ * @return Suma kontrolna danych rozszerzonych o blok.
+ */
+static uint64_t checksum(uint64_t hash, void const *data, size_t size) {
+    // przetwarzamy po 8 bajtów naraz, mieszając bity po każdym kroku
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t word;
+        memcpy(&word, (unsigned char const *) data + i, sizeof(word));
+
+        hash = (hash ^ word) * UINT64_C(1099511628211);
+        hash ^= hash >> 32;
+    }
+
+    return hash;
+}
+
+/**
+ * Wyznacza rozmiar tablicy znaków obrazu uzupełnionej do wielokrotności
+ * 8 bajtów.
+ * @param[in] charCount – liczba znaków.
+ * @return Rozmiar uzupełnionej tablicy.
+ */
+static size_t paddedChars(size_t charCount) {
+    return (charCount + 7) / 8 * 8;
+}
+
+/**
+ * Wyznacza sumę kontrolną pliku obrazu. Obejmuje ona cały nagłówek
+ * z wyzerowanym polem sumy kontrolnej, więc chroni też liczności tablic.
+ * @param[in] header – wskaźnik na nagłówek pliku;
+ * @param[in] data   – wskaźnik na tablice zapisane za nagłówkiem;
+ * @param[in] size   – rozmiar tablic w bajtach.
+ * @return Suma kontrolna pliku.
+ */
+static uint64_t fileChecksum(FrozenFileHeader const *header,
+                             void const *data, size_t size) {
+    FrozenFileHeader copy = *header;
+    copy.checksum = 0;
+
+    return checksum(checksum(CHECKSUM_BASIS, &copy, sizeof(copy)), data,
+                    size);
+}
+
+/**
+ * Zapisuje obraz drzew (bez nagłówka) do bufora.
+ * @param[in] index – wskaźnik na obraz drzew;
+ * @param[out] data – wskaźnik na bufor o rozmiarze co najmniej takim, jak
+ *                    rozmiar tablic obrazu z uzupełnioną tablicą znaków.
+ * @return Liczba zapisanych bajtów.
+ */
+static size_t serialize(FrozenIndex const *index, unsigned char *data) {
+    size_t nodeBytes = (index->nodeCount + 1) * sizeof(FrozenNode);
+    size_t refBytes = index->refCount * sizeof(FrozenRef);
+    size_t charBytes = paddedChars(index->charCount);
+
+    memcpy(data, index->nodes, nodeBytes);
+    memcpy(data + nodeBytes, index->refs, refBytes);
+    memcpy(data + nodeBytes + refBytes, index->chars, index->charCount);
+    memset(data + nodeBytes + refBytes + index->charCount, 0,
+           charBytes - index->charCount);
+
+    return nodeBytes + refBytes + charBytes;
+}
+
+/**
+ * Utrwala wpis pliku w katalogu, który go zawiera, tak aby zmiana nazwy
+ * pliku przetrwała awarię systemu.
+ * @param[in] path – wskaźnik na napis reprezentujący ścieżkę pliku.
+ * @return Wartość @p true, jeśli katalog został utrwalony.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool syncParentDirectory(char const *path) {
+    char const *slash = strrchr(path, '/');
+    size_t length = slash == NULL ? 1 : (size_t) (slash - path);
+    char *directory = malloc(length + 1);
+
+    if (directory == NULL)
+        return false;
+
+    if (slash == NULL)
+        directory[0] = '.';
+    else if (length == 0)
+        directory[length++] = '/';
+    else
+        memcpy(directory, path, length);
+    directory[length] = '\0';
+
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    free(directory);
+    if (fd < 0)
+        return false;
+
+    bool result = fsync(fd) == 0;
+    return close(fd) == 0 && result;
+}
+
+bool frozenSave(FrozenIndex const *index, char const *path) {
+    size_t pathLength = strlen(path);
+    size_t size = (index->nodeCount + 1) * sizeof(FrozenNode) +
+                  index->refCount * sizeof(FrozenRef) +
+                  paddedChars(index->charCount);
+    char *tmpPath = malloc(pathLength + sizeof(".XXXXXX"));
+    unsigned char *data = malloc(size);
+    bool result = false;
+
+    if (tmpPath != NULL && data != NULL) {
+        FrozenFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, FROZEN_MAGIC, sizeof(header.magic));
+        header.version = FROZEN_VERSION;
+        header.byteOrder = FROZEN_BYTE_ORDER;
+        header.nodeCount = index->nodeCount;
+        header.refCount = index->refCount;
+        header.charCount = index->charCount;
+        header.rootReverse = index->rootReverse;
+        header.checksum = fileChecksum(&header, data,
+                                       serialize(index, data));
+
+        // zapisujemy do pliku tymczasowego o niepowtarzalnej nazwie
+        // i podmieniamy plik docelowy, więc procesy, które odwzorowały
+        // poprzednią wersję, nadal widzą spójny obraz, a równoczesne zapisy
+        // nie nadpisują nawzajem swoich plików tymczasowych
+        memcpy(tmpPath, path, pathLength);
+        memcpy(tmpPath + pathLength, ".XXXXXX", sizeof(".XXXXXX"));
+
+        int fd = mkstemp(tmpPath);
+        FILE *file = NULL;
+        if (fd >= 0) {
+            // mkstemp tworzy plik dostępny tylko dla właściciela, a obraz
+            // odwzorowują też inne procesy
+            file = fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == 0
+                   ? fdopen(fd, "wb") : NULL;
+            if (file == NULL) {
+                close(fd);
+                remove(tmpPath);
+            }
+        }
+
+        if (file != NULL) {
+            bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                           fwrite(data, 1, size, file) == size &&
+                           fflush(file) == 0 && fsync(fileno(file)) == 0;
+
+            if (fclose(file) == 0 && written)
+                result = rename(tmpPath, path) == 0;
+            if (!result)
+                remove(tmpPath);
+            else
+                result = syncParentDirectory(path);
+        }
+    }
+
+    free(tmpPath);
+    free(data);
+    return result;
+}
+
+/**
+ * Sprawdza, czy nagłówek pliku opisuje obraz drzew o rozmiarze zgodnym
+ * z rozmiarem pliku.
+ * @param[in] header   – wskaźnik na nagłówek pliku;
+ * @param[in] fileSize – rozmiar pliku w bajtach.
+ * @return Wartość @p true, jeśli nagłówek jest poprawny.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool validHeader(FrozenFileHeader const *header, size_t fileSize) {
+    if (memcmp(header->magic, FROZEN_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != FROZEN_VERSION ||
+        header->byteOrder != FROZEN_BYTE_ORDER)
+        return false;
+
+    // indeksy węzłów i położenia napisów przechowywane są na 32 bitach
+    if (header->nodeCount == 0 || header->nodeCount >= UINT32_MAX ||
+        header->refCount > UINT32_MAX || header->charCount > UINT32_MAX ||
+        header->rootReverse >= header->nodeCount)
+        return false;
+
+    uint64_t size = sizeof(FrozenFileHeader) +
+                    (header->nodeCount + 1) * sizeof(FrozenNode) +
+                    header->refCount * sizeof(FrozenRef) +
+                    paddedChars(header->charCount);
+    return size == fileSize;
+}
+
+FrozenIndex *frozenOpen(char const *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    size_t size = 0;
+
+    if (fstat(fd, &info) == 0 &&
+        info.st_size >= (off_t) sizeof(FrozenFileHeader) &&
+        (uintmax_t) info.st_size <= SIZE_MAX) {
+        size = (size_t) info.st_size;
+        mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // odwzorowanie pozostaje ważne po zamknięciu pliku
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+        return NULL;
+
+    FrozenFileHeader const *header = mapping;
+    unsigned char const *data = (unsigned char const *) (header + 1);
+    FrozenIndex *index = NULL;
+
+    if (validHeader(header, size) &&
+        fileChecksum(header, data, size - sizeof(FrozenFileHeader)) ==
+        header->checksum)
+        index = malloc(sizeof(struct FrozenIndex));
+
+    if (index == NULL) {
+        munmap(mapping, size);
+        return NULL;
+    }
+
+    // tablice są tylko odczytywane, więc rzutowanie usuwające const jest
+    // bezpieczne
+    index->nodeCount = (size_t) header->nodeCount;
+    index->refCount = (size_t) header->refCount;
+    index->charCount = (size_t) header->charCount;
+    index->rootReverse = header->rootReverse;
+    index->nodes = (FrozenNode *) data;
+    index->refs = (FrozenRef *) (index->nodes + index->nodeCount + 1);
+    index->chars = (char *) (index->refs + index->refCount);
+    index->mapping = mapping;
+    index->mappingSize = size;
+
+    if (index->nodes[index->nodeCount].firstRef != index->refCount) {
+        frozenDelete(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+bool frozenIsMapped(FrozenIndex const *index) {
+    return index->mapping != NULL;
+}
+
+size_t frozenSize(FrozenIndex const *index) {
+    if (index->mapping != NULL)
+        return sizeof(struct FrozenIndex) + index->mappingSize;
+
+    return sizeof(struct FrozenIndex) +
+           (index->nodeCount + 1) * sizeof(FrozenNode) +
+           index->refCount * sizeof(FrozenRef) + index->charCount;
+}
+
+size_t frozenPairCount(FrozenIndex const *index) {
+    // każde odwołanie drzewa odwrotności przekierowań odpowiada jednemu
+    // przekierowaniu, a odwołania drzewa przekierowań poprzedzają je
+    return index->refCount - index->nodes[index->rootReverse].firstRef;
+}
+
+void frozenPairs(FrozenIndex const *index, PhoneForwardPair *pairs) {
+    size_t count = 0;
+
+    for (size_t r = index->nodes[index->rootReverse].firstRef;
+         r < index->refCount; ++r) {
+        FrozenRef const *ref = &index->refs[r];
+        FrozenNode const *fwd = &index->nodes[ref->node];
+
+        pairs[count].num1 = index->chars + ref->string;
+        pairs[count].num2 = index->chars + index->refs[fwd->firstRef].string;
+        ++count;
+    }
+}
+
+char const *frozenForwardedPrefix(FrozenIndex const *index, char const *num,
+                                  size_t *length) {
+    size_t i = 0;
+
+    uint32_t maxPrefix = FROZEN_NULL;
+    uint32_t maxCandidate = findNextNonEmpty(index, 0, num, &i);
+
+    while (maxCandidate != FROZEN_NULL) {
+        maxPrefix = maxCandidate;
+        maxCandidate = findNextNonEmpty(index, maxPrefix, num, &i);
+    }
+
+    if (maxPrefix == FROZEN_NULL) {
+        *length = 0;
+        return "";
+    }
+
+    *length = i;
+    return index->chars + index->refs[index->nodes[maxPrefix].firstRef].string;
+}
+
+PhoneNumbers *frozenReverse(FrozenIndex const *index, char const *num) {
+    PhoneNumbers *result = phnumNew();
+
+    // dodajemy numer num do wyniku
+    if (!phnumSafeAdd(result, num, "", 0))
+        return NULL;
+
+    size_t i = 0;
+    uint32_t currPrefix = findNextNonEmpty(index, index->rootReverse, num, &i);
+
+    while (currPrefix != FROZEN_NULL) {
+        uint32_t end = index->nodes[currPrefix + 1].firstRef;
+
+        for (uint32_t r = index->nodes[currPrefix].firstRef; r < end; ++r) {
+            char const *source = index->chars + index->refs[r].string;
+
+            if (!phnumSafeAdd(result, num, source, i))
+                return NULL;
+        }
+
+        currPrefix = findNextNonEmpty(index, currPrefix, num, &i);
+    }
+
+    if (!phnumSort(result)) {
+        phnumDelete(result);
+        return NULL;
+    }
+    phnumRemoveDuplicates(result);
+    return result;
+}
+
+PhoneNumbers *frozenGetReverse(FrozenIndex const *index, char const *num) {
+    size_t i = 0;
+    PhoneNumbers *result = phnumNew();
+    if (result == NULL)
+        return NULL;
+
+    // sprawdzamy, czy numer num został przekierowany i jeśli nie,
+    // to dodajemy go do wyniku
+    if (findNextNonEmpty(index, 0, num, &i) == FROZEN_NULL) {
+        if (!phnumSafeAdd(result, num, "", 0))
+            return NULL;
+    }
+
+    i = 0;
+    uint32_t currPrefix = findNextNonEmpty(index, index->rootReverse, num, &i);
+
+    while (currPrefix != FROZEN_NULL) {
+        uint32_t end = index->nodes[currPrefix + 1].firstRef;
+
+        for (uint32_t r = index->nodes[currPrefix].firstRef; r < end; ++r) {
+            FrozenRef const *ref = &index->refs[r];
+            size_t j = i;
+
+            // sprawdzamy, czy numer nie został dalej przekierowany i jeśli
+            // nie, to dodajemy go do wyniku
+            if (findNextNonEmpty(index, ref->node, num, &j) == FROZEN_NULL) {
+                if (!phnumSafeAdd(result, num, index->chars + ref->string, i))
+                    return NULL;
+            }
+        }
+
+        currPrefix = findNextNonEmpty(index, currPrefix, num, &i);
+    }
+
+    if (!phnumSort(result)) {
+        phnumDelete(result);
+        return NULL;
+    }
+    return result;
+}
+
+bool frozenCollectReverse(FrozenIndex const *index, char const *num,
+                          bool unforwarded, PhfwdReverseCursor *cursor) {
+    size_t i = 0;
+
+    if (!unforwarded || findNextNonEmpty(index, 0, num, &i) == FROZEN_NULL) {
+        if (!reverseCursorAdd(cursor, "", 0))
+            return false;
+    }
+
+    i = 0;
+    uint32_t currPrefix = findNextNonEmpty(index, index->rootReverse, num, &i);
+
+    while (currPrefix != FROZEN_NULL) {
+        uint32_t end = index->nodes[currPrefix + 1].firstRef;
+
+        for (uint32_t r = index->nodes[currPrefix].firstRef; r < end; ++r) {
+            FrozenRef const *ref = &index->refs[r];
+            size_t j = i;
+
+            if (unforwarded &&
+                findNextNonEmpty(index, ref->node, num, &j) != FROZEN_NULL)
+                continue;
+
+            if (!reverseCursorAdd(cursor, index->chars + ref->string, i))
+                return false;
+        }
+
+        currPrefix = findNextNonEmpty(index, currPrefix, num, &i);
+    }
+
+    return true;
+}
+
+/** @brief Sprawdza, czy numer wyniku powtarza się w wyniku zapytania.
+ * Sprawdza, czy numer powstały z numeru @p num przez zastąpienie jego
+ * pierwszych @p i cyfr numerem węzła @p node drzewa przekierowań powstaje
+ * też z przekierowania dłuższego prefiksu – potomka węzła @p node
+ * przedłużonego o cyfry @p num od @p i do @p j, który przekierowano na
+ * pierwsze @p j cyfr @p num.
+ * @param[in] index – wskaźnik na obraz drzew;
+ * @param[in] node  – indeks przekierowanego węzła drzewa przekierowań;
+ * @param[in] num   – wskaźnik na napis reprezentujący numer;
+ * @param[in] i     – długość prefiksu @p num, na który przekierowano węzeł.
+ * @return Wartość @p true, jeśli taki potomek istnieje.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool hasEquivalentDescendant(FrozenIndex const *index, uint32_t node,
+                                    char const *num, size_t i) {
+    size_t j = i;
+    uint32_t current = findNextNonEmpty(index, node, num, &j);
+
+    while (current != FROZEN_NULL) {
+        FrozenRef const *ref = &index->refs[index->nodes[current].firstRef];
+        char const *target = index->chars + ref->string;
+
+        if (strncmp(target, num, j) == 0 && target[j] == '\0')
+            return true;
+
+        current = findNextNonEmpty(index, current, num, &j);
+    }
+
+    return false;
+}
+
+size_t frozenReverseCount(FrozenIndex const *index, char const *num,
+                          bool unforwarded) {
+    size_t i = 0;
+    size_t count = 0;
+
+    if (!unforwarded || findNextNonEmpty(index, 0, num, &i) == FROZEN_NULL)
+        ++count;
+
+    i = 0;
+    uint32_t currPrefix = findNextNonEmpty(index, index->rootReverse, num, &i);
+
+    while (currPrefix != FROZEN_NULL) {
+        uint32_t end = index->nodes[currPrefix + 1].firstRef;
+
+        for (uint32_t r = index->nodes[currPrefix].firstRef; r < end; ++r) {
+            uint32_t node = index->refs[r].node;
+            size_t j = i;
+
+            // przekierowania liścia nic nie przesłania i nie powtarza
+            if (index->nodes[node].childMask == 0 ||
+                (unforwarded
+                 ? findNextNonEmpty(index, node, num, &j) == FROZEN_NULL
+                 : !hasEquivalentDescendant(index, node, num, i)))
+                ++count;
+        }
+
+        currPrefix = findNextNonEmpty(index, currPrefix, num, &i);
+    }
+
+    return count;
+}
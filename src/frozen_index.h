@@ -0,0 +1,171 @@
+/** @file
+ * Interfejs klasy implementującej niemodyfikowalny, spłaszczony obraz drzew
+ * struktury PhoneForward, na którym wykonywane są zapytania po wywołaniu
+ * funkcji @ref phfwdFreeze.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef FROZEN_INDEX_H
+#define FROZEN_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "phone_forward.h"
+#include "trie.h"
+
+/**
+ * Struktura przechowująca obraz drzewa przekierowań i drzewa odwrotności
+ * przekierowań. Opis jej budowy znajduje się w pliku frozen_index.c.
+ */
+struct FrozenIndex;
+
+/**
+ * Typ @p FrozenIndex reprezentuje strukturę @p FrozenIndex.
+ */
+typedef struct FrozenIndex FrozenIndex;
+
+/** @brief Tworzy obraz drzew.
+ * Tworzy obraz drzewa przekierowań o korzeniu @p rootFwd i drzewa
+ * odwrotności przekierowań o korzeniu @p rootReverse. Obraz nie odwołuje się
+ * do drzew, więc pozostaje ważny po ich usunięciu, ale nie uwzględnia ich
+ * późniejszych modyfikacji.
+ * @param[in] ctx         – wskaźnik na pule pamięci drzew;
+ * @param[in] rootFwd     – indeks korzenia drzewa przekierowań;
+ * @param[in] rootReverse – indeks korzenia drzewa odwrotności przekierowań.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci lub napisy przechowywane w drzewach są zbyt
+ *         długie, aby ich położenia mieściły się w 32 bitach.
+ */
+FrozenIndex *frozenNew(TrieContext const *ctx, PoolIndex rootFwd,
+                       PoolIndex rootReverse);
+
+/**
+ * Usuwa obraz drzew (wraz z odwzorowaniem pliku, z którego został
+ * wczytany). Nic nie robi, jeśli wskaźnik @p index ma wartość NULL.
+ * @param[in] index – wskaźnik na usuwaną strukturę.
+ */
+void frozenDelete(FrozenIndex *index);
+
+/** @brief Zapisuje obraz drzew do pliku.
+ * Zapisuje obraz wraz z nagłówkiem zawierającym wersję formatu i sumę
+ * kontrolną. Plik jest najpierw zapisywany i utrwalany pod niepowtarzalną
+ * nazwą utworzoną z @p path przez dodanie przyrostka ".XXXXXX" (zob.
+ * mkstemp), a następnie podmieniany, po czym utrwalany jest katalog, który
+ * go zawiera.
+ * @param[in] index – wskaźnik na obraz drzew;
+ * @param[in] path  – wskaźnik na napis reprezentujący ścieżkę pliku.
+ * @return Wartość @p true, jeśli obraz został zapisany.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci lub zapisać
+ *         pliku. Jeśli nie udało się jedynie utrwalić katalogu, plik
+ *         @p path zawiera już nowy obraz.
+ */
+bool frozenSave(FrozenIndex const *index, char const *path);
+
+/** @brief Wczytuje obraz drzew z pliku.
+ * Odwzorowuje plik zapisany przez funkcję @ref frozenSave w pamięci (tylko
+ * do odczytu) i tworzy obraz, którego tablice znajdują się w odwzorowaniu.
+ * Sprawdza nagłówek i sumę kontrolną pliku.
+ * @param[in] path – wskaźnik na napis reprezentujący ścieżkę pliku.
+ * @return Wskaźnik na obraz drzew lub NULL, jeśli nie udało się odczytać
+ *         pliku, plik jest niepoprawny lub nie udało się alokować pamięci.
+ */
+FrozenIndex *frozenOpen(char const *path);
+
+/**
+ * Sprawdza, czy obraz drzew został wczytany z pliku.
+ * @param[in] index – wskaźnik na obraz drzew.
+ * @return Wartość @p true, jeśli obraz został wczytany z pliku.
+ *         Wartość @p false, jeśli obraz został utworzony z drzew.
+ */
+bool frozenIsMapped(FrozenIndex const *index);
+
+/**
+ * Wyznacza rozmiar pamięci zajmowanej przez obraz drzew (wraz
+ * z odwzorowaniem pliku, z którego został wczytany).
+ * @param[in] index – wskaźnik na obraz drzew.
+ * @return Rozmiar obrazu w bajtach.
+ */
+size_t frozenSize(FrozenIndex const *index);
+
+/**
+ * Wyznacza liczbę przekierowań zapisanych w obrazie drzew.
+ * @param[in] index – wskaźnik na obraz drzew.
+ * @return Liczba przekierowań.
+ */
+size_t frozenPairCount(FrozenIndex const *index);
+
+/** @brief Odczytuje przekierowania zapisane w obrazie drzew.
+ * Zapisuje w tablicy @p pairs wszystkie przekierowania zapisane w obrazie.
+ * Napisy wskazywane przez pary należą do obrazu.
+ * @param[in] index  – wskaźnik na obraz drzew;
+ * @param[out] pairs – tablica o rozmiarze @ref frozenPairCount.
+ */
+void frozenPairs(FrozenIndex const *index, PhoneForwardPair *pairs);
+
+/** @brief Znajduje najdłuższy przekierowany prefiks numeru.
+ * @param[in] index   – wskaźnik na obraz drzew;
+ * @param[in] num     – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[out] length – długość znalezionego prefiksu (0, jeśli żaden prefiks
+ *                      nie został przekierowany).
+ * @return Wskaźnik na napis reprezentujący numer, na który przekierowany
+ *         jest znaleziony prefiks, lub pusty napis, jeśli żaden prefiks nie
+ *         został przekierowany.
+ */
+char const *frozenForwardedPrefix(FrozenIndex const *index, char const *num,
+                                  size_t *length);
+
+/**
+ * Wyznacza wynik funkcji @ref phfwdReverse na podstawie obrazu drzew.
+ * @param[in] index – wskaźnik na obraz drzew;
+ * @param[in] num   – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci.
+ */
+PhoneNumbers *frozenReverse(FrozenIndex const *index, char const *num);
+
+/**
+ * Wyznacza wynik funkcji @ref phfwdGetReverse na podstawie obrazu drzew.
+ * @param[in] index – wskaźnik na obraz drzew;
+ * @param[in] num   – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci.
+ */
+PhoneNumbers *frozenGetReverse(FrozenIndex const *index, char const *num);
+
+/** @brief Dodaje do kursora numery z wyniku zapytania o odwrotność.
+ * Dodaje do kursora numery z wyniku funkcji @ref phfwdReverse lub
+ * @ref phfwdGetReverse wyznaczonego na podstawie obrazu drzew, bez ich
+ * sortowania. Kursor odwołuje się do napisów obrazu.
+ * @param[in] index       – wskaźnik na obraz drzew;
+ * @param[in] num         – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] unforwarded – wartość @p true, jeśli należy pominąć numery
+ *                          przekierowane dalej (wynik funkcji
+ *                          @ref phfwdGetReverse);
+ * @param[in, out] cursor – wskaźnik na kursor.
+ * @return Wartość @p true, jeśli numery zostały dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+bool frozenCollectReverse(FrozenIndex const *index, char const *num,
+                          bool unforwarded, PhfwdReverseCursor *cursor);
+
+/** @brief Wyznacza liczbę numerów wyniku zapytania o odwrotność.
+ * Wyznacza liczbę numerów w wyniku funkcji @ref phfwdReverse lub
+ * @ref phfwdGetReverse na podstawie obrazu drzew, bez tworzenia numerów.
+ * Obraz nie przechowuje liczników, więc funkcja przegląda odwołania
+ * wszystkich węzłów odpowiadających prefiksom numeru, ale schodzi w drzewie
+ * tylko od numerów, które mają dłuższe przekierowane prefiksy.
+ * @param[in] index       – wskaźnik na obraz drzew;
+ * @param[in] num         – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] unforwarded – wartość @p true, jeśli należy pominąć numery
+ *                          przekierowane dalej (wynik funkcji
+ *                          @ref phfwdGetReverse).
+ * @return Liczba numerów wyniku.
+ */
+size_t frozenReverseCount(FrozenIndex const *index, char const *num,
+                          bool unforwarded);
+
+#endif /* FROZEN_INDEX_H */
@@ -7,25 +7,33 @@
  * @date 2022
  */
 
-#include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 
 #include "number_functions.h"
 
-int sortValue(int ch) {
-    if (ch == '\0')
-        return -1;
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+/**
+ * Makro zdefiniowane, jeśli dostępne są wektorowe implementacje funkcji
+ * @ref numberLength wybierane w trakcie działania programu.
+ */
+#define NUMBER_VECTOR_KERNELS
 
-    return (int) charToDigit(ch);
-}
+#include <immintrin.h>
 
-unsigned int charToDigit(int ch) {
-    if (ch == '*')
-        return 10;
-    if (ch == '#')
-        return 11;
-    return (size_t) (ch - (int) '0');
-}
+/**
+ * Atrybuty funkcji korzystającej z rozkazów z rozszerzenia @p isa, która
+ * czyta wyrównane bloki pamięci wykraczające poza koniec napisu.
+ */
+#define NUMBER_KERNEL_ATTRIBUTES(isa) \
+    __attribute__((target(isa), no_sanitize_address))
+
+/**
+ * Typ implementacji funkcji @ref numberLength.
+ */
+typedef size_t (*NumberLengthKernel)(char const *);
+#endif
 
 char digitToChar(unsigned int digit) {
     if (digit < 10) {
@@ -43,13 +51,153 @@ bool isPhNumDigit(int ch) {
     return isdigit(ch) || ch == '*' || ch == '#';
 }
 
-bool isCorrect(char const *num) {
-    if (num == NULL)
-        return false;
-
+/**
+ * Wyznacza długość numeru, przeglądając napis znak po znaku.
+ * @param[in] num – wskaźnik na napis.
+ * @return Długość numeru lub 0, jeśli napis nie reprezentuje numeru.
+ */
+static size_t numberLengthScalar(char const *num) {
     size_t i = 0;
     while (isPhNumDigit(num[i]))
         ++i;
 
-    return (num[i] == '\0' && i > 0);
-}
\ No newline at end of file
+    return num[i] == '\0' ? i : 0;
+}
+
+#ifdef NUMBER_VECTOR_KERNELS
+
+/**
+ * Wyznacza wynik funkcji @ref numberLength na podstawie pozycji pierwszego
+ * znaku napisu, który nie reprezentuje cyfry.
+ * @param[in] num    – wskaźnik na napis;
+ * @param[in] length – pozycja tego znaku.
+ * @return Długość numeru lub 0, jeśli napis nie reprezentuje numeru.
+ */
+static inline size_t numberLengthAt(char const *num, size_t length) {
+    return num[length] == '\0' ? length : 0;
+}
+
+/** @brief Wyznacza długość numeru rozkazami SSE2.
+ * Przegląda napis blokami po 16 znaków wyrównanymi do 16 bajtów. Blok
+ * wyrównany nie przekracza granicy strony pamięci, więc odczyt znaków za
+ * końcem napisu jest bezpieczny, choć wykrywają go narzędzia sprawdzające
+ * dostęp do pamięci – stąd wyłączenie ich dla tej funkcji.
+ * @param[in] num – wskaźnik na napis.
+ * @return Długość numeru lub 0, jeśli napis nie reprezentuje numeru.
+ */
+NUMBER_KERNEL_ATTRIBUTES("sse2")
+static size_t numberLengthSse2(char const *num) {
+    size_t misalignment = (uintptr_t) num & 15;
+    __m128i const *block = (__m128i const *) (num - misalignment);
+    // znaki od '0' do '9' przesuwamy na najmniejsze wartości ze znakiem
+    __m128i bias = _mm_set1_epi8((char) (0x80 - '0'));
+    __m128i limit = _mm_set1_epi8((char) (0x80 + 10));
+    __m128i star = _mm_set1_epi8('*');
+    __m128i hash = _mm_set1_epi8('#');
+    unsigned int ignored = (1u << misalignment) - 1;
+
+    for (size_t offset = 0;; offset += 16, ++block) {
+        __m128i chars = _mm_load_si128(block);
+        __m128i digits = _mm_cmplt_epi8(_mm_add_epi8(chars, bias), limit);
+        __m128i valid = _mm_or_si128(
+                digits, _mm_or_si128(_mm_cmpeq_epi8(chars, star),
+                                     _mm_cmpeq_epi8(chars, hash)));
+        unsigned int invalid =
+                ~(unsigned int) _mm_movemask_epi8(valid) & 0xFFFF & ~ignored;
+
+        if (invalid != 0) {
+            size_t position = offset + (size_t) __builtin_ctz(invalid);
+            return numberLengthAt(num, position - misalignment);
+        }
+        ignored = 0;
+    }
+}
+
+/**
+ * Wyznacza długość numeru rozkazami AVX2, przeglądając napis blokami po
+ * 32 znaki wyrównanymi do 32 bajtów, tak jak funkcja
+ * @ref numberLengthSse2.
+ * @param[in] num – wskaźnik na napis.
+ * @return Długość numeru lub 0, jeśli napis nie reprezentuje numeru.
+ */
+NUMBER_KERNEL_ATTRIBUTES("avx2")
+static size_t numberLengthAvx2(char const *num) {
+    size_t misalignment = (uintptr_t) num & 31;
+    __m256i const *block = (__m256i const *) (num - misalignment);
+    __m256i bias = _mm256_set1_epi8((char) (0x80 - '0'));
+    __m256i limit = _mm256_set1_epi8((char) (0x80 + 9));
+    __m256i star = _mm256_set1_epi8('*');
+    __m256i hash = _mm256_set1_epi8('#');
+    uint32_t ignored = (uint32_t) ((UINT64_C(1) << misalignment) - 1);
+
+    for (size_t offset = 0;; offset += 32, ++block) {
+        __m256i chars = _mm256_load_si256(block);
+        // AVX2 ma tylko porównanie „większe niż”, więc odwracamy warunek
+        __m256i nonDigits = _mm256_cmpgt_epi8(
+                _mm256_add_epi8(chars, bias), limit);
+        __m256i valid = _mm256_or_si256(
+                _mm256_cmpeq_epi8(chars, star), _mm256_cmpeq_epi8(chars, hash));
+        uint32_t invalid = (uint32_t) _mm256_movemask_epi8(nonDigits) &
+                           ~(uint32_t) _mm256_movemask_epi8(valid) &
+                           ~ignored;
+
+        if (invalid != 0) {
+            size_t position = offset + (size_t) __builtin_ctz(invalid);
+            return numberLengthAt(num, position - misalignment);
+        }
+        ignored = 0;
+    }
+}
+
+/**
+ * Wybiera implementację funkcji @ref numberLength odpowiednią dla
+ * procesora.
+ * @return Wskaźnik na wybraną implementację.
+ */
+static NumberLengthKernel selectKernel(void) {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return numberLengthAvx2;
+    if (__builtin_cpu_supports("sse2"))
+        return numberLengthSse2;
+    return numberLengthScalar;
+}
+
+size_t numberLength(char const *num) {
+    static NumberLengthKernel kernel = NULL;
+    NumberLengthKernel current = __atomic_load_n(&kernel, __ATOMIC_RELAXED);
+
+    // wybór jest zawsze taki sam, więc wątki mogą go dokonać niezależnie
+    if (current == NULL) {
+        current = selectKernel();
+        __atomic_store_n(&kernel, current, __ATOMIC_RELAXED);
+    }
+
+    return current(num);
+}
+
+#else
+
+size_t numberLength(char const *num) {
+    return numberLengthScalar(num);
+}
+
+#endif /* NUMBER_VECTOR_KERNELS */
+
+bool isCorrect(char const *num) {
+    return num != NULL && numberLength(num) > 0;
+}
+
+size_t changePrefixInto(char const *num, char const *newPrefix, size_t index,
+                        char *buf, size_t bufLen) {
+    size_t prefixLength = strlen(newPrefix);
+    size_t suffixLength = strlen(num + index);
+
+    if (prefixLength + suffixLength < bufLen) {
+        memcpy(buf, newPrefix, prefixLength);
+        memcpy(buf + prefixLength, num + index, suffixLength + 1);
+    }
+
+    return prefixLength + suffixLength;
+}
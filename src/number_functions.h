@@ -11,6 +11,22 @@
 #define NUMBER_FUNCTIONS_H
 
 #include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Wyznacza wartość cyfry w rozumieniu treści zadania.
+ * Wartość wyznaczana jest bez rozgałęzień na podstawie kodów ASCII: cyfry
+ * dziesiętne mają ustawiony bit 0x10, a ich wartością są cztery najmłodsze
+ * bity kodu, tak jak dla znaku * (0x2A). Znak # (0x23) różni się od nich
+ * nieustawionym bitem 0x10 i ustawionym bitem 0x01, które razem dają
+ * brakujące 8.
+ * @param[in] ch – kod znaku reprezentującego cyfrę.
+ * @return Wartość cyfry reprezentowanej przez @p ch.
+ */
+static inline unsigned int charToDigit(int ch) {
+    unsigned int code = (unsigned int) ch;
+
+    return (code & 0xF) | ((~code >> 1) & (code << 3) & 0x8);
+}
 
 /**
  * Wyznacza wartość znaku w celu porównywania go z innymi znakami.
@@ -19,14 +35,12 @@
  *         treści zadania.
  *         Wartość -1, jeśli @p ch jest znakiem kończącym napis.
  */
-int sortValue(int ch);
+static inline int sortValue(int ch) {
+    if (ch == '\0')
+        return -1;
 
-/**
- * Wyznacza wartość cyfry w rozumieniu treści zadania.
- * @param[in] ch – kod znaku reprezentującego cyfrę.
- * @return Wartość cyfry reprezentowanej przez @p ch.
- */
-unsigned int charToDigit(int ch);
+    return (int) charToDigit(ch);
+}
 
 /**
  * Wyznacza znak reprezentujący cyfrę na podstawie jej wartości.
@@ -44,6 +58,18 @@ char digitToChar(unsigned int digit);
  */
 bool isPhNumDigit(int ch);
 
+/** @brief Wyznacza długość numeru.
+ * Sprawdza, czy napis reprezentuje numer, i wyznacza jego długość w jednym
+ * przejściu. Napis przeglądany jest blokami po 16 lub 32 znaki (zależnie od
+ * rozkazów wektorowych dostępnych na procesorze, co sprawdzane jest przy
+ * pierwszym wywołaniu) lub znak po znaku, jeśli rozkazy wektorowe nie są
+ * dostępne.
+ * @param[in] num – wskaźnik na napis różny od NULL.
+ * @return Długość numeru, jeśli napis reprezentuje numer.
+ *         Wartość 0, jeśli napis nie reprezentuje numeru.
+ */
+size_t numberLength(char const *num);
+
 /**
  * Sprawdza, czy napis reprezentuje numer.
  * @param[in] num – wskaźnik na napis.
@@ -52,4 +78,24 @@ bool isPhNumDigit(int ch);
  */
 bool isCorrect(char const *num);
 
+/** @brief Zamienia prefiks numeru, zapisując wynik w podanym buforze.
+ * Zamienia prefiks numeru @p num złożony z jego pierwszych @p index cyfr
+ * na numer @p newPrefix (nie zmieniając przy tym @p num) i zapisuje
+ * otrzymany numer (wraz z kończącym go znakiem '\0') w buforze @p buf
+ * o rozmiarze @p bufLen. Wynik powstaje przez skopiowanie dwóch ciągłych
+ * fragmentów pamięci. Jeśli nie mieści się w buforze, bufor nie jest
+ * zmieniany.
+ * @param[in] num       – wskaźnik na numer, którego prefiks ma
+ *                        być zastąpiony;
+ * @param[in] newPrefix – wskaźnik na napis reprezentujący nowy prefiks;
+ * @param[in] index     – indeks, do którego rozważamy prefiks do
+ *                        zastąpienia;
+ * @param[out] buf      – wskaźnik na bufor (może wynosić NULL, jeśli
+ *                        @p bufLen wynosi 0);
+ * @param[in] bufLen    – rozmiar bufora w bajtach.
+ * @return Długość numeru z podmienionym prefiksem (bez znaku '\0').
+ */
+size_t changePrefixInto(char const *num, char const *newPrefix, size_t index,
+                        char *buf, size_t bufLen);
+
 #endif /* NUMBER_FUNCTIONS_H */
@@ -0,0 +1,181 @@
+/** @file
+ * Implementacja sortowania numerów telefonów wraz z przypisanymi im
+ * wartościami.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "number_sort.h"
+#include "number_functions.h"
+
+/**
+ * Liczba kubełków sortowania pozycyjnego: jeden dla końca napisu i po
+ * jednym dla każdej z dwunastu cyfr.
+ */
+#define SORT_BUCKETS 13
+
+/**
+ * Przedziały zawierające mniej numerów niż ta wartość sortowane są przez
+ * wstawianie.
+ */
+#define SORT_INSERTION_THRESHOLD 32
+
+/**
+ * Struktura reprezentująca fragment tablicy numerów oczekujący na
+ * posortowanie. Wszystkie numery fragmentu mają wspólny prefiks długości
+ * @p depth.
+ */
+typedef struct SortRange {
+    size_t begin; ///< indeks pierwszego numeru fragmentu
+    size_t end; ///< indeks za ostatnim numerem fragmentu
+    size_t depth; ///< długość wspólnego prefiksu numerów fragmentu
+} SortRange;
+
+/**
+ * Wyznacza numer kubełka, do którego trafia numer @p num, gdy sortowanie
+ * rozpatruje jego znak o indeksie @p depth.
+ * @param[in] num   – wskaźnik na numer;
+ * @param[in] depth – indeks rozpatrywanego znaku.
+ * @return Numer kubełka: 0 dla końca napisu, wartość cyfry powiększona
+ *         o jeden w przeciwnym przypadku.
+ */
+static size_t sortBucket(char const *num, size_t depth) {
+    return (size_t) (sortValue(num[depth]) + 1);
+}
+
+/** @brief Porównuje leksykograficznie dwa numery.
+ * Porównuje leksykograficznie dwa numery o wspólnym prefiksie długości
+ * @p depth.
+ * @param[in] num1  – wskaźnik na pierwszy numer do porównania;
+ * @param[in] num2  – wskaźnik na drugi numer do porównania;
+ * @param[in] depth – długość wspólnego prefiksu numerów.
+ * @return Wartość ujemna, jeśli @p num1 jest mniejsze niż @p num2
+ *         (w porządku leksykograficznym).
+ *         Wartość zero, jeśli @p num1 jest równe @p num2.
+ *         Wartość dodatnia, jeśli @p num1 jest większe niż @p num2.
+ */
+static int lexCompare(char const *num1, char const *num2, size_t depth) {
+    size_t i = depth;
+    while (num1[i] != '\0' && num2[i] != '\0' && num1[i] == num2[i])
+        ++i;
+
+    return sortValue(num1[i]) - sortValue(num2[i]);
+}
+
+/**
+ * Sortuje przez wstawianie tablicę numerów o wspólnym prefiksie długości
+ * @p depth.
+ * @param[in, out] items – tablica sortowanych elementów;
+ * @param[in] count      – liczba elementów;
+ * @param[in] depth      – długość wspólnego prefiksu numerów.
+ */
+static void insertionSort(SortItem *items, size_t count, size_t depth) {
+    for (size_t i = 1; i < count; ++i) {
+        SortItem item = items[i];
+        size_t j = i;
+
+        while (j > 0 && lexCompare(items[j - 1].key, item.key, depth) > 0) {
+            items[j] = items[j - 1];
+            --j;
+        }
+        items[j] = item;
+    }
+}
+
+/** @brief Sortuje tablicę numerów.
+ * Sortuje tablicę numerów pozycyjnie, zaczynając od najbardziej znaczącego
+ * znaku. Fragmenty oczekujące na posortowanie przechowywane są na stosie
+ * zamiast w wywołaniach rekurencyjnych, bo wspólne prefiksy numerów mogą być
+ * dowolnie długie. Na stos trafiają tylko rozłączne fragmenty o co najmniej
+ * @ref SORT_INSERTION_THRESHOLD numerach, więc wystarcza mu
+ * count / @ref SORT_INSERTION_THRESHOLD + 1 miejsc.
+ * @param[in, out] items – tablica sortowanych elementów;
+ * @param[out] buffer    – tablica pomocnicza o rozmiarze @p count;
+ * @param[out] stack     – tablica na stos fragmentów;
+ * @param[in] count      – liczba elementów.
+ */
+static void radixSort(SortItem *items, SortItem *buffer, SortRange *stack,
+                      size_t count) {
+    size_t stackSize = 0;
+    stack[stackSize++] = (SortRange) {0, count, 0};
+
+    while (stackSize > 0) {
+        SortRange range = stack[--stackSize];
+        size_t rangeCount = range.end - range.begin;
+
+        if (rangeCount < SORT_INSERTION_THRESHOLD) {
+            insertionSort(items + range.begin, rangeCount, range.depth);
+            continue;
+        }
+
+        size_t counts[SORT_BUCKETS] = {0};
+        for (size_t i = range.begin; i < range.end; ++i)
+            ++counts[sortBucket(items[i].key, range.depth)];
+
+        // jeśli wszystkie numery mają ten sam znak, nie trzeba ich
+        // przestawiać – wystarczy wydłużyć wspólny prefiks
+        size_t first = sortBucket(items[range.begin].key, range.depth);
+        if (counts[first] == rangeCount) {
+            if (first != 0) {
+                ++range.depth;
+                stack[stackSize++] = range;
+            }
+            continue;
+        }
+
+        size_t starts[SORT_BUCKETS];
+        size_t start = range.begin;
+        for (size_t b = 0; b < SORT_BUCKETS; ++b) {
+            starts[b] = start;
+            start += counts[b];
+        }
+
+        for (size_t i = range.begin; i < range.end; ++i) {
+            size_t b = sortBucket(items[i].key, range.depth);
+            buffer[starts[b]++] = items[i];
+        }
+        memcpy(items + range.begin, buffer + range.begin,
+               rangeCount * sizeof(SortItem));
+
+        // numery z kubełka 0 są sobie równe, a pozostałe kubełki sortujemy
+        // według kolejnego znaku
+        for (size_t b = 1; b < SORT_BUCKETS; ++b) {
+            size_t end = starts[b];
+            size_t begin = end - counts[b];
+
+            if (counts[b] >= SORT_INSERTION_THRESHOLD)
+                stack[stackSize++] = (SortRange) {begin, end, range.depth + 1};
+            else
+                insertionSort(items + begin, counts[b], range.depth + 1);
+        }
+    }
+}
+
+bool numberSort(SortItem *items, size_t count) {
+    if (count < 2)
+        return true;
+
+    if (count > SIZE_MAX / sizeof(SortItem))
+        return false;
+
+    SortItem *buffer = malloc(count * sizeof(SortItem));
+    SortRange *stack = malloc((count / SORT_INSERTION_THRESHOLD + 1) *
+                              sizeof(SortRange));
+    if (buffer == NULL || stack == NULL) {
+        free(buffer);
+        free(stack);
+        return false;
+    }
+
+    radixSort(items, buffer, stack, count);
+
+    free(buffer);
+    free(stack);
+    return true;
+}
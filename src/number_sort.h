@@ -0,0 +1,37 @@
+/** @file
+ * Interfejs sortowania numerów telefonów wraz z przypisanymi im
+ * wartościami.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef NUMBER_SORT_H
+#define NUMBER_SORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Struktura przechowująca sortowany numer wraz z przypisaną mu wartością,
+ * która pozwala odnaleźć dane związane z numerem po posortowaniu.
+ */
+typedef struct SortItem {
+    char const *key; ///< wskaźnik na napis reprezentujący numer
+    size_t value; ///< wartość przypisana numerowi
+} SortItem;
+
+/** @brief Sortuje numery.
+ * Sortuje tablicę @p items leksykograficznie według numerów (w porządku
+ * wyznaczanym przez funkcję @ref sortValue). Sortowanie jest stabilne:
+ * elementy o równych numerach zachowują swoją wzajemną kolejność.
+ * @param[in, out] items – tablica sortowanych elementów;
+ * @param[in] count      – liczba elementów.
+ * @return Wartość @p true, jeśli sortowanie się powiodło.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci (tablica
+ *         się wtedy nie zmienia).
+ */
+bool numberSort(SortItem *items, size_t count);
+
+#endif /* NUMBER_SORT_H */
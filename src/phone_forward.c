@@ -11,400 +11,1344 @@
 #include <stdint.h>
 
 #include "phone_forward.h"
+#include "phone_numbers.h"
 #include "number_functions.h"
+#include "number_sort.h"
 #include "trie.h"
-#include "list.h"
+#include "frozen_index.h"
+#include "epoch.h"
+#include "stats.h"
+#include "query_cache.h"
+#include "reverse_cursor.h"
 
 /**
  * Struktura przechowująca przekierowania numerów telefonów składa się z dwóch
  * drzew trie odpowiadającym odpowiednio numerom przekierowanym oraz ich
- * przekierowaniom. Korzenie drzew odpowiadają pustym napisom.
+ * przekierowaniom. Korzenie drzew odpowiadają pustym napisom. Węzły obu drzew
+ * i kopie numerów przydzielane są z pul pamięci należących do struktury.
+ * Numery przekierowane na ten sam numer przechowywane są w tablicy w węźle
+ * drzewa odwrotności przekierowań, również przydzielanej z puli.
+ * Po wywołaniu funkcji @ref phfwdFreeze zapytania wykonywane są na
+ * niemodyfikowalnym obrazie drzew, który jest usuwany przy pierwszej
+ * modyfikacji struktury. Struktura utworzona funkcją @ref phfwdOpenMapped ma
+ * puste drzewa, a jej obraz znajduje się w odwzorowanym pliku – przed jego
+ * usunięciem przekierowania są przepisywane do drzew. Po wywołaniu funkcji
+ * @ref phfwdEnableConcurrentReads zapytania mogą być wykonywane współbieżnie
+ * z modyfikacjami – synchronizuje je struktura @p ctx.epoch. Po wywołaniu
+ * funkcji @ref phfwdEnableCache wyniki zapytań zapamiętywane są w strukturze
+ * @p cache, a modyfikacje unieważniają te z nich, które mogły się zmienić.
+ * Poddrzewa usunięte z drzewa przekierowań zwalniane są stopniowo przy
+ * kolejnych modyfikacjach lub przez funkcję @ref phfwdReclaim, a do tego
+ * czasu zapytania o odwrotności przekierowań pomijają ich węzły.
+ * Między wywołaniami funkcji @ref phfwdBegin i @ref phfwdCommit zmiany drzew
+ * pozostają w dzienniku struktury @p ctx, z którego wycofuje je funkcja
+ * @ref phfwdRollback.
+ * Liczniki operacji istnieją tylko w bibliotece skompilowanej z makrem
+ * @p PHFWD_STATS.
  */
 struct PhoneForward {
-    TrieNode *rootFwd; ///< korzeń drzewa przechowującego przekierowania
-    TrieNode *rootReverse; /**< korzeń drzewa przechowującego odwrotności
-                           przekierowań */
+    TrieContext ctx; ///< pule pamięci węzłów drzew i kopii numerów
+    PoolIndex rootFwd; /**< indeks korzenia drzewa przechowującego
+                       przekierowania */
+    PoolIndex rootReverse; /**< indeks korzenia drzewa przechowującego
+                           odwrotności przekierowań */
+    FrozenIndex *frozen; /**< obraz drzew aktualny od ostatniego wywołania
+                         funkcji @ref phfwdFreeze lub NULL, jeśli struktura
+                         była od tego czasu modyfikowana */
+    QueryCache *cache; /**< pamięć podręczna wyników zapytań lub NULL, jeśli
+                       nie jest włączona */
+    bool failed; /**< czy któraś modyfikacja trwającej transakcji się nie
+                 powiodła */
+#ifdef PHFWD_STATS
+    PhfwdStats stats; ///< liczniki operacji, na które wskazuje @p ctx.stats
+#endif
 };
 
 /**
- * Struktura przechowująca ciąg numerów telefonów jest dynamicznie powiększaną
- * tablicą.
+ * Liczba numerów, dla których funkcja @ref phfwdGetBatch jednocześnie
+ * wyszukuje przekierowania.
  */
-struct PhoneNumbers {
-    char **numbers; ///< tablica napisów
-    size_t numberCount; ///< liczba napisów przechowywanych w tablicy
-    size_t capacity; /**< maksymalna liczba napisów, którą można pomieścić
-                     w tablicy bez dodatkowej alokacji */
-};
-
-/* Funkcje struktury PhoneNumbers */
+#define GET_BATCH_CHUNK 64
 
 /**
- * Tworzy nową strukturę reprezentującą pusty ciąg.
- * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
- *         alokować pamięci.
+ * Liczba kroków zwalniania poddrzew usuniętych funkcją @ref phfwdRemove
+ * wykonywanych po każdej modyfikacji struktury (zob. @ref trieReclaim).
  */
-static PhoneNumbers *phnumNew(void) {
-    PhoneNumbers *newStruct = malloc(sizeof(struct PhoneNumbers));
+#define RECLAIM_STEP 64
+
+/* Funkcje struktury PhoneForward */
+
+PhoneForward *phfwdNew(void) {
+    PhoneForward *newStruct = malloc(sizeof(struct PhoneForward));
 
     if (newStruct != NULL) {
-        newStruct->numbers = NULL;
-        newStruct->numberCount = 0;
-        newStruct->capacity = 0;
+        if (!trieContextInit(&newStruct->ctx)) {
+            free(newStruct);
+            return NULL;
+        }
+
+#ifdef PHFWD_STATS
+        memset(&newStruct->stats, 0, sizeof(newStruct->stats));
+        newStruct->ctx.stats = &newStruct->stats;
+#endif
+
+        newStruct->rootFwd = trieNew(&newStruct->ctx, TRIE_FORWARD);
+        newStruct->rootReverse = trieNew(&newStruct->ctx, TRIE_REVERSE);
+
+        if (newStruct->rootFwd == POOL_NULL ||
+            newStruct->rootReverse == POOL_NULL) {
+            trieContextDestroy(&newStruct->ctx);
+            free(newStruct);
+            return NULL;
+        }
+
+        newStruct->frozen = NULL;
+        newStruct->cache = NULL;
+        newStruct->failed = false;
     }
 
     return newStruct;
 }
 
-void phnumDelete(PhoneNumbers *pnum) {
-    if (pnum == NULL)
+void phfwdDelete(PhoneForward *pf) {
+    if (pf == NULL)
         return;
 
-    for (size_t i = 0; i < pnum->numberCount; ++i)
-        free(pnum->numbers[i]);
-    free(pnum->numbers);
-    free(pnum);
+    // wszystkie węzły drzew, tablice i kopie numerów pochodzą z pul
+    // pamięci, więc zamiast usuwać je pojedynczo zwalniamy całe płyty
+    frozenDelete(pf->frozen);
+    queryCacheDelete(pf->cache);
+    trieContextDestroy(&pf->ctx);
+    free(pf);
 }
 
-/**
- * Dodaje numer @p num do struktury @p pnum.
- * @param[in, out] pnum – wskaźnik na strukturę przechowującą ciąg numerów;
- * @param[in] num       – wskaźnik na napis reprezentujący numer.
- * @return Wartość @p true, jeśli napis został dodany.
- *         Wartość @p false, jeśli nie udało się alokować pamięci
- *         lub jeden z parametrów ma wartość NULL.
- */
-static bool phnumAdd(PhoneNumbers *pnum, char *num) {
-    if (pnum == NULL || num == NULL)
+bool phfwdEnableConcurrentReads(PhoneForward *pf) {
+    if (pf == NULL || pf->cache != NULL)
         return false;
 
-    if (pnum->numberCount == pnum->capacity) {
-        size_t maxCapacity = SIZE_MAX / sizeof(char *);
-
-        // sprawdzamy, czy rozmiar nie miałby wykroczyć poza zakres
-        // typu size_t
-        if (pnum->capacity == maxCapacity)
-            return false;
-
-        // ustawiamy nowy rozmiar jako w przybliżeniu 3/2 poprzedniego
-        // lub maksymalny dopuszczany przez typ size_t, jeśli ten drugi
-        // jest mniejszy
-        size_t newCapacity;
+    // wpisy dziennika trwającej transakcji nie mają zarezerwowanego miejsca
+    // na odroczone zwolnienia
+    if (pf->ctx.epoch == NULL && !pf->ctx.transaction)
+        pf->ctx.epoch = epochNew();
 
-        if (pnum->capacity > maxCapacity / 3 * 2)
-            newCapacity = maxCapacity;
-        else
-            newCapacity = pnum->capacity * 3 / 2 + 1;
+    return pf->ctx.epoch != NULL;
+}
 
-        char **tmp = realloc(pnum->numbers, newCapacity * sizeof(char *));
+bool phfwdEnableCache(PhoneForward *pf, size_t capacity) {
+    if (pf == NULL || pf->ctx.epoch != NULL)
+        return false;
 
-        if (tmp == NULL)
+    QueryCache *cache = NULL;
+    if (capacity > 0) {
+        cache = queryCacheNew(capacity);
+        if (cache == NULL)
             return false;
-        pnum->capacity = newCapacity;
-        pnum->numbers = tmp;
     }
 
-    pnum->numbers[pnum->numberCount] = num;
-    ++pnum->numberCount;
+    queryCacheDelete(pf->cache);
+    pf->cache = cache;
     return true;
 }
 
-/** @brief Dodaje numer do struktury obsługując błędy.
- * Dodaje numer @p num do struktury @p pnum, a w przypadku niepowodzenia
- * usuwa strukturę @p pnum i zwalnia pamięć zaalokowaną numerowi @p num.
- * @param[in, out] pnum – wskaźnik na strukturę przechowującą ciąg numerów;
- * @param[in, out] num  – wskaźnik na napis reprezentujący numer.
- * @return Wartość @p true, jeśli napis został dodany.
- *         Wartość @p false, jeśli nie udało się alokować pamięci
- *         lub jeden z parametrów ma wartość NULL i usunięte zostały
- *         struktura i napis.
- */
-static bool phnumSafeAdd(PhoneNumbers *pnum, char *num) {
-    if (!phnumAdd(pnum, num)) {
-        free(num);
-        phnumDelete(pnum);
+bool phfwdCacheStats(PhoneForward const *pf, PhfwdCacheStats *out) {
+    if (pf == NULL || out == NULL || pf->cache == NULL)
         return false;
-    }
 
+    queryCacheStats(pf->cache, out);
     return true;
 }
 
-/** @brief Porównuje leksykograficznie dwa numery.
- * Porównuje leksykograficznie dwa numery tak, aby używać jej jako
- * komparatora w funkcji qsort.
- * @param[in] a – wskaźnik na pierwszy numer do porównania;
- * @param[in] b – wskaźnik na drugi numer do porównania.
- * @return Wartość ujemna, jeśli @p a jest mniejsze niż @p b (w porządku
- *         leksykograficznym).
- *         Wartość zero, jeśli @p a jest równe @p b.
- *         Wartość dodatnia, jeśli @p a jest większe niż @p b.
- *
+/**
+ * Wyszukuje wynik zapytania w pamięci podręcznej struktury @p pf.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania
+ *                    numerów;
+ * @param[in] query – rodzaj zapytania;
+ * @param[in] num   – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wskaźnik na zapamiętany wynik lub NULL, jeśli go nie ma lub
+ *         pamięć podręczna nie jest włączona.
  */
-static int lexCompare(const void *a, const void *b) {
-    char const *num1 = *(char const **) a;
-    char const *num2 = *(char const **) b;
-
-    size_t i = 0;
-    while (num1[i] != '\0' && num2[i] != '\0' && num1[i] == num2[i])
-        ++i;
-
-    return sortValue(num1[i]) - sortValue(num2[i]);
+static PhoneNumbers const *findCached(PhoneForward const *pf,
+                                      CacheQuery query, char const *num) {
+    return pf->cache == NULL ? NULL : queryCacheFind(pf->cache, query, num);
 }
 
 /**
- * Sortuje strukturę @p pnum leksykograficznie.
- * @param[in, out] pnum – wskaźnik na strukturę reprezentującą ciąg.
+ * Zapamiętuje wynik zapytania w pamięci podręcznej struktury @p pf, jeśli
+ * jest ona włączona, a wynik został wyznaczony.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] query  – rodzaj zapytania;
+ * @param[in] num    – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] result – wskaźnik na wynik zapytania lub NULL.
  */
-static void lexSort(PhoneNumbers *pnum) {
-    qsort(pnum->numbers, pnum->numberCount, sizeof(char *), lexCompare);
+static void storeCached(PhoneForward const *pf, CacheQuery query,
+                        char const *num, PhoneNumbers const *result) {
+    if (pf->cache != NULL && result != NULL)
+        queryCacheInsert(pf->cache, query, num, result);
 }
 
+#ifdef PHFWD_STATS
+
 /**
- * Usuwa powtarzające się numery z posortowanej struktury.
- * @param[in, out] pnum – wskaźnik na wskaźnik na strukturę
- *                        reprezentującą ciąg.
- * @return Wartość @p true, jeśli usuwanie się powiodło.
- *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ * Liczba liczników w strukturze @ref PhfwdStats.
  */
-static bool removeDuplicates(PhoneNumbers **pnum) {
-    PhoneNumbers *new = phnumNew();
-    if (new == NULL)
+#define STATS_WORDS (sizeof(PhfwdStats) / sizeof(uint64_t))
+
+_Static_assert(sizeof(PhfwdStats) % sizeof(uint64_t) == 0,
+               "PhfwdStats must consist of uint64_t counters only");
+
+bool phfwdStats(PhoneForward const *pf, PhfwdStats *out) {
+    if (pf == NULL || out == NULL)
         return false;
 
-    if (!phnumAdd(new, (*pnum)->numbers[0])) {
-        free(new);
+    // wszystkie pola są licznikami, więc kopiujemy je jak tablicę
+    uint64_t const *counters = (uint64_t const *) &pf->stats;
+    uint64_t *copy = (uint64_t *) out;
+    for (size_t i = 0; i < STATS_WORDS; ++i)
+        copy[i] = __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
+
+    return true;
+}
+
+void phfwdStatsReset(PhoneForward *pf) {
+    if (pf == NULL)
+        return;
+
+    uint64_t *counters = (uint64_t *) &pf->stats;
+    for (size_t i = 0; i < STATS_WORDS; ++i)
+        __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+}
+
+#else
+
+bool phfwdStats(PhoneForward const *pf, PhfwdStats *out) {
+    (void) pf;
+    (void) out;
+    return false;
+}
+
+void phfwdStatsReset(PhoneForward *pf) {
+    (void) pf;
+}
+
+#endif /* PHFWD_STATS */
+
+bool phfwdMemoryUsage(PhoneForward const *pf, PhfwdMemoryReport *report) {
+    if (pf == NULL || report == NULL)
         return false;
+
+    trieMemoryUsage(&pf->ctx, report);
+    report->imageBytes = pf->frozen != NULL ? frozenSize(pf->frozen) : 0;
+    report->reservedBytes += sizeof(struct PhoneForward) + report->imageBytes +
+                             queryCacheBytes(pf->cache);
+
+    return true;
+}
+
+/**
+ * Usuwa obraz drzew. Funkcja typu @ref EpochReclaim.
+ * @param[in] owner – nieużywany;
+ * @param[in] image – adres obrazu drzew.
+ */
+static void reclaimImage(void *owner, uintptr_t image) {
+    (void) owner;
+    frozenDelete((FrozenIndex *) image);
+}
+
+/**
+ * Wyznacza obraz drzew, na którym należy wykonywać zapytania.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                 numerów.
+ * @return Wskaźnik na obraz drzew lub NULL, jeśli obraz nie jest aktualny.
+ */
+static FrozenIndex const *currentImage(PhoneForward const *pf) {
+    return __atomic_load_n(&pf->frozen, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Przekierowanie dodawane przez funkcję @ref phfwdAddBulk wraz z węzłami
+ * drzew i kopią numeru, które mu odpowiadają.
+ */
+typedef struct BulkRule {
+    char const *num1; ///< prefiks numerów przekierowywanych
+    char const *num2; ///< prefiks numerów, na które są one przekierowywane
+    PoolIndex fwd; ///< indeks węzła drzewa przekierowań numeru @p num1
+    PoolIndex reverse; /**< indeks węzła drzewa odwrotności przekierowań
+                       numeru @p num2 */
+    char *sourceCopy; /**< kopia numeru @p num1, dla której zarezerwowano
+                      miejsce w tablicy numerów węzła @p reverse */
+} BulkRule;
+
+/**
+ * Wypełnia tablicę @p rules przekierowaniami z tablicy @p pairs posortowanymi
+ * według @p num1, z par o tym samym numerze @p num1 zostawiając tylko
+ * ostatnią.
+ * @param[out] rules – tablica o rozmiarze @p count;
+ * @param[out] items – tablica pomocnicza o rozmiarze @p count;
+ * @param[in] pairs  – tablica par numerów;
+ * @param[in] count  – liczba par.
+ * @return Liczba przekierowań zapisanych w tablicy @p rules lub 0, jeśli
+ *         nie udało się alokować pamięci.
+ */
+static size_t prepareRules(BulkRule *rules, SortItem *items,
+                           PhoneForwardPair const *pairs, size_t count) {
+    bool sorted = true;
+
+    for (size_t i = 0; i < count; ++i) {
+        items[i].key = pairs[i].num1;
+        items[i].value = i;
+
+        if (i > 0 && strcmp(pairs[i - 1].num1, pairs[i].num1) > 0)
+            sorted = false;
     }
 
-    for (size_t i = 1; i < (*pnum)->numberCount; ++i) {
-        if (strcmp((*pnum)->numbers[i], (*pnum)->numbers[i - 1]) != 0) {
-            if (!phnumAdd(new, (*pnum)->numbers[i])) {
-                free(new->numbers);
-                free(new);
-                return false;
-            }
-        } else {
-            free((*pnum)->numbers[i]);
-            (*pnum)->numbers[i] = (*pnum)->numbers[i - 1];
-        }
+    // sortowanie jest stabilne, więc z równych numerów ostatni pochodzi
+    // z ostatniej pary
+    if (!sorted && !numberSort(items, count))
+        return 0;
+
+    size_t unique = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (i + 1 < count && strcmp(items[i].key, items[i + 1].key) == 0)
+            continue;
+
+        rules[unique].num1 = pairs[items[i].value].num1;
+        rules[unique].num2 = pairs[items[i].value].num2;
+        ++unique;
+    }
+
+    return unique;
+}
+
+/**
+ * Wycofuje przerwane dodawanie przekierowań: anuluje rezerwacje miejsc
+ * w tablicach numerów i wycofuje zmiany drzew zapisane w dzienniku, więc
+ * działa w czasie proporcjonalnym do liczby przekierowań, a nie do
+ * rozmiaru drzew.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] rules   – tablica przekierowań;
+ * @param[in] added   – liczba początkowych przekierowań, dla których
+ *                      zarezerwowano miejsca w tablicach numerów;
+ * @param[in] mark    – punkt dziennika sprzed dodawania przekierowań.
+ * @return Wartość @p false.
+ */
+static bool bulkRollback(PhoneForward *pf, BulkRule const *rules,
+                         size_t added, size_t mark) {
+    for (size_t i = added; i-- > 0;) {
+        epochWriteYield(pf->ctx.epoch);
+        cancelReverseFwd(&pf->ctx, rules[i].reverse, rules[i].sourceCopy);
+    }
+
+    trieJournalUndo(&pf->ctx, mark);
+    return false;
+}
+
+/**
+ * Dodaje przekierowania posortowane według @p num1, o różnych numerach
+ * @p num1. Węzły drzewa przekierowań dodawane są w kolejności @p num1, więc
+ * każde zejście zaczyna się od wspólnego prefiksu z poprzednim numerem
+ * zamiast od korzenia. Dane węzłów drzewa przekierowań są podmieniane
+ * dopiero na końcu, gdy wszystkie alokacje już się udały. Pomiędzy
+ * przekierowaniami pozwala czekającym czytelnikom wykonać odczyty, więc mogą
+ * oni zobaczyć część nowych przekierowań lub częściowo wycofane zmiany.
+ * @param[in, out] pf    – wskaźnik na strukturę przechowującą przekierowania
+ *                         numerów;
+ * @param[in, out] rules – tablica przekierowań;
+ * @param[in] count      – liczba przekierowań.
+ * @return Wartość @p true, jeśli przekierowania zostały dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci (struktura
+ *         się wtedy nie zmienia).
+ */
+static bool bulkAdd(PhoneForward *pf, BulkRule *rules, size_t count) {
+    TrieContext *ctx = &pf->ctx;
+    size_t mark = trieJournalMark(ctx);
+
+    for (size_t i = 0; i < count; ++i) {
+        BulkRule *rule = &rules[i];
+
+        epochWriteYield(ctx->epoch);
+        rule->fwd = trieAddNear(ctx, TRIE_FORWARD, pf->rootFwd,
+                                i > 0 ? rules[i - 1].fwd : POOL_NULL,
+                                i > 0 ? rules[i - 1].num1 : NULL, rule->num1);
+        if (rule->fwd == POOL_NULL)
+            return bulkRollback(pf, rules, i, mark);
+
+        rule->reverse = trieAdd(ctx, TRIE_REVERSE, pf->rootReverse,
+                                rule->num2);
+        if (rule->reverse == POOL_NULL ||
+            !trieJournalFwdData(ctx, rule->fwd, rule->num1))
+            return bulkRollback(pf, rules, i, mark);
+
+        rule->sourceCopy = reserveReverseFwd(ctx, rule->reverse, rule->num1,
+                                             rule->num2);
+        if (rule->sourceCopy == NULL)
+            return bulkRollback(pf, rules, i, mark);
+    }
+
+    // wszystkie nowe węzły drzewa odwrotności przekierowań są już niepuste,
+    // więc usuwanie zastępowanych przekierowań ich nie usunie
+    for (size_t i = 0; i < count; ++i) {
+        epochWriteYield(ctx->epoch);
+        setFwdData(ctx, rules[i].fwd, rules[i].reverse, rules[i].sourceCopy);
     }
 
-    free((*pnum)->numbers);
-    free(*pnum);
-    *pnum = new;
+    trieJournalRelease(ctx, mark);
     return true;
 }
 
-char const *phnumGet(PhoneNumbers const *pnum, size_t idx) {
-    if (pnum == NULL || idx >= pnum->numberCount)
-        return NULL;
-    return pnum->numbers[idx];
+/**
+ * Dodaje przekierowania z tablicy par, nie sprawdzając ich poprawności.
+ * Sortuje pary poza modyfikacją struktury, więc czytelnicy czekają jedynie
+ * na dodawanie przekierowań do drzew.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] pairs   – tablica poprawnych par numerów;
+ * @param[in] count   – liczba par.
+ * @return Wartość @p true, jeśli przekierowania zostały dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci (struktura
+ *         się wtedy nie zmienia).
+ */
+static bool addPairs(PhoneForward *pf, PhoneForwardPair const *pairs,
+                     size_t count) {
+    if (count == 0)
+        return true;
+
+    if (count > SIZE_MAX / sizeof(BulkRule))
+        return false;
+
+    BulkRule *rules = malloc(count * sizeof(BulkRule));
+    SortItem *items = malloc(count * sizeof(SortItem));
+    size_t unique = 0;
+    bool result = false;
+
+    if (rules != NULL && items != NULL)
+        unique = prepareRules(rules, items, pairs, count);
+
+    if (unique > 0) {
+        epochWriteBegin(pf->ctx.epoch);
+        result = bulkAdd(pf, rules, unique);
+        epochWriteEnd(pf->ctx.epoch);
+    }
+
+    free(rules);
+    free(items);
+    return result;
 }
 
-/* Funkcje struktury PhoneForward */
+/** @brief Usuwa obraz drzew struktury @p pf przed jej modyfikacją.
+ * Obraz wczytany z pliku jest jedyną kopią przekierowań, więc przed jego
+ * usunięciem przekierowania są dodawane do drzew. Czytelnicy korzystają
+ * z obrazu do chwili jego usunięcia, więc funkcję wywołuje się poza
+ * modyfikacją struktury, a dodawanie przekierowań rozpoczyna własną.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów.
+ * @return Wartość @p true, jeśli obraz został usunięty.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci (struktura
+ *         się wtedy nie zmienia).
+ */
+static bool phfwdThaw(PhoneForward *pf) {
+    FrozenIndex *image = pf->frozen;
 
-PhoneForward *phfwdNew(void) {
-    PhoneForward *newStruct = malloc(sizeof(struct PhoneForward));
+    if (image == NULL)
+        return true;
 
-    if (newStruct != NULL) {
-        newStruct->rootFwd = trieNew();
+    if (frozenIsMapped(image)) {
+        size_t count = frozenPairCount(image);
+        PhoneForwardPair *pairs = NULL;
 
-        if (newStruct->rootFwd == NULL) {
-            free(newStruct);
-            return NULL;
-        }
+        if (count > 0 && count <= SIZE_MAX / sizeof(PhoneForwardPair))
+            pairs = malloc(count * sizeof(PhoneForwardPair));
+        if (count > 0 && pairs == NULL)
+            return false;
 
-        newStruct->rootReverse = trieNew();
+        if (pairs != NULL)
+            frozenPairs(image, pairs);
+        bool unpacked = addPairs(pf, pairs, count);
 
-        if (newStruct->rootReverse == NULL) {
-            free(newStruct->rootFwd);
-            free(newStruct);
-            return NULL;
-        }
+        free(pairs);
+        if (!unpacked)
+            return false;
     }
 
-    return newStruct;
+    __atomic_store_n(&pf->frozen, NULL, __ATOMIC_RELEASE);
+    epochRetire(pf->ctx.epoch, reclaimImage, NULL, (uintptr_t) image);
+    return true;
 }
 
-void phfwdDelete(PhoneForward *pf) {
+bool phfwdFreeze(PhoneForward *pf) {
+    // w trakcie transakcji nie można zwolnić odłączonych poddrzew
+    if (pf == NULL || pf->ctx.transaction)
+        return false;
+
+    // obraz nie może odwoływać się do węzłów odłączonych poddrzew, więc
+    // przed jego zbudowaniem zwalniamy je w całości
+    if (pf->frozen == NULL)
+        phfwdReclaim(pf, SIZE_MAX);
+
+    // obraz jest publikowany dopiero po zbudowaniu
+    if (pf->frozen == NULL)
+        __atomic_store_n(&pf->frozen,
+                         frozenNew(&pf->ctx, pf->rootFwd, pf->rootReverse),
+                         __ATOMIC_RELEASE);
+
+    return pf->frozen != NULL;
+}
+
+bool phfwdSave(PhoneForward *pf, char const *path) {
+    if (pf == NULL || path == NULL)
+        return false;
+
+    return phfwdFreeze(pf) && frozenSave(pf->frozen, path);
+}
+
+PhoneForward *phfwdOpenMapped(char const *path) {
+    if (path == NULL)
+        return NULL;
+
+    PhoneForward *pf = phfwdNew();
     if (pf == NULL)
-        return;
+        return NULL;
 
-    trieDelete(pf->rootFwd);
+    pf->frozen = frozenOpen(path);
+    if (pf->frozen == NULL) {
+        phfwdDelete(pf);
+        return NULL;
+    }
 
-    // wywołanie trieDelete na korzeniu drzewa przekierowań usuwa wszystkie
-    // węzły drzewa odwrotności przekierowań z wyjątkiem korzenia, więc
-    // wystarczy zwolnić pamięć zaalokowaną dla jego korzenia
-    free(pf->rootReverse);
-    free(pf);
+    return pf;
+}
+
+/**
+ * Dodaje przekierowanie poprawnych, różnych numerów @p num1 na @p num2.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] num1    – wskaźnik na napis reprezentujący prefiks numerów
+ *                      przekierowywanych;
+ * @param[in] num2    – wskaźnik na napis reprezentujący prefiks numerów,
+ *                      na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool addForward(PhoneForward *pf, char const *num1, char const *num2) {
+    TrieContext *ctx = &pf->ctx;
+    size_t mark = trieJournalMark(ctx);
+    PoolIndex fwd = trieAdd(ctx, TRIE_FORWARD, pf->rootFwd, num1);
+    PoolIndex reverse = POOL_NULL;
+    char *sourceCopy = NULL;
+
+    if (fwd != POOL_NULL)
+        reverse = trieAdd(ctx, TRIE_REVERSE, pf->rootReverse, num2);
+    if (reverse != POOL_NULL && trieJournalFwdData(ctx, fwd, num1))
+        sourceCopy = reserveReverseFwd(ctx, reverse, num1, num2);
+
+    // gdy zabraknie pamięci, usuwamy węzły dodane do obu drzew
+    if (sourceCopy == NULL) {
+        trieJournalUndo(ctx, mark);
+        return false;
+    }
+
+    // zastępowane przekierowanie numeru num1 znika z wyników zapytań
+    // o numery o jego prefiksie
+    if (pf->cache != NULL) {
+        char const *previous = getFwdNumber(&pf->ctx, fwd);
+
+        if (previous != NULL)
+            queryCacheInvalidate(pf->cache, CACHE_REVERSE, previous);
+        queryCacheInvalidate(pf->cache, CACHE_REVERSE, num2);
+        queryCacheInvalidate(pf->cache, CACHE_GET, num1);
+    }
+
+    setFwdData(ctx, fwd, reverse, sourceCopy);
+    trieJournalRelease(ctx, mark);
+    return true;
 }
 
 bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
     if (pf == NULL)
         return false;
 
-    if (!isCorrect(num1) || !isCorrect(num2) || !strcmp(num1, num2))
+    if (!isCorrect(num1) || !isCorrect(num2) || !strcmp(num1, num2)) {
+        pf->failed = true;
         return false;
+    }
 
-    TrieNode *fwd = trieAdd(pf->rootFwd, num1);
-    if (fwd == NULL)
+    STATS_TIMER_START(timer);
+    bool result = phfwdThaw(pf);
+    epochWriteBegin(pf->ctx.epoch);
+    result = result && addForward(pf, num1, num2);
+    trieReclaim(&pf->ctx, RECLAIM_STEP);
+    epochWriteEnd(pf->ctx.epoch);
+
+    if (!result) {
+        pf->failed = true;
+        STATS_ADD(pf->ctx.stats, allocationFailures, 1);
+    }
+    STATS_TIMER_STOP(pf->ctx.stats, PHFWD_OP_ADD, timer);
+    return result;
+}
+
+bool phfwdAddBulk(PhoneForward *pf, PhoneForwardPair const *pairs,
+                  size_t count) {
+    if (pf == NULL || (pairs == NULL && count > 0))
         return false;
 
-    TrieNode *reverse = trieAdd(pf->rootReverse, num2);
-    if (reverse == NULL) {
-        deleteDeadBranch(fwd);
+    for (size_t i = 0; i < count; ++i) {
+        if (!isCorrect(pairs[i].num1) || !isCorrect(pairs[i].num2) ||
+            !strcmp(pairs[i].num1, pairs[i].num2)) {
+            pf->failed = true;
+            return false;
+        }
+    }
+
+    if (count == 0)
+        return true;
+
+    STATS_TIMER_START(timer);
+    bool result = phfwdThaw(pf) && addPairs(pf, pairs, count);
+    phfwdReclaim(pf, RECLAIM_STEP);
+
+    if (result && pf->cache != NULL) {
+        queryCacheInvalidate(pf->cache, CACHE_GET, "");
+        queryCacheInvalidate(pf->cache, CACHE_REVERSE, "");
+    }
+
+    if (!result) {
+        pf->failed = true;
+        STATS_ADD(pf->ctx.stats, allocationFailures, 1);
+    }
+    STATS_TIMER_STOP(pf->ctx.stats, PHFWD_OP_ADD, timer);
+    return result;
+}
+
+bool phfwdRemove(PhoneForward *pf, char const *num) {
+    if (pf == NULL || !isCorrect(num))
         return false;
+
+    STATS_TIMER_START(timer);
+    bool result = phfwdThaw(pf);
+    epochWriteBegin(pf->ctx.epoch);
+    if (result) {
+        PoolIndex removed = pf->cache != NULL
+                            ? trieFind(&pf->ctx, pf->rootFwd, num)
+                            : POOL_NULL;
+
+        // usuwane przekierowania znikają z wyników zapytań o numery
+        // o prefiksach, na które były one przekierowane; przeglądanie
+        // całego poddrzewa trwałoby tyle, co jego usunięcie, więc jeśli
+        // usuwany jest więcej niż jeden węzeł, unieważniamy wszystkie
+        // wyniki zapytań o odwrotności przekierowań
+        if (removed != POOL_NULL) {
+            char const *target = getFwdNumber(&pf->ctx, removed);
+
+            if (!trieIsLeaf(&pf->ctx, removed))
+                queryCacheInvalidate(pf->cache, CACHE_REVERSE, "");
+            else if (target != NULL)
+                queryCacheInvalidate(pf->cache, CACHE_REVERSE, target);
+            queryCacheInvalidate(pf->cache, CACHE_GET, num);
+        }
+
+        result = trieRemove(&pf->ctx, pf->rootFwd, num);
+        if (!result)
+            pf->failed = true;
     }
+    if (!result)
+        STATS_ADD(pf->ctx.stats, allocationFailures, 1);
+    trieReclaim(&pf->ctx, RECLAIM_STEP);
+    epochWriteEnd(pf->ctx.epoch);
+
+    STATS_TIMER_STOP(pf->ctx.stats, PHFWD_OP_REMOVE, timer);
+    return result;
+}
+
+bool phfwdReclaim(PhoneForward *pf, size_t budget) {
+    if (pf == NULL)
+        return true;
+
+    epochWriteBegin(pf->ctx.epoch);
+    bool result = trieReclaim(&pf->ctx, budget);
+    epochWriteEnd(pf->ctx.epoch);
 
-    if (!addToReverseFwdList(reverse, fwd)) {
-        deleteDeadBranch(fwd);
-        deleteDeadBranch(reverse);
+    return result;
+}
+
+bool phfwdBegin(PhoneForward *pf) {
+    if (pf == NULL || pf->ctx.transaction)
         return false;
+
+    // obraz wczytany z pliku przepisujemy do drzew przed transakcją, więc
+    // jej modyfikacje nie muszą tego robić, a wycofanie nie musi go
+    // przywracać
+    bool result = phfwdThaw(pf);
+    if (result) {
+        trieBegin(&pf->ctx);
+        pf->failed = false;
     }
 
-    deleteFwdData(fwd);
-    setFwdNode(fwd, reverse);
-    setListNode(fwd, getListNode(reverse));
+    return result;
+}
+
+bool phfwdCommit(PhoneForward *pf) {
+    if (pf == NULL || !pf->ctx.transaction)
+        return false;
+
+    if (pf->failed) {
+        phfwdRollback(pf);
+        return false;
+    }
+
+    // zwalnianie odłączonych poddrzew mogłoby alokować pamięć, więc
+    // zostawiamy je kolejnym modyfikacjom
+    epochWriteBegin(pf->ctx.epoch);
+    trieCommit(&pf->ctx);
+    epochWriteEnd(pf->ctx.epoch);
+
     return true;
 }
 
-void phfwdRemove(PhoneForward *pf, char const *num) {
-    if (pf == NULL || !isCorrect(num))
+void phfwdRollback(PhoneForward *pf) {
+    if (pf == NULL || !pf->ctx.transaction)
         return;
 
-    trieRemove(pf->rootFwd, num);
+    epochWriteBegin(pf->ctx.epoch);
+    trieRollback(&pf->ctx);
+    epochWriteEnd(pf->ctx.epoch);
+
+    // wycofane zmiany mogą dotyczyć dowolnych numerów
+    if (pf->cache != NULL) {
+        queryCacheInvalidate(pf->cache, CACHE_GET, "");
+        queryCacheInvalidate(pf->cache, CACHE_REVERSE, "");
+    }
 }
 
-PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
-    if (pf == NULL)
+/** @brief Tworzy wynik funkcji @ref phfwdGet.
+ * Tworzy ciąg zawierający numer powstały z numeru @p num przez zastąpienie
+ * jego pierwszych @p index cyfr numerem @p fwdPrefix.
+ * @param[in] num       – wskaźnik na napis reprezentujący numer;
+ * @param[in] fwdPrefix – wskaźnik na napis reprezentujący numer, na który
+ *                        przekierowany jest prefiks;
+ * @param[in] index     – długość przekierowanego prefiksu.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci.
+ */
+static PhoneNumbers *forwardResult(char const *num, char const *fwdPrefix,
+                                   size_t index) {
+    PhoneNumbers *result = phnumNew();
+
+    if (!phnumSafeAdd(result, num, fwdPrefix, index))
         return NULL;
 
-    if (!isCorrect(num))
-        return phnumNew();
+    return result;
+}
+
+/** @brief Znajduje najdłuższy przekierowany prefiks numeru.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[out] index – długość znalezionego prefiksu.
+ * @return Wskaźnik na napis reprezentujący numer, na który przekierowany
+ *         jest znaleziony prefiks, lub pusty napis, jeśli żaden prefiks nie
+ *         został przekierowany (wtedy @p index wynosi 0).
+ */
+static char const *forwardedPrefix(PhoneForward const *pf, char const *num,
+                                   size_t *index) {
+    FrozenIndex const *image = currentImage(pf);
+    if (image != NULL)
+        return frozenForwardedPrefix(image, num, index);
 
     size_t i = 0;
 
-    TrieNode *maxPrefix = pf->rootFwd;
-    TrieNode *maxCandidate = trieFindNextNonEmpty(maxPrefix, num, &i);
+    PoolIndex maxPrefix = pf->rootFwd;
+    PoolIndex maxCandidate = trieFindNextNonEmpty(&pf->ctx, maxPrefix, num, &i);
 
-    // znajdujemy najdłuższy przekierowany prefiks
-    while (maxCandidate != NULL) {
+    while (maxCandidate != POOL_NULL) {
         maxPrefix = maxCandidate;
-        maxCandidate = trieFindNextNonEmpty(maxPrefix, num, &i);
+        maxCandidate = trieFindNextNonEmpty(&pf->ctx, maxPrefix, num, &i);
     }
 
-    char *fwdNum = changePrefix(num, getFwdNode(maxPrefix), i);
-    PhoneNumbers *result = phnumNew();
-
-    if (!phnumSafeAdd(result, fwdNum))
-        return NULL;
+    // jeśli żaden prefiks nie został przekierowany, to maxPrefix jest
+    // korzeniem, a i = 0
+    char const *fwdPrefix = getFwdNumber(&pf->ctx, maxPrefix);
 
-    return result;
+    *index = i;
+    return fwdPrefix != NULL ? fwdPrefix : "";
 }
 
-PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
+PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
     if (pf == NULL)
         return NULL;
 
     if (!isCorrect(num))
         return phnumNew();
 
-    char *numCopy = malloc((strlen(num) + 1) * sizeof(char));
-    if (numCopy == NULL)
-        return NULL;
+    EpochRead read;
+    PhoneNumbers *result;
+    STATS_TIMER_START(timer);
+
+    PhoneNumbers const *cached = findCached(pf, CACHE_GET, num);
+    if (cached != NULL) {
+        result = phnumCopy(cached);
+    } else {
+        // jeśli w trakcie zapytania struktura była modyfikowana, to wynik
+        // może być niepoprawny i zapytanie trzeba powtórzyć
+        for (;;) {
+            epochReadBegin(pf->ctx.epoch, &read);
+
+            size_t i;
+            char const *fwdPrefix = forwardedPrefix(pf, num, &i);
+            result = forwardResult(num, fwdPrefix, i);
+
+            if (epochReadEnd(pf->ctx.epoch, &read))
+                break;
+            phnumDelete(result);
+        }
+
+        storeCached(pf, CACHE_GET, num, result);
+    }
+
+    if (result == NULL)
+        STATS_ADD(pf->ctx.stats, allocationFailures, 1);
+    STATS_TIMER_STOP(pf->ctx.stats, PHFWD_OP_GET, timer);
+    return result;
+}
+
+size_t phfwdGetInto(PhoneForward const *pf, char const *num, char *buf,
+                    size_t bufLen) {
+    if (pf == NULL || !isCorrect(num))
+        return 0;
+
+    EpochRead read;
+    size_t length;
+    STATS_TIMER_START(timer);
+
+    // zapamiętany wynik jest pełnym numerem, więc podmieniamy cały numer
+    PhoneNumbers const *cached = findCached(pf, CACHE_GET, num);
+    if (cached != NULL) {
+        length = changePrefixInto(num, phnumGet(cached, 0), strlen(num), buf,
+                                  bufLen);
+    } else {
+        for (;;) {
+            epochReadBegin(pf->ctx.epoch, &read);
+
+            size_t i;
+            char const *fwdPrefix = forwardedPrefix(pf, num, &i);
+            length = changePrefixInto(num, fwdPrefix, i, buf, bufLen);
+
+            if (epochReadEnd(pf->ctx.epoch, &read))
+                break;
+        }
+    }
+
+    STATS_TIMER_STOP(pf->ctx.stats, PHFWD_OP_GET, timer);
+    return length;
+}
+
+void phfwdGetBatch(PhoneForward const *pf, char const *const *nums,
+                   size_t count, PhoneNumbers **out) {
+    // obraz drzew jest zwarty, więc pojedyncze zapytania na nim nie
+    // wymagają przeplatania
+    if (pf == NULL || currentImage(pf) != NULL) {
+        for (size_t k = 0; k < count; ++k)
+            out[k] = phfwdGet(pf, nums[k]);
+        return;
+    }
+
+    char const *valid[GET_BATCH_CHUNK];
+    size_t positions[GET_BATCH_CHUNK];
+    PoolIndex nodes[GET_BATCH_CHUNK];
+    size_t indices[GET_BATCH_CHUNK];
+    EpochRead read;
+
+    for (size_t start = 0; start < count; start += GET_BATCH_CHUNK) {
+        size_t end = count - start < GET_BATCH_CHUNK ?
+                     count : start + GET_BATCH_CHUNK;
+        size_t validCount = 0;
+
+        // niepoprawne numery od razu otrzymują pusty wynik, a pozostałe
+        // wyszukujemy jednocześnie
+        for (size_t k = start; k < end; ++k) {
+            if (isCorrect(nums[k])) {
+                valid[validCount] = nums[k];
+                positions[validCount] = k;
+                ++validCount;
+            } else {
+                out[k] = phnumNew();
+            }
+        }
+
+        bool consistent = false;
+        while (!consistent) {
+            epochReadBegin(pf->ctx.epoch, &read);
+            trieFindLongestBatch(&pf->ctx, pf->rootFwd, valid, validCount,
+                                 nodes, indices);
+
+            for (size_t j = 0; j < validCount; ++j) {
+                char const *fwdPrefix = getFwdNumber(&pf->ctx, nodes[j]);
+
+                out[positions[j]] = forwardResult(
+                        valid[j], fwdPrefix != NULL ? fwdPrefix : "",
+                        indices[j]);
+            }
+
+            consistent = epochReadEnd(pf->ctx.epoch, &read);
+            if (!consistent)
+                for (size_t j = 0; j < validCount; ++j)
+                    phnumDelete(out[positions[j]]);
+        }
+    }
+}
+
+/**
+ * Wyznacza wynik funkcji @ref phfwdReverse dla poprawnego numeru.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci.
+ */
+static PhoneNumbers *reverseNumbers(PhoneForward const *pf, char const *num) {
+    FrozenIndex const *image = currentImage(pf);
+    if (image != NULL)
+        return frozenReverse(image, num);
 
     PhoneNumbers *result = phnumNew();
 
     // dodajemy numer num do wyniku
-    strcpy(numCopy, num);
-    if (!phnumSafeAdd(result, numCopy))
+    if (!phnumSafeAdd(result, num, "", 0))
         return NULL;
 
     size_t i = 0;
-    TrieNode *currPrefix = trieFindNextNonEmpty(pf->rootReverse, num, &i);
+    size_t added = 1;
+    PoolIndex currPrefix = trieFindNextNonEmpty(&pf->ctx, pf->rootReverse,
+                                                num, &i);
 
     // przechodzimy przez wszystkie węzły odpowiadające prefiksom,
     // na które został przekierowany przynajmniej jeden prefiks
-    while (currPrefix != NULL) {
+    while (currPrefix != POOL_NULL) {
         // przechodzimy przez wszystkie prefiksy, które zostały przekierowane
         // na aktualny i dodajemy odpowiednie numery do wyniku
-        ListNode *currListNode = getListNode(currPrefix);
-        while (currListNode != NULL) {
-            char *reverseNum = changePrefix(num, getKey(currListNode), i);
-
-            if (!phnumSafeAdd(result, reverseNum))
+        SourceArray const *sources = getSources(&pf->ctx, currPrefix);
+        size_t length = sources == NULL ? 0 : sourceArrayLength(sources);
+        for (size_t k = 0; k < length; ++k) {
+            if (trieIsDetached(&pf->ctx, pf->rootFwd,
+                               sourceArrayNode(sources, k),
+                               sourceArraySource(sources, k)))
+                continue;
+
+            if (!phnumSafeAdd(result, num, sourceArraySource(sources, k), i))
                 return NULL;
 
-            currListNode = getNext(currListNode);
+            ++added;
         }
 
-        currPrefix = trieFindNextNonEmpty(currPrefix, num, &i);
+        currPrefix = trieFindNextNonEmpty(&pf->ctx, currPrefix, num, &i);
     }
 
-    lexSort(result);
-    if (!removeDuplicates(&result)) {
+    STATS_ADD(pf->ctx.stats, reverseQueries, 1);
+    STATS_ADD(pf->ctx.stats, reverseCandidates, added);
+    STATS_RECORD(pf->ctx.stats, sortSizes, added);
+    if (!phnumSort(result)) {
         phnumDelete(result);
         return NULL;
     }
+    phnumRemoveDuplicates(result);
     return result;
 }
 
-PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
+PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
     if (pf == NULL)
         return NULL;
 
     if (!isCorrect(num))
         return phnumNew();
 
+    EpochRead read;
+    PhoneNumbers *result;
+    STATS_TIMER_START(timer);
+
+    PhoneNumbers const *cached = findCached(pf, CACHE_REVERSE, num);
+    if (cached != NULL) {
+        result = phnumCopy(cached);
+    } else {
+        for (;;) {
+            epochReadBegin(pf->ctx.epoch, &read);
+            result = reverseNumbers(pf, num);
+
+            if (epochReadEnd(pf->ctx.epoch, &read))
+                break;
+            phnumDelete(result);
+        }
+
+        storeCached(pf, CACHE_REVERSE, num, result);
+    }
+
+    if (result == NULL)
+        STATS_ADD(pf->ctx.stats, allocationFailures, 1);
+    STATS_TIMER_STOP(pf->ctx.stats, PHFWD_OP_REVERSE, timer);
+    return result;
+}
+
+/**
+ * Wyznacza wynik funkcji @ref phfwdGetReverse dla poprawnego numeru.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci.
+ */
+static PhoneNumbers *getReverseNumbers(PhoneForward const *pf,
+                                       char const *num) {
+    FrozenIndex const *image = currentImage(pf);
+    if (image != NULL)
+        return frozenGetReverse(image, num);
+
     size_t i = 0;
+    size_t candidates = 1;
+    size_t added = 0;
     PhoneNumbers *result = phnumNew();
     if (result == NULL)
         return NULL;
 
     // sprawdzamy, czy numer num został przekierowany i jeśli nie,
     // to dodajemy go do wyniku
-    if (trieFindNextNonEmpty(pf->rootFwd, num, &i) == NULL) {
-        char *numCopy = malloc((strlen(num) + 1) * sizeof(char));
-        if (numCopy == NULL) {
-            phnumDelete(result);
-            return NULL;
-        }
-
-        strcpy(numCopy, num);
-        if (!phnumSafeAdd(result, numCopy))
+    if (trieFindNextNonEmpty(&pf->ctx, pf->rootFwd, num, &i) == POOL_NULL) {
+        if (!phnumSafeAdd(result, num, "", 0))
             return NULL;
+        ++added;
     }
 
     i = 0;
-    TrieNode *currPrefix = trieFindNextNonEmpty(pf->rootReverse, num, &i);
+    PoolIndex currPrefix = trieFindNextNonEmpty(&pf->ctx, pf->rootReverse,
+                                                num, &i);
 
     // przechodzimy przez wszystkie węzły odpowiadające prefiksom,
     // na które został przekierowany przynajmniej jeden prefiks
-    while (currPrefix != NULL) {
+    while (currPrefix != POOL_NULL) {
         // przechodzimy przez wszystkie prefiksy, które zostały przekierowane
         // na aktualny
-        ListNode *currListNode = getListNode(currPrefix);
-        while (currListNode != NULL) {
+        SourceArray const *sources = getSources(&pf->ctx, currPrefix);
+        size_t length = sources == NULL ? 0 : sourceArrayLength(sources);
+        for (size_t k = 0; k < length; ++k) {
             size_t j = i;
-            TrieNode *fwdNode = getKey(currListNode);
 
-            // sprawdzamy, czy numer nie został dalej przekierowany i jeśli
-            // nie, to dodajemy go do wyniku
-            if (trieFindNextNonEmpty(fwdNode, num, &j) == NULL) {
-                char *reverseNum = changePrefix(num, fwdNode, i);
+            if (trieIsDetached(&pf->ctx, pf->rootFwd,
+                               sourceArrayNode(sources, k),
+                               sourceArraySource(sources, k)))
+                continue;
 
-                if (!phnumSafeAdd(result, reverseNum))
+            ++candidates;
+            // sprawdzamy, czy numer nie został dalej przekierowany i jeśli
+            // nie, to dodajemy go do wyniku; przekierowania liścia nic nie
+            // przesłania, więc schodzimy w drzewie tylko od węzłów mających
+            // synów
+            if (sourceArrayIsLeaf(sources, k) ||
+                trieFindNextNonEmpty(&pf->ctx, sourceArrayNode(sources, k),
+                                     num, &j) == POOL_NULL) {
+                char const *source = sourceArraySource(sources, k);
+
+                if (!phnumSafeAdd(result, num, source, i))
                     return NULL;
+                ++added;
             }
-
-            currListNode = getNext(currListNode);
         }
 
-        currPrefix = trieFindNextNonEmpty(currPrefix, num, &i);
+        currPrefix = trieFindNextNonEmpty(&pf->ctx, currPrefix, num, &i);
     }
 
+    STATS_ADD(pf->ctx.stats, reverseQueries, 1);
+    STATS_ADD(pf->ctx.stats, reverseCandidates, candidates);
+    STATS_RECORD(pf->ctx.stats, sortSizes, added);
+
     // powyższy algorytm nigdy nie dodaje do wyniku dwa razy tego samego
     // numeru, więc nie trzeba usuwać duplikatów
-    lexSort(result);
+    if (!phnumSort(result)) {
+        phnumDelete(result);
+        return NULL;
+    }
     return result;
-}
\ No newline at end of file
+}
+
+PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
+    if (pf == NULL)
+        return NULL;
+
+    if (!isCorrect(num))
+        return phnumNew();
+
+    EpochRead read;
+    PhoneNumbers *result;
+    STATS_TIMER_START(timer);
+
+    for (;;) {
+        epochReadBegin(pf->ctx.epoch, &read);
+        result = getReverseNumbers(pf, num);
+
+        if (epochReadEnd(pf->ctx.epoch, &read))
+            break;
+        phnumDelete(result);
+    }
+
+    if (result == NULL)
+        STATS_ADD(pf->ctx.stats, allocationFailures, 1);
+    STATS_TIMER_STOP(pf->ctx.stats, PHFWD_OP_GET_REVERSE, timer);
+    return result;
+}
+
+/**
+ * Dodaje do kursora numery z wyniku funkcji @ref phfwdReverse lub
+ * @ref phfwdGetReverse dla poprawnego numeru, bez ich sortowania.
+ * @param[in] pf          – wskaźnik na strukturę przechowującą przekierowania
+ *                          numerów;
+ * @param[in] num         – wskaźnik na napis reprezentujący numer;
+ * @param[in] unforwarded – wartość @p true, jeśli należy pominąć numery
+ *                          przekierowane dalej (wynik funkcji
+ *                          @ref phfwdGetReverse);
+ * @param[in, out] cursor – wskaźnik na kursor.
+ * @return Wartość @p true, jeśli numery zostały dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool collectReverse(PhoneForward const *pf, char const *num,
+                           bool unforwarded, PhfwdReverseCursor *cursor) {
+    FrozenIndex const *image = currentImage(pf);
+    if (image != NULL)
+        return frozenCollectReverse(image, num, unforwarded, cursor);
+
+    size_t i = 0;
+
+    if (!unforwarded ||
+        trieFindNextNonEmpty(&pf->ctx, pf->rootFwd, num, &i) == POOL_NULL) {
+        if (!reverseCursorAdd(cursor, "", 0))
+            return false;
+    }
+
+    i = 0;
+    PoolIndex currPrefix = trieFindNextNonEmpty(&pf->ctx, pf->rootReverse,
+                                                num, &i);
+
+    while (currPrefix != POOL_NULL) {
+        SourceArray const *sources = getSources(&pf->ctx, currPrefix);
+        size_t length = sources == NULL ? 0 : sourceArrayLength(sources);
+        for (size_t k = 0; k < length; ++k) {
+            PoolIndex node = sourceArrayNode(sources, k);
+            size_t j = i;
+
+            // tak jak w funkcji getReverseNumbers schodzimy w drzewie tylko
+            // od węzłów mających synów
+            if (trieIsDetached(&pf->ctx, pf->rootFwd, node,
+                               sourceArraySource(sources, k)) ||
+                (unforwarded && !sourceArrayIsLeaf(sources, k) &&
+                 trieFindNextNonEmpty(&pf->ctx, node, num, &j) != POOL_NULL))
+                continue;
+
+            if (!reverseCursorAdd(cursor, sourceArraySource(sources, k), i))
+                return false;
+        }
+
+        currPrefix = trieFindNextNonEmpty(&pf->ctx, currPrefix, num, &i);
+    }
+
+    return true;
+}
+
+/**
+ * Otwiera kursor po wyniku funkcji @ref phfwdReverse lub
+ * @ref phfwdGetReverse.
+ * @param[in] pf          – wskaźnik na strukturę przechowującą przekierowania
+ *                          numerów;
+ * @param[in] num         – wskaźnik na napis reprezentujący numer;
+ * @param[in] unforwarded – wartość @p true dla wyniku funkcji
+ *                          @ref phfwdGetReverse.
+ * @return Wskaźnik na kursor lub NULL, gdy nie udało się alokować pamięci
+ *         lub wskaźnik @p pf wynosi NULL.
+ */
+static PhfwdReverseCursor *openCursor(PhoneForward const *pf, char const *num,
+                                      bool unforwarded) {
+    if (pf == NULL)
+        return NULL;
+
+    bool correct = isCorrect(num);
+    EpochRead read;
+
+    // wynik funkcji phfwdGetReverse nie zawiera powtórzeń
+    PhfwdReverseCursor *cursor = reverseCursorNew(correct ? num : "",
+                                                  !unforwarded);
+    if (cursor == NULL)
+        return NULL;
+
+    bool collected = true;
+    for (;;) {
+        epochReadBegin(pf->ctx.epoch, &read);
+        if (correct)
+            collected = collectReverse(pf, num, unforwarded, cursor);
+
+        if (epochReadEnd(pf->ctx.epoch, &read))
+            break;
+        reverseCursorClear(cursor);
+    }
+
+    if (!collected || !reverseCursorStart(cursor)) {
+        STATS_ADD(pf->ctx.stats, allocationFailures, 1);
+        phfwdReverseClose(cursor);
+        return NULL;
+    }
+
+    if (correct) {
+        STATS_ADD(pf->ctx.stats, reverseQueries, 1);
+        STATS_ADD(pf->ctx.stats, reverseCandidates,
+                  reverseCursorCount(cursor));
+    }
+    return cursor;
+}
+
+PhfwdReverseCursor *phfwdReverseOpen(PhoneForward const *pf,
+                                     char const *num) {
+    return openCursor(pf, num, false);
+}
+
+PhfwdReverseCursor *phfwdGetReverseOpen(PhoneForward const *pf,
+                                        char const *num) {
+    return openCursor(pf, num, true);
+}
+
+/** @brief Sprawdza, czy numer wyniku powtarza się w wyniku zapytania.
+ * Sprawdza, czy numer powstały z numeru @p num przez zastąpienie jego
+ * pierwszych @p i cyfr numerem węzła @p node drzewa przekierowań powstaje
+ * też z przekierowania dłuższego prefiksu – potomka węzła @p node
+ * przedłużonego o cyfry @p num od @p i do @p j, który przekierowano na
+ * pierwsze @p j cyfr @p num.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                   numerów;
+ * @param[in] node – indeks przekierowanego węzła drzewa przekierowań;
+ * @param[in] num  – wskaźnik na napis reprezentujący numer;
+ * @param[in] i    – długość prefiksu @p num, na który przekierowano węzeł.
+ * @return Wartość @p true, jeśli taki potomek istnieje.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool hasEquivalentDescendant(PhoneForward const *pf, PoolIndex node,
+                                    char const *num, size_t i) {
+    size_t j = i;
+    PoolIndex current = trieFindNextNonEmpty(&pf->ctx, node, num, &j);
+
+    while (current != POOL_NULL) {
+        char const *target = getFwdNumber(&pf->ctx, current);
+
+        if (target != NULL && strncmp(target, num, j) == 0 &&
+            target[j] == '\0')
+            return true;
+
+        current = trieFindNextNonEmpty(&pf->ctx, current, num, &j);
+    }
+
+    return false;
+}
+
+/** @brief Wyznacza liczbę numerów wyniku zapytania o odwrotność.
+ * Wyznacza liczbę numerów w wyniku funkcji @ref phfwdReverse lub
+ * @ref phfwdGetReverse dla poprawnego numeru. Numer z wyniku
+ * @ref phfwdReverse powtarza się wtedy i tylko wtedy, gdy powstaje też
+ * z przekierowania potomka węzła, którego przekierowanie go wyznacza,
+ * przedłużonego o te same cyfry co numer docelowy – zliczany jest więc
+ * tylko numer wyznaczony przez najdłuższy przekierowany prefiks. Liście
+ * drzewa nie mają potomków, więc elementy tablic odpowiadające liściom
+ * (zawsze na ich końcu) zliczane są bez przeglądania, chyba że trzeba
+ * pominąć węzły odłączonych poddrzew.
+ * @param[in] pf          – wskaźnik na strukturę przechowującą przekierowania
+ *                          numerów;
+ * @param[in] num         – wskaźnik na napis reprezentujący numer;
+ * @param[in] unforwarded – wartość @p true dla wyniku funkcji
+ *                          @ref phfwdGetReverse.
+ * @return Liczba numerów wyniku.
+ */
+static size_t countReverse(PhoneForward const *pf, char const *num,
+                           bool unforwarded) {
+    // obraz wczytany z pliku jest jedyną kopią przekierowań, a pozostałe
+    // obrazy nie mają liczników, więc korzystamy z drzew
+    FrozenIndex const *image = currentImage(pf);
+    if (image != NULL && frozenIsMapped(image))
+        return frozenReverseCount(image, num, unforwarded);
+
+    size_t i = 0;
+    size_t count = 0;
+    size_t candidates = 0;
+    bool detached = trieHasDetached(&pf->ctx);
+
+    if (!unforwarded ||
+        trieFindNextNonEmpty(&pf->ctx, pf->rootFwd, num, &i) == POOL_NULL)
+        ++count;
+
+    i = 0;
+    PoolIndex currPrefix = trieFindNextNonEmpty(&pf->ctx, pf->rootReverse,
+                                                num, &i);
+
+    while (currPrefix != POOL_NULL) {
+        SourceArray const *sources = getSources(&pf->ctx, currPrefix);
+        size_t length = sources == NULL ? 0 : sourceArrayLength(sources);
+        size_t inner = sources == NULL ? 0 : sourceArrayInnerLength(sources);
+
+        // współbieżna modyfikacja może chwilowo zaburzyć te wartości, ale
+        // wynik zostanie wtedy i tak odrzucony
+        if (inner > length)
+            inner = length;
+
+        // elementy liści przeglądamy tylko wtedy, gdy trzeba pominąć węzły
+        // odłączonych poddrzew
+        size_t end = detached ? length : inner;
+        count += length - end;
+
+        for (size_t k = 0; k < end; ++k) {
+            PoolIndex node = sourceArrayNode(sources, k);
+            size_t j = i;
+
+            ++candidates;
+            if (trieIsDetached(&pf->ctx, pf->rootFwd, node,
+                               sourceArraySource(sources, k)))
+                continue;
+
+            if (k >= inner ||
+                (unforwarded
+                 ? trieFindNextNonEmpty(&pf->ctx, node, num, &j) == POOL_NULL
+                 : !hasEquivalentDescendant(pf, node, num, i)))
+                ++count;
+        }
+
+        currPrefix = trieFindNextNonEmpty(&pf->ctx, currPrefix, num, &i);
+    }
+
+    STATS_ADD(pf->ctx.stats, reverseQueries, 1);
+    STATS_ADD(pf->ctx.stats, reverseCandidates, candidates);
+    return count;
+}
+
+/**
+ * Wyznacza liczbę numerów w wyniku funkcji @ref phfwdReverse lub
+ * @ref phfwdGetReverse, powtarzając wyznaczanie, jeśli w jego trakcie
+ * struktura była modyfikowana.
+ * @param[in] pf          – wskaźnik na strukturę przechowującą przekierowania
+ *                          numerów;
+ * @param[in] num         – wskaźnik na napis reprezentujący numer;
+ * @param[in] unforwarded – wartość @p true dla wyniku funkcji
+ *                          @ref phfwdGetReverse.
+ * @return Liczba numerów wyniku lub 0, jeśli podany napis nie reprezentuje
+ *         numeru lub wskaźnik @p pf wynosi NULL.
+ */
+static size_t reverseCount(PhoneForward const *pf, char const *num,
+                           bool unforwarded) {
+    if (pf == NULL || !isCorrect(num))
+        return 0;
+
+    EpochRead read;
+    size_t count;
+
+    do {
+        epochReadBegin(pf->ctx.epoch, &read);
+        count = countReverse(pf, num, unforwarded);
+    } while (!epochReadEnd(pf->ctx.epoch, &read));
+
+    return count;
+}
+
+size_t phfwdReverseCount(PhoneForward const *pf, char const *num) {
+    return reverseCount(pf, num, false);
+}
+
+size_t phfwdGetReverseCount(PhoneForward const *pf, char const *num) {
+    return reverseCount(pf, num, true);
+}
@@ -12,6 +12,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * To jest struktura przechowująca przekierowania numerów telefonów.
@@ -33,6 +34,141 @@ struct PhoneNumbers;
  */
 typedef struct PhoneNumbers PhoneNumbers;
 
+/**
+ * To jest struktura zwracająca kolejno numery z wyniku zapytania
+ * o odwrotność przekierowań (zob. @ref phfwdReverseOpen).
+ */
+struct PhfwdReverseCursor;
+
+/**
+ * Typ @p PhfwdReverseCursor reprezentuje strukturę @p PhfwdReverseCursor.
+ */
+typedef struct PhfwdReverseCursor PhfwdReverseCursor;
+
+/**
+ * Para numerów opisująca przekierowanie dodawane przez funkcję
+ * @ref phfwdAddBulk.
+ */
+typedef struct PhoneForwardPair {
+    char const *num1; ///< prefiks numerów przekierowywanych
+    char const *num2; ///< prefiks numerów, na które są one przekierowywane
+} PhoneForwardPair;
+
+/**
+ * Liczba przedziałów histogramów w strukturze @ref PhfwdStats. Przedział
+ * @p b zlicza wartości z zakresu [2^@p b, 2^(@p b + 1)), przedział 0 –
+ * również wartość 0, a ostatni przedział – wszystkie większe wartości.
+ */
+#define PHFWD_HISTOGRAM_BUCKETS 32
+
+/**
+ * Operacje, których czas mierzony jest w strukturze @ref PhfwdStats.
+ */
+typedef enum PhfwdOperation {
+    PHFWD_OP_ADD, ///< @ref phfwdAdd i @ref phfwdAddBulk
+    PHFWD_OP_REMOVE, ///< @ref phfwdRemove
+    PHFWD_OP_GET, ///< @ref phfwdGet i @ref phfwdGetInto
+    PHFWD_OP_REVERSE, ///< @ref phfwdReverse
+    PHFWD_OP_GET_REVERSE, ///< @ref phfwdGetReverse
+    PHFWD_OP_COUNT ///< liczba mierzonych operacji
+} PhfwdOperation;
+
+/**
+ * Liczniki operacji wykonanych na strukturze PhoneForward, zbierane tylko
+ * wtedy, gdy biblioteka została skompilowana z makrem @p PHFWD_STATS.
+ * Wszystkie pola są licznikami typu @p uint64_t.
+ */
+typedef struct PhfwdStats {
+    uint64_t nodesAllocated; ///< liczba przydzielonych węzłów drzew
+    uint64_t nodesFreed; ///< liczba zwolnionych węzłów drzew
+    uint64_t walks; ///< liczba przejść w głąb drzewa po kolejnych prefiksach
+    uint64_t walkNodes; ///< liczba węzłów odwiedzonych w tych przejściach
+    uint64_t reverseQueries; ///< liczba zapytań o odwrotność na drzewach
+    /** łączna liczba numerów kandydujących do wyniku w tych zapytaniach */
+    uint64_t reverseCandidates;
+    uint64_t allocationFailures; /**< liczba operacji przerwanych z powodu
+                                 braku pamięci */
+    /** histogram liczby numerów sortowanych w zapytaniach o odwrotność */
+    uint64_t sortSizes[PHFWD_HISTOGRAM_BUCKETS];
+    /** histogramy czasu operacji w nanosekundach */
+    uint64_t latency[PHFWD_OP_COUNT][PHFWD_HISTOGRAM_BUCKETS];
+} PhfwdStats;
+
+/**
+ * Liczniki i rozmiar pamięci podręcznej wyników zapytań włączonej funkcją
+ * @ref phfwdEnableCache.
+ */
+typedef struct PhfwdCacheStats {
+    uint64_t hits; ///< liczba zapytań, których wynik był zapamiętany
+    uint64_t misses; ///< liczba zapytań, których wyniku nie było
+    uint64_t insertions; ///< liczba zapamiętanych wyników
+    uint64_t evictions; /**< liczba wyników usuniętych, aby zrobić miejsce
+                        dla nowych */
+    uint64_t invalidations; /**< liczba wyników usuniętych, bo mogły się
+                            zmienić po modyfikacji struktury */
+    size_t entries; ///< liczba przechowywanych wyników
+    size_t capacity; ///< największa liczba przechowywanych wyników
+    size_t bytes; ///< pamięć zajmowana przez pamięć podręczną i wyniki
+} PhfwdCacheStats;
+
+/**
+ * Liczba przedziałów histogramu stopni węzłów w strukturze
+ * @ref PhfwdTreeUsage. Przedział @p k zlicza węzły mające @p k synów.
+ */
+#define PHFWD_FANOUT_BUCKETS 13
+
+/**
+ * Liczba przedziałów histogramu głębokości węzłów w strukturze
+ * @ref PhfwdTreeUsage. Przedział @p k zlicza węzły odpowiadające numerom
+ * o @p k cyfrach, a ostatni przedział – również numerom dłuższym.
+ */
+#define PHFWD_DEPTH_BUCKETS 32
+
+/**
+ * Liczba obiektów jednego rodzaju i zajmowana przez nie pamięć.
+ */
+typedef struct PhfwdObjectUsage {
+    size_t count; ///< liczba obiektów
+    size_t bytes; ///< łączny rozmiar obiektów w bajtach
+} PhfwdObjectUsage;
+
+/**
+ * Rozmiar i kształt jednego z drzew struktury PhoneForward.
+ */
+typedef struct PhfwdTreeUsage {
+    PhfwdObjectUsage nodes; ///< wszystkie węzły drzewa wraz z korzeniem
+    /** puste węzły różne od korzenia, które istnieją tylko dlatego, że
+        prowadzą do innych węzłów (są one wliczone również w @p nodes) */
+    PhfwdObjectUsage passThrough;
+    size_t fanOut[PHFWD_FANOUT_BUCKETS]; ///< histogram liczby synów węzłów
+    /** histogram długości numerów odpowiadających niepustym węzłom */
+    size_t depth[PHFWD_DEPTH_BUCKETS];
+} PhfwdTreeUsage;
+
+/**
+ * Raport o pamięci zajmowanej przez strukturę PhoneForward, wypełniany
+ * przez funkcję @ref phfwdMemoryUsage.
+ */
+typedef struct PhfwdMemoryReport {
+    PhfwdTreeUsage forward; ///< drzewo przekierowań
+    PhfwdTreeUsage reverse; ///< drzewo odwrotności przekierowań
+    /** elementy tablic numerów w węzłach drzewa odwrotności przekierowań,
+        po jednym dla każdego przekierowania; rozmiar obejmuje całe bloki
+        tablic wraz z niezajętymi miejscami i numerami, na które
+        przekierowane są numery tablic */
+    PhfwdObjectUsage sourceEntries;
+    /** kopie numerów przekierowywanych przechowywane w tablicach */
+    PhfwdObjectUsage strings;
+    size_t longestReverseList; /**< największa liczba numerów przekierowanych
+                               na ten sam numer */
+    size_t imageBytes; /**< rozmiar obrazu utworzonego funkcją
+                       @ref phfwdFreeze lub wczytanego funkcją
+                       @ref phfwdOpenMapped (0, jeśli go nie ma) */
+    size_t reservedBytes; /**< pamięć zarezerwowana przez strukturę wraz
+                          z nieprzydzielonymi częściami pul, obrazem
+                          i pamięcią podręczną zapytań */
+} PhfwdMemoryReport;
+
 /** @brief Tworzy nową strukturę.
  * Tworzy nową strukturę niezawierającą żadnych przekierowań.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
@@ -66,16 +202,294 @@ void phfwdDelete(PhoneForward *pf);
  */
 bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2);
 
+/** @brief Dodaje wiele przekierowań naraz.
+ * Dodaje przekierowania @p pairs[0], ..., @p pairs[count - 1] tak, jak
+ * zrobiłyby to kolejne wywołania @ref phfwdAdd (w szczególności z kilku par
+ * o takim samym numerze @p num1 obowiązuje ostatnia). Pary są sortowane
+ * według @p num1, więc kolejne zejścia w drzewie przekierowań zaczynają się
+ * od wspólnego prefiksu z poprzednim numerem zamiast od korzenia. Jeśli pary
+ * są już posortowane (w porządku funkcji strcmp), sortowanie jest pomijane.
+ * Przekierowania są dodawane w całości albo wcale: jeśli któraś para jest
+ * niepoprawna lub nie uda się alokować pamięci, struktura się nie zmienia.
+ * Współbieżne zapytania (zob. @ref phfwdEnableConcurrentReads) nie czekają
+ * na koniec całego dodawania, więc mogą zobaczyć część nowych
+ * przekierowań, a gdy zabraknie pamięci – część z nich przed wycofaniem.
+ * @param[in,out] pf  – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] pairs   – tablica par numerów;
+ * @param[in] count   – liczba par.
+ * @return Wartość @p true, jeśli przekierowania zostały dodane.
+ *         Wartość @p false, jeśli wystąpił błąd, np. któryś z napisów nie
+ *         reprezentuje numeru, numery w którejś parze są identyczne, nie
+ *         udało się alokować pamięci lub wskaźnik @p pf ma wartość NULL.
+ */
+bool phfwdAddBulk(PhoneForward *pf, PhoneForwardPair const *pairs,
+                  size_t count);
+
 /** @brief Usuwa przekierowania.
  * Usuwa wszystkie przekierowania, w których parametr @p num jest prefiksem
  * parametru @p num1 użytego przy dodawaniu. Jeśli nie ma takich przekierowań,
  * wskaźnik @p pf ma wartość NULL lub napis nie reprezentuje numeru,
- * nic nie robi.
+ * nic nie robi. Nic nie robi również wtedy, gdy struktura została wczytana
+ * funkcją @ref phfwdOpenMapped i nie udało się alokować pamięci na
+ * przepisanie przekierowań z pliku albo w trakcie transakcji zabrakło
+ * pamięci na wpis dziennika – wówczas zwraca @p false. Usunięcie trwa
+ * proporcjonalnie do długości @p num, a nie do liczby usuwanych
+ * przekierowań: usuwane poddrzewo jest jedynie odłączane od struktury
+ * i przestaje być widoczne w wynikach zapytań, a jego pamięć zwalniana
+ * jest stopniowo – po kilka węzłów przy każdej kolejnej modyfikacji
+ * struktury – lub przez funkcję @ref phfwdReclaim.
  * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
  *                     numerów;
  * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli przekierowania zostały usunięte lub nie ma
+ *         przekierowań do usunięcia.
+ *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
+ *         reprezentuje numeru, nie udało się alokować pamięci lub wskaźnik
+ *         @p pf ma wartość NULL.
+ */
+bool phfwdRemove(PhoneForward *pf, char const *num);
+
+/** @brief Zwalnia pamięć usuniętych przekierowań.
+ * Zwalnia pamięć przekierowań usuniętych funkcją @ref phfwdRemove, które nie
+ * zostały jeszcze zwolnione, wykonując co najwyżej @p budget kroków. Każdy
+ * krok zwalnia jeden węzeł drzewa przekierowań albo przechodzi do kolejnego
+ * węzła, więc zwolnienie @p n węzłów wymaga co najwyżej 2 @p n kroków.
+ * Pozwala zwolnić pamięć w wybranym momencie, np. gdy
+ * struktura nie jest obciążona, zamiast stopniowo przy kolejnych
+ * modyfikacjach. Wyniki zapytań nie zależą od tego, czy pamięć została
+ * zwolniona. W trakcie transakcji (zob. @ref phfwdBegin) nie zwalnia
+ * niczego. Funkcja jest modyfikacją struktury w rozumieniu
+ * @ref phfwdEnableConcurrentReads.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] budget – największa liczba kroków (SIZE_MAX zwalnia całą
+ *                     pamięć usuniętych przekierowań).
+ * @return Wartość @p true, jeśli pamięć wszystkich usuniętych przekierowań
+ *         została zwolniona lub wskaźnik @p pf ma wartość NULL.
+ *         Wartość @p false, jeśli pozostały przekierowania do zwolnienia.
+ */
+bool phfwdReclaim(PhoneForward *pf, size_t budget);
+
+/** @brief Rozpoczyna transakcję.
+ * Rozpoczyna transakcję: kolejne modyfikacje struktury (@ref phfwdAdd,
+ * @ref phfwdAddBulk i @ref phfwdRemove) stanowią jedną całość, którą
+ * zatwierdza funkcja @ref phfwdCommit lub wycofuje funkcja
+ * @ref phfwdRollback. Zmiany zapisywane są w dzienniku, a każda
+ * modyfikacja już przy wykonaniu rezerwuje całą pamięć potrzebną do jej
+ * zatwierdzenia lub wycofania, więc żadna z tych funkcji nie alokuje
+ * pamięci ani nie może zostać przerwana w połowie. Obie działają w czasie
+ * proporcjonalnym do liczby zmian transakcji, a nie do rozmiaru struktury.
+ * Zmiany są widoczne w wynikach zapytań od razu, również współbieżnych.
+ * Do końca transakcji pamięć usuniętych przekierowań nie jest zwalniana
+ * (zob. @ref phfwdReclaim), a funkcje @ref phfwdFreeze i @ref phfwdSave
+ * zwracają @p false. Transakcji nie można zagnieżdżać. Funkcja jest
+ * modyfikacją struktury w rozumieniu @ref phfwdEnableConcurrentReads.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli transakcja została rozpoczęta.
+ *         Wartość @p false, jeśli transakcja już trwa, struktura została
+ *         wczytana funkcją @ref phfwdOpenMapped i nie udało się alokować
+ *         pamięci na przepisanie przekierowań z pliku lub wskaźnik @p pf
+ *         ma wartość NULL.
+ */
+bool phfwdBegin(PhoneForward *pf);
+
+/** @brief Zatwierdza transakcję.
+ * Kończy transakcję rozpoczętą funkcją @ref phfwdBegin, zachowując jej
+ * zmiany, o ile wszystkie modyfikacje transakcji się powiodły. Jeśli
+ * któraś się nie powiodła (@ref phfwdAdd, @ref phfwdAddBulk lub
+ * @ref phfwdRemove zwróciła @p false z powodu braku pamięci), wycofuje
+ * całą transakcję tak jak @ref phfwdRollback. Nie alokuje pamięci, również
+ * na odroczone zwolnienie usuwanych obiektów, na które miejsce
+ * zarezerwowały modyfikacje transakcji. Poddrzewa usunięte
+ * w trakcie transakcji zwalniają kolejne modyfikacje lub funkcja
+ * @ref phfwdReclaim. Funkcja jest modyfikacją struktury w rozumieniu
+ * @ref phfwdEnableConcurrentReads.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli zmiany transakcji zostały zachowane.
+ *         Wartość @p false, jeśli transakcja została wycofana, nie trwa
+ *         żadna transakcja lub wskaźnik @p pf ma wartość NULL.
+ */
+bool phfwdCommit(PhoneForward *pf);
+
+/** @brief Wycofuje transakcję.
+ * Kończy transakcję rozpoczętą funkcją @ref phfwdBegin, przywracając
+ * przekierowania sprzed jej rozpoczęcia. Zmiany wycofywane są w odwrotnej
+ * kolejności według dziennika, bez alokowania pamięci i w czasie
+ * proporcjonalnym do ich liczby. Nic nie robi, jeśli nie trwa żadna
+ * transakcja lub wskaźnik @p pf ma wartość NULL. Funkcja jest modyfikacją
+ * struktury w rozumieniu @ref phfwdEnableConcurrentReads.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ */
+void phfwdRollback(PhoneForward *pf);
+
+/** @brief Odczytuje liczniki operacji.
+ * Zapisuje w @p out bieżące wartości liczników operacji wykonanych na
+ * strukturze @p pf od jej utworzenia lub ostatniego wywołania funkcji
+ * @ref phfwdStatsReset. Liczniki odczytywane są pojedynczo, więc gdy
+ * równolegle trwają inne operacje, mogą nie być ze sobą zgodne.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                   numerów;
+ * @param[out] out – wskaźnik na strukturę, w której zapisywane są liczniki.
+ * @return Wartość @p true, jeśli liczniki zostały odczytane.
+ *         Wartość @p false, jeśli biblioteka została skompilowana bez makra
+ *         @p PHFWD_STATS lub któryś ze wskaźników ma wartość NULL.
+ */
+bool phfwdStats(PhoneForward const *pf, PhfwdStats *out);
+
+/** @brief Zeruje liczniki operacji.
+ * Zeruje liczniki operacji struktury @p pf. Nic nie robi, jeśli wskaźnik
+ * @p pf ma wartość NULL lub biblioteka została skompilowana bez makra
+ * @p PHFWD_STATS.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów.
+ */
+void phfwdStatsReset(PhoneForward *pf);
+
+/** @brief Odczytuje rozmiar i kształt struktury.
+ * Zapisuje w @p report liczby i rozmiary obiektów przechowywanych przez
+ * strukturę @p pf oraz histogramy kształtu jej drzew. Wartości te
+ * aktualizowane są przy każdej modyfikacji struktury, więc funkcja działa
+ * w czasie stałym. Przekierowania usunięte funkcją @ref phfwdRemove są
+ * wliczane do raportu, dopóki ich pamięć nie zostanie zwolniona (zob.
+ * @ref phfwdReclaim). Nie może być wywoływana współbieżnie z modyfikacjami
+ * struktury.
+ * @param[in] pf      – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[out] report – wskaźnik na wypełniany raport.
+ * @return Wartość @p true, jeśli raport został wypełniony.
+ *         Wartość @p false, jeśli któryś ze wskaźników ma wartość NULL.
+ */
+bool phfwdMemoryUsage(PhoneForward const *pf, PhfwdMemoryReport *report);
+
+/** @brief Umożliwia współbieżne zapytania.
+ * Po wywołaniu tej funkcji zapytania @ref phfwdGet, @ref phfwdGetInto,
+ * @ref phfwdGetBatch, @ref phfwdReverse i @ref phfwdGetReverse mogą być
+ * wykonywane przez dowolną liczbę wątków jednocześnie z modyfikacjami
+ * (@ref phfwdAdd, @ref phfwdRemove, @ref phfwdReclaim, @ref phfwdFreeze)
+ * wykonywanymi przez jeden wątek. Zapytania nie zakładają blokad:
+ * zapytanie, w trakcie którego struktura była modyfikowana, jest
+ * powtarzane, a pamięć usuniętych węzłów jest zwalniana dopiero wtedy, gdy
+ * nie może jej już odczytywać żadne zapytanie. Zapytanie nie czeka na
+ * koniec długiej modyfikacji (@ref phfwdAddBulk, @ref phfwdReclaim,
+ * @ref phfwdCommit, @ref phfwdRollback): modyfikacja co pewien czas
+ * przepuszcza czekające zapytania, które widzą wtedy jej dotychczasowe
+ * zmiany. Zapytanie powtarzane kilka razy z rzędu wstrzymuje kolejne
+ * modyfikacje do swojego końca, więc nie może być bez końca unieważniane
+ * przez krótkie modyfikacje. Funkcję należy wywołać,
+ * zanim struktura zostanie udostępniona innym wątkom. Modyfikacje nadal nie
+ * mogą być wykonywane przez kilka wątków jednocześnie, a w trakcie
+ * wywołania @ref phfwdDelete nie może trwać żadne zapytanie. Ponowne
+ * wywołanie funkcji nic nie robi.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów.
+ * @return Wartość @p true, jeśli współbieżne zapytania są możliwe.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci, włączona
+ *         jest pamięć podręczna zapytań (@ref phfwdEnableCache), trwa
+ *         transakcja (@ref phfwdBegin) lub wskaźnik @p pf ma wartość NULL.
  */
-void phfwdRemove(PhoneForward *pf, char const *num);
+bool phfwdEnableConcurrentReads(PhoneForward *pf);
+
+/** @brief Włącza pamięć podręczną wyników zapytań.
+ * Po wywołaniu tej funkcji wyniki zapytań @ref phfwdGet i @ref phfwdReverse
+ * są zapamiętywane, a ponowne zapytanie o ten sam numer zwraca kopię
+ * zapamiętanego wyniku bez przeszukiwania drzew. Funkcja @ref phfwdGetInto
+ * korzysta z zapamiętanych wyników, ale ich nie dodaje, bo nie alokuje
+ * pamięci. Pamięć mieści co najmniej @p capacity wyników; gdy brakuje
+ * miejsca, usuwane są wyniki, które najdawniej były odczytywane (algorytm
+ * CLOCK). Modyfikacje unieważniają tylko wyniki, które mogły się zmienić:
+ * @ref phfwdAdd – zapytań @ref phfwdGet o numery o prefiksie @p num1
+ * i zapytań @ref phfwdReverse o numery o prefiksie @p num2 lub prefiksie,
+ * na który @p num1 był dotąd przekierowany, a @ref phfwdRemove – zapytań
+ * @ref phfwdGet o numery o prefiksie @p num i zapytań @ref phfwdReverse
+ * o numery o prefiksie, na który przekierowany był usunięty numer (jeśli
+ * usunięte zostało jedno przekierowanie, a w przeciwnym razie wszystkich
+ * zapytań @ref phfwdReverse). Funkcja @ref phfwdAddBulk unieważnia
+ * wszystkie wyniki. Ponieważ zapytania
+ * modyfikują pamięć podręczną, nie można jej włączyć razem ze współbieżnymi
+ * zapytaniami (@ref phfwdEnableConcurrentReads). Ponowne wywołanie usuwa
+ * zapamiętane wyniki i zmienia rozmiar pamięci, a wywołanie z parametrem
+ * @p capacity równym 0 wyłącza pamięć podręczną.
+ * @param[in, out] pf  – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] capacity – liczba wyników, które mają się zmieścić w pamięci.
+ * @return Wartość @p true, jeśli pamięć podręczna została włączona lub
+ *         wyłączona.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci (struktura
+ *         działa wtedy tak jak przed wywołaniem funkcji), włączone są
+ *         współbieżne zapytania lub wskaźnik @p pf ma wartość NULL.
+ */
+bool phfwdEnableCache(PhoneForward *pf, size_t capacity);
+
+/** @brief Odczytuje liczniki pamięci podręcznej wyników zapytań.
+ * Zapisuje w @p out liczby trafień, chybień, zapamiętanych, usuniętych
+ * i unieważnionych wyników od włączenia pamięci podręcznej funkcją
+ * @ref phfwdEnableCache oraz jej bieżący rozmiar. Liczniki pozwalają dobrać
+ * rozmiar pamięci podręcznej.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                   numerów;
+ * @param[out] out – wskaźnik na strukturę, w której zapisywane są liczniki.
+ * @return Wartość @p true, jeśli liczniki zostały odczytane.
+ *         Wartość @p false, jeśli pamięć podręczna nie jest włączona lub
+ *         któryś ze wskaźników ma wartość NULL.
+ */
+bool phfwdCacheStats(PhoneForward const *pf, PhfwdCacheStats *out);
+
+/** @brief Zamraża strukturę przechowującą przekierowania.
+ * Tworzy zwarty, niemodyfikowalny obraz przekierowań przechowywanych
+ * w strukturze @p pf, na którym odtąd wykonywane są zapytania
+ * @ref phfwdGet, @ref phfwdGetInto, @ref phfwdGetBatch, @ref phfwdReverse
+ * i @ref phfwdGetReverse (ich wyniki się nie zmieniają). Obraz zajmuje jeden
+ * ciągły blok pamięci i nie zawiera wskaźników. Pierwsza modyfikacja
+ * struktury (@ref phfwdAdd lub @ref phfwdRemove) usuwa obraz, więc po serii
+ * modyfikacji należy ponownie wywołać tę funkcję. Jeśli obraz jest aktualny,
+ * funkcja nic nie robi.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów.
+ * @return Wartość @p true, jeśli struktura została zamrożona.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci, trwa
+ *         transakcja (zob. @ref phfwdBegin) lub wskaźnik @p pf ma wartość
+ *         NULL (struktura działa wtedy tak jak przed wywołaniem funkcji).
+ */
+bool phfwdFreeze(PhoneForward *pf);
+
+/** @brief Zapisuje przekierowania do pliku.
+ * Zamraża strukturę @p pf (tak jak @ref phfwdFreeze) i zapisuje jej obraz
+ * do pliku @p path, który można następnie wczytać funkcją
+ * @ref phfwdOpenMapped. Plik zawiera wersję formatu i sumę kontrolną, a jego
+ * zawartość nie zależy od adresów w pamięci. Plik jest zapisywany pod
+ * tymczasową nazwą i podmieniany, więc procesy korzystające z poprzedniej
+ * wersji pliku nie widzą niespójnych danych, a następnie utrwalany jest
+ * również katalog, więc zapisany plik przetrwa awarię systemu. Funkcja
+ * jest modyfikacją w rozumieniu @ref phfwdEnableConcurrentReads.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] path    – wskaźnik na napis reprezentujący ścieżkę pliku.
+ * @return Wartość @p true, jeśli przekierowania zostały zapisane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci lub zapisać
+ *         pliku, trwa transakcja albo któryś ze wskaźników ma wartość
+ *         NULL.
+ */
+bool phfwdSave(PhoneForward *pf, char const *path);
+
+/** @brief Wczytuje przekierowania z pliku.
+ * Tworzy strukturę zawierającą przekierowania zapisane funkcją
+ * @ref phfwdSave. Plik jest odwzorowywany w pamięci tylko do odczytu,
+ * a zapytania są wykonywane bezpośrednio na odwzorowaniu, bez alokowania
+ * pamięci dla poszczególnych węzłów, więc wiele procesów może współdzielić
+ * jedną kopię pliku w pamięci podręcznej systemu. Pierwsza modyfikacja
+ * struktury przepisuje przekierowania z pliku do drzew (tak jak
+ * @ref phfwdAddBulk) i zwalnia odwzorowanie. Plik zapisany na komputerze
+ * o innym porządku bajtów jest odrzucany.
+ * @param[in] path – wskaźnik na napis reprezentujący ścieżkę pliku.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         odczytać pliku, plik jest uszkodzony, nie udało się alokować
+ *         pamięci lub wskaźnik @p path ma wartość NULL.
+ */
+PhoneForward *phfwdOpenMapped(char const *path);
 
 /** @brief Wyznacza przekierowanie numeru.
  * Wyznacza przekierowanie podanego numeru. Szuka najdłuższego pasującego
@@ -91,6 +505,46 @@ void phfwdRemove(PhoneForward *pf, char const *num);
  */
 PhoneNumbers * phfwdGet(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przekierowanie numeru bez alokowania pamięci.
+ * Wyznacza przekierowanie numeru @p num tak jak funkcja @ref phfwdGet, ale
+ * zapisuje je (wraz z kończącym je znakiem '\0') w buforze @p buf
+ * o rozmiarze @p bufLen dostarczonym przez wywołującego. Jeśli przekierowany
+ * numer nie mieści się w buforze, bufor nie jest zmieniany (jeśli włączono
+ * współbieżne zapytania, jego zawartość jest wtedy nieokreślona), a wywołanie
+ * należy powtórzyć z buforem o rozmiarze co najmniej o jeden większym od
+ * zwróconej wartości. Funkcja nie alokuje pamięci.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na napis reprezentujący numer;
+ * @param[out] buf   – wskaźnik na bufor (może wynosić NULL, jeśli @p bufLen
+ *                     wynosi 0);
+ * @param[in] bufLen – rozmiar bufora w bajtach.
+ * @return Długość przekierowanego numeru (bez znaku '\0'). Wartość 0, jeśli
+ *         podany napis nie reprezentuje numeru (wynikiem @ref phfwdGet jest
+ *         wtedy pusty ciąg) lub wskaźnik @p pf wynosi NULL.
+ */
+size_t phfwdGetInto(PhoneForward const *pf, char const *num, char *buf,
+                    size_t bufLen);
+
+/** @brief Wyznacza przekierowania wielu numerów.
+ * Wyznacza przekierowania numerów @p nums[0], ..., @p nums[count - 1]
+ * i zapisuje je kolejno w tablicy @p out. Wynik @p out[k] jest taki sam jak
+ * wynik wywołania @ref phfwdGet z parametrem @p nums[k] (w szczególności
+ * wynosi NULL, gdy nie udało się alokować pamięci lub wskaźnik @p pf wynosi
+ * NULL) i musi zostać zwolniony za pomocą funkcji @ref phnumDelete.
+ * Wyszukiwania dla kolejnych numerów są przeplatane, dzięki czemu dla dużych
+ * ciągów numerów funkcja działa szybciej niż wielokrotne wywołanie
+ * @ref phfwdGet.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania
+ *                    numerów;
+ * @param[in] nums  – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count – liczba numerów;
+ * @param[out] out  – tablica o rozmiarze @p count na wskaźniki na struktury
+ *                    przechowujące ciągi numerów.
+ */
+void phfwdGetBatch(PhoneForward const *pf, char const *const *nums,
+                   size_t count, PhoneNumbers **out);
+
 /** @brief Wyznacza przekierowania na dany numer.
  * Wyznacza następujący ciąg numerów: numer @p x należy do wyniku wywołania
  * @ref phfwdReverse z numerem @p num wtedy i tylko wtedy, gdy @p x jest równy
@@ -131,6 +585,14 @@ char const * phnumGet(PhoneNumbers const *pnum, size_t idx);
  * posortowane leksykograficznie i nie mogą się powtarzać. Jeśli podany napis
  * nie reprezentuje numeru, wynikiem jest pusty ciąg. Alokuje strukturę @p
  * PhoneNumbers, która musi być zwolniona za pomocą funkcji @ref phnumDelete.
+ * Przekierowania liści drzewa przekierowań nie mogą zostać przesłonięte,
+ * więc numery przekierowane z liści trafiają do wyniku bez schodzenia
+ * w drzewie. Dla każdego z @p k numerów mających dłuższe przekierowania
+ * funkcja schodzi w drzewie wzdłuż pozostałych cyfr @p num, więc poza
+ * sortowaniem wyniku działa w czasie O(@p r + @p n @p k), gdzie @p n jest
+ * długością @p num, a @p r liczbą numerów przekierowanych na jego
+ * prefiksy. Czas ten zależy więc od liczby tych numerów, a nie tylko od
+ * rozmiaru wyniku.
  * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
  * @param[in] num – wskaźnik na napis reprezentujący numer.
  * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
@@ -138,4 +600,89 @@ char const * phnumGet(PhoneNumbers const *pnum, size_t idx);
  */
 PhoneNumbers * phfwdGetReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Otwiera kursor po wyniku funkcji @ref phfwdReverse.
+ * Tworzy kursor, który funkcją @ref phfwdReverseNext zwraca kolejno numery
+ * z wyniku wywołania @ref phfwdReverse z numerem @p num, w tej samej
+ * kolejności. Numery nie są tworzone ani sortowane z góry: kursor
+ * przechowuje jedynie odwołania do numerów w strukturze (kilkanaście bajtów
+ * na numer) i układa je w kopiec w czasie liniowym, a każdy kolejny numer
+ * wyznacza w czasie logarytmicznym. Pierwsze numery dużego wyniku są więc
+ * dostępne szybciej, a przerwanie przeglądania oszczędza pracę
+ * potrzebną na wyznaczenie pozostałych. Dopóki kursor jest otwarty,
+ * struktura @p pf nie może być modyfikowana (również wtedy, gdy włączone są
+ * współbieżne zapytania). Kursor musi zostać zamknięty za pomocą funkcji
+ * @ref phfwdReverseClose.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na kursor lub NULL, gdy nie udało się alokować pamięci
+ *         lub wskaźnik @p pf wynosi NULL. Jeśli podany napis nie reprezentuje
+ *         numeru, kursor nie zwraca żadnego numeru.
+ */
+PhfwdReverseCursor * phfwdReverseOpen(PhoneForward const *pf,
+                                      char const *num);
+
+/** @brief Otwiera kursor po wyniku funkcji @ref phfwdGetReverse.
+ * Działa tak jak funkcja @ref phfwdReverseOpen, ale kursor zwraca kolejno
+ * numery z wyniku wywołania @ref phfwdGetReverse z numerem @p num.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na kursor lub NULL, gdy nie udało się alokować pamięci
+ *         lub wskaźnik @p pf wynosi NULL. Jeśli podany napis nie reprezentuje
+ *         numeru, kursor nie zwraca żadnego numeru.
+ */
+PhfwdReverseCursor * phfwdGetReverseOpen(PhoneForward const *pf,
+                                         char const *num);
+
+/** @brief Udostępnia kolejny numer kursora.
+ * Udostępnia wskaźnik na napis reprezentujący kolejny numer wyniku,
+ * ważny do następnego wywołania tej funkcji lub zamknięcia kursora. Nie
+ * alokuje pamięci.
+ * @param[in, out] cursor – wskaźnik na kursor.
+ * @return Wskaźnik na napis reprezentujący numer telefonu. Wartość NULL,
+ *         jeśli kursor zwrócił już wszystkie numery lub wskaźnik @p cursor
+ *         ma wartość NULL.
+ */
+char const * phfwdReverseNext(PhfwdReverseCursor *cursor);
+
+/** @brief Zamyka kursor.
+ * Usuwa kursor wskazywany przez @p cursor. Nic nie robi, jeśli wskaźnik ten
+ * ma wartość NULL.
+ * @param[in] cursor – wskaźnik na usuwany kursor.
+ */
+void phfwdReverseClose(PhfwdReverseCursor *cursor);
+
+/** @brief Wyznacza liczbę numerów w wyniku funkcji @ref phfwdReverse.
+ * Wyznacza liczbę numerów, które zawierałby wynik wywołania
+ * @ref phfwdReverse z numerem @p num, bez ich tworzenia i sortowania. Każda
+ * tablica numerów przekierowanych na dany numer przechowuje osobno numery,
+ * od których prowadzą dłuższe przekierowania, więc funkcja przegląda tylko
+ * te numery, a pozostałe zlicza w czasie stałym. Dla każdego przeglądanego
+ * numeru schodzi w drzewie przekierowań wzdłuż pozostałych cyfr @p num,
+ * więc działa w czasie O(@p n (1 + @p k)), gdzie @p n jest długością
+ * @p num, a @p k liczbą numerów mających dłuższe przekierowania, które
+ * przekierowano na prefiksy @p num. Liczniki nie są utrzymywane w węzłach,
+ * więc czas ten nie zależy od liczby pozostałych numerów tylko dopóki nie
+ * ma poddrzew usuniętych funkcją @ref phfwdRemove, których węzły nie
+ * zostały jeszcze zwolnione (zob. @ref phfwdReclaim). Wówczas funkcja
+ * przegląda wszystkie numery przekierowane na prefiksy @p num, a numery
+ * zaczynające się tak jak numer usuniętego poddrzewa wymagają dodatkowo
+ * czasu proporcjonalnego do ich długości. Nie alokuje pamięci.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Liczba numerów wyniku. Wartość 0, jeśli podany napis nie
+ *         reprezentuje numeru lub wskaźnik @p pf wynosi NULL.
+ */
+size_t phfwdReverseCount(PhoneForward const *pf, char const *num);
+
+/** @brief Wyznacza liczbę numerów w wyniku funkcji @ref phfwdGetReverse.
+ * Działa tak jak funkcja @ref phfwdReverseCount, ale wyznacza liczbę
+ * numerów, które zawierałby wynik wywołania @ref phfwdGetReverse z numerem
+ * @p num. Złożoność jest taka sama jak funkcji @ref phfwdReverseCount.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Liczba numerów wyniku. Wartość 0, jeśli wynik jest pusty, podany
+ *         napis nie reprezentuje numeru lub wskaźnik @p pf wynosi NULL.
+ */
+size_t phfwdGetReverseCount(PhoneForward const *pf, char const *num);
+
 #endif /* __PHONE_FORWARD_H__ */
@@ -0,0 +1,222 @@
+/** @file
+ * Implementacja klasy przechowującej ciągi numerów telefonów zwracane przez
+ * funkcje struktury @ref PhoneForward.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "phone_numbers.h"
+#include "number_functions.h"
+#include "number_sort.h"
+
+/**
+ * Struktura przechowująca ciąg numerów telefonów. Wszystkie numery zapisane
+ * są jeden po drugim (wraz z kończącymi je znakami '\0') w jednej dynamicznie
+ * powiększanej tablicy znaków, a osobna tablica przechowuje położenia
+ * początków kolejnych numerów. Dzięki temu budowa ciągu wymaga stałej
+ * zamortyzowanej liczby alokacji, a jego usunięcie – trzech zwolnień pamięci.
+ */
+struct PhoneNumbers {
+    char *chars; ///< tablica znaków kolejnych numerów
+    size_t charCount; ///< liczba zajętych znaków tablicy @p chars
+    size_t charCapacity; ///< rozmiar tablicy @p chars
+    size_t *offsets; /**< tablica indeksów początków kolejnych numerów
+                     w tablicy @p chars */
+    size_t numberCount; ///< liczba numerów w ciągu
+    size_t offsetCapacity; ///< rozmiar tablicy @p offsets
+};
+
+/**
+ * Wyznacza nowy rozmiar powiększanej tablicy.
+ * @param[in] capacity    – aktualny rozmiar tablicy;
+ * @param[in] required    – minimalny wymagany rozmiar tablicy;
+ * @param[in] maxCapacity – maksymalny dopuszczalny rozmiar tablicy.
+ * @return Nowy rozmiar tablicy lub 0, jeśli wymagany rozmiar przekracza
+ *         rozmiar maksymalny.
+ */
+static size_t grownCapacity(size_t capacity, size_t required,
+                            size_t maxCapacity) {
+    if (required > maxCapacity)
+        return 0;
+
+    // ustawiamy nowy rozmiar jako w przybliżeniu 3/2 poprzedniego
+    // lub maksymalny dopuszczalny, jeśli ten drugi jest mniejszy
+    size_t newCapacity;
+
+    if (capacity > maxCapacity / 3 * 2)
+        newCapacity = maxCapacity;
+    else
+        newCapacity = capacity * 3 / 2 + 1;
+
+    return newCapacity < required ? required : newCapacity;
+}
+
+PhoneNumbers *phnumNew(void) {
+    PhoneNumbers *newStruct = malloc(sizeof(struct PhoneNumbers));
+
+    if (newStruct != NULL) {
+        newStruct->chars = NULL;
+        newStruct->charCount = 0;
+        newStruct->charCapacity = 0;
+        newStruct->offsets = NULL;
+        newStruct->numberCount = 0;
+        newStruct->offsetCapacity = 0;
+    }
+
+    return newStruct;
+}
+
+void phnumDelete(PhoneNumbers *pnum) {
+    if (pnum == NULL)
+        return;
+
+    free(pnum->chars);
+    free(pnum->offsets);
+    free(pnum);
+}
+
+bool phnumAdd(PhoneNumbers *pnum, char const *num, char const *newPrefix,
+              size_t index) {
+    if (pnum == NULL)
+        return false;
+
+    if (pnum->numberCount == pnum->offsetCapacity) {
+        size_t newCapacity = grownCapacity(pnum->offsetCapacity,
+                                           pnum->numberCount + 1,
+                                           SIZE_MAX / sizeof(size_t));
+        if (newCapacity == 0)
+            return false;
+
+        size_t *tmp = realloc(pnum->offsets, newCapacity * sizeof(size_t));
+        if (tmp == NULL)
+            return false;
+        pnum->offsets = tmp;
+        pnum->offsetCapacity = newCapacity;
+    }
+
+    // próbujemy zapisać numer w wolnym miejscu tablicy, a jeśli się nie
+    // zmieści, powiększamy ją i zapisujemy go ponownie
+    size_t freeChars = pnum->charCapacity - pnum->charCount;
+    char *end = freeChars > 0 ? pnum->chars + pnum->charCount : NULL;
+    size_t length = changePrefixInto(num, newPrefix, index, end, freeChars);
+
+    if (length >= freeChars) {
+        if (length >= SIZE_MAX - pnum->charCount)
+            return false;
+
+        size_t newCapacity = grownCapacity(pnum->charCapacity,
+                                           pnum->charCount + length + 1,
+                                           SIZE_MAX);
+        char *tmp = realloc(pnum->chars, newCapacity);
+        if (tmp == NULL)
+            return false;
+        pnum->chars = tmp;
+        pnum->charCapacity = newCapacity;
+
+        changePrefixInto(num, newPrefix, index, pnum->chars + pnum->charCount,
+                         pnum->charCapacity - pnum->charCount);
+    }
+
+    pnum->offsets[pnum->numberCount] = pnum->charCount;
+    ++pnum->numberCount;
+    pnum->charCount += length + 1;
+    return true;
+}
+
+bool phnumSafeAdd(PhoneNumbers *pnum, char const *num, char const *newPrefix,
+                  size_t index) {
+    if (!phnumAdd(pnum, num, newPrefix, index)) {
+        phnumDelete(pnum);
+        return false;
+    }
+
+    return true;
+}
+
+bool phnumSort(PhoneNumbers *pnum) {
+    size_t count = pnum->numberCount;
+    if (count < 2)
+        return true;
+
+    if (count > SIZE_MAX / sizeof(SortItem))
+        return false;
+
+    // sortujemy numery wraz z indeksami ich początków, które następnie
+    // przepisujemy z powrotem w nowej kolejności
+    SortItem *items = malloc(count * sizeof(SortItem));
+    if (items == NULL)
+        return false;
+
+    for (size_t i = 0; i < count; ++i) {
+        items[i].key = pnum->chars + pnum->offsets[i];
+        items[i].value = pnum->offsets[i];
+    }
+
+    bool result = numberSort(items, count);
+    if (result)
+        for (size_t i = 0; i < count; ++i)
+            pnum->offsets[i] = items[i].value;
+
+    free(items);
+    return result;
+}
+
+void phnumRemoveDuplicates(PhoneNumbers *pnum) {
+    if (pnum->numberCount == 0)
+        return;
+
+    // znaki usuniętych numerów pozostają w tablicy aż do usunięcia struktury
+    size_t count = 1;
+    for (size_t i = 1; i < pnum->numberCount; ++i) {
+        char const *previous = pnum->chars + pnum->offsets[count - 1];
+
+        if (strcmp(pnum->chars + pnum->offsets[i], previous) != 0) {
+            pnum->offsets[count] = pnum->offsets[i];
+            ++count;
+        }
+    }
+
+    pnum->numberCount = count;
+}
+
+PhoneNumbers *phnumCopy(PhoneNumbers const *pnum) {
+    PhoneNumbers *newStruct = phnumNew();
+    if (newStruct == NULL)
+        return NULL;
+
+    // rozmiary tablic nie przekraczają rozmiarów tablic oryginału, więc
+    // mnożenie nie wykracza poza zakres typu size_t
+    if (pnum->numberCount > 0) {
+        newStruct->chars = malloc(pnum->charCount);
+        newStruct->offsets = malloc(pnum->numberCount * sizeof(size_t));
+        if (newStruct->chars == NULL || newStruct->offsets == NULL) {
+            phnumDelete(newStruct);
+            return NULL;
+        }
+
+        memcpy(newStruct->chars, pnum->chars, pnum->charCount);
+        memcpy(newStruct->offsets, pnum->offsets,
+               pnum->numberCount * sizeof(size_t));
+    }
+
+    newStruct->charCount = newStruct->charCapacity = pnum->charCount;
+    newStruct->numberCount = newStruct->offsetCapacity = pnum->numberCount;
+    return newStruct;
+}
+
+size_t phnumBytes(PhoneNumbers const *pnum) {
+    return sizeof(struct PhoneNumbers) + pnum->charCapacity +
+           pnum->offsetCapacity * sizeof(size_t);
+}
+
+char const *phnumGet(PhoneNumbers const *pnum, size_t idx) {
+    if (pnum == NULL || idx >= pnum->numberCount)
+        return NULL;
+    return pnum->chars + pnum->offsets[idx];
+}
@@ -0,0 +1,89 @@
+/** @file
+ * Interfejs klasy przechowującej ciągi numerów telefonów zwracane przez
+ * funkcje struktury @ref PhoneForward.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_NUMBERS_H
+#define PHONE_NUMBERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "phone_forward.h"
+
+/**
+ * Tworzy nową strukturę reprezentującą pusty ciąg.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+PhoneNumbers *phnumNew(void);
+
+/** @brief Dodaje numer z podmienionym prefiksem.
+ * Dodaje na koniec ciągu @p pnum numer powstały z numeru @p num przez
+ * zastąpienie jego pierwszych @p index cyfr numerem @p newPrefix. Numer jest
+ * zapisywany bezpośrednio w pamięci struktury, bez tworzenia kopii
+ * pośrednich.
+ * @param[in, out] pnum – wskaźnik na strukturę przechowującą ciąg numerów;
+ * @param[in] num       – wskaźnik na napis reprezentujący numer;
+ * @param[in] newPrefix – wskaźnik na napis reprezentujący nowy prefiks;
+ * @param[in] index     – długość zastępowanego prefiksu.
+ * @return Wartość @p true, jeśli numer został dodany.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci
+ *         lub wskaźnik @p pnum ma wartość NULL.
+ */
+bool phnumAdd(PhoneNumbers *pnum, char const *num, char const *newPrefix,
+              size_t index);
+
+/** @brief Dodaje numer do ciągu obsługując błędy.
+ * Dodaje do ciągu @p pnum numer powstały z numeru @p num przez zastąpienie
+ * jego pierwszych @p index cyfr numerem @p newPrefix, a w przypadku
+ * niepowodzenia usuwa strukturę @p pnum.
+ * @param[in, out] pnum – wskaźnik na strukturę przechowującą ciąg numerów;
+ * @param[in] num       – wskaźnik na napis reprezentujący numer;
+ * @param[in] newPrefix – wskaźnik na napis reprezentujący nowy prefiks;
+ * @param[in] index     – długość zastępowanego prefiksu.
+ * @return Wartość @p true, jeśli numer został dodany.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci
+ *         lub wskaźnik @p pnum ma wartość NULL i usunięta została
+ *         struktura.
+ */
+bool phnumSafeAdd(PhoneNumbers *pnum, char const *num, char const *newPrefix,
+                  size_t index);
+
+/**
+ * Sortuje ciąg @p pnum leksykograficznie.
+ * @param[in, out] pnum – wskaźnik na strukturę przechowującą ciąg numerów.
+ * @return Wartość @p true, jeśli sortowanie się powiodło.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+bool phnumSort(PhoneNumbers *pnum);
+
+/**
+ * Usuwa powtarzające się numery z posortowanego ciągu @p pnum. Nie alokuje
+ * pamięci.
+ * @param[in, out] pnum – wskaźnik na strukturę przechowującą ciąg numerów.
+ */
+void phnumRemoveDuplicates(PhoneNumbers *pnum);
+
+/**
+ * Tworzy kopię ciągu @p pnum, której tablice mają rozmiary równe liczbie
+ * zajętych elementów.
+ * @param[in] pnum – wskaźnik na strukturę przechowującą ciąg numerów.
+ * @return Wskaźnik na kopię ciągu lub NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+PhoneNumbers *phnumCopy(PhoneNumbers const *pnum);
+
+/**
+ * Wyznacza rozmiar pamięci zajmowanej przez ciąg @p pnum wraz
+ * z niezajętymi częściami jego tablic.
+ * @param[in] pnum – wskaźnik na strukturę przechowującą ciąg numerów.
+ * @return Rozmiar pamięci w bajtach.
+ */
+size_t phnumBytes(PhoneNumbers const *pnum);
+
+#endif /* PHONE_NUMBERS_H */
@@ -0,0 +1,130 @@
+/** @file
+ * Implementacja klasy implementującej pulę pamięci dla obiektów o stałym
+ * rozmiarze.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "pool.h"
+
+/**
+ * Wyznacza liczbę obiektów mieszczących się w płycie o danym numerze.
+ * @param[in] slab – numer płyty.
+ * @return Liczba obiektów mieszczących się w płycie.
+ */
+static size_t slabSize(size_t slab) {
+    return (size_t) POOL_FIRST_SLAB_SIZE << slab;
+}
+
+Pool *poolNew(size_t objectSize) {
+    Pool *newStruct = malloc(sizeof(struct Pool));
+
+    if (newStruct != NULL) {
+        // obiekt musi pomieścić dowiązanie listy wolnych obiektów
+        if (objectSize < sizeof(PoolIndex))
+            objectSize = sizeof(PoolIndex);
+
+        newStruct->objectSize = objectSize;
+        newStruct->freeList = POOL_NULL;
+        newStruct->allocated = 0;
+        newStruct->slabCount = 0;
+    }
+
+    return newStruct;
+}
+
+void poolDelete(Pool *pool) {
+    if (pool == NULL)
+        return;
+
+    for (size_t i = 0; i < pool->slabCount; ++i)
+        free(pool->slabs[i]);
+    free(pool);
+}
+
+/**
+ * Wyznacza rozmiar płyty w bajtach. Funkcja aligned_alloc wymaga, aby był on
+ * wielokrotnością wyrównania.
+ * @param[in] pool – wskaźnik na pulę;
+ * @param[in] slab – numer płyty.
+ * @return Rozmiar płyty w bajtach.
+ */
+static size_t slabBytes(Pool const *pool, size_t slab) {
+    size_t bytes = slabSize(slab) * pool->objectSize;
+
+    return (bytes + POOL_SLAB_ALIGNMENT - 1) / POOL_SLAB_ALIGNMENT *
+           POOL_SLAB_ALIGNMENT;
+}
+
+/**
+ * Alokuje kolejną płytę puli.
+ * @param[in, out] pool – wskaźnik na pulę.
+ * @return Wartość @p true, jeśli płyta została zaalokowana.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool addSlab(Pool *pool) {
+    if (pool->slabCount == POOL_MAX_SLABS)
+        return false;
+
+    size_t count = slabSize(pool->slabCount);
+
+    // sprawdzamy, czy rozmiar płyty nie wykracza poza zakres typu size_t
+    if (count > (SIZE_MAX - POOL_SLAB_ALIGNMENT) / pool->objectSize)
+        return false;
+
+    char *slab = aligned_alloc(POOL_SLAB_ALIGNMENT,
+                               slabBytes(pool, pool->slabCount));
+    if (slab == NULL)
+        return false;
+
+    pool->slabs[pool->slabCount] = slab;
+    ++pool->slabCount;
+    return true;
+}
+
+PoolIndex poolAlloc(Pool *pool) {
+    if (pool->freeList != POOL_NULL) {
+        PoolIndex result = pool->freeList;
+        pool->freeList = *(PoolIndex *) poolGet(pool, result);
+        return result;
+    }
+
+    // wartość POOL_NULL jest zarezerwowana, więc największy możliwy indeks
+    // to UINT32_MAX
+    if (pool->allocated == UINT32_MAX)
+        return POOL_NULL;
+
+    // płyty o numerach mniejszych niż k mieszczą łącznie
+    // POOL_FIRST_SLAB_SIZE * (2^k - 1) obiektów
+    size_t capacity = slabSize(pool->slabCount) - POOL_FIRST_SLAB_SIZE;
+    if (pool->allocated == capacity && !addSlab(pool))
+        return POOL_NULL;
+
+    ++pool->allocated;
+    return pool->allocated;
+}
+
+void poolFree(Pool *pool, PoolIndex index) {
+    if (index == POOL_NULL)
+        return;
+
+    *(PoolIndex *) poolGet(pool, index) = pool->freeList;
+    pool->freeList = index;
+}
+
+size_t poolReservedBytes(Pool const *pool) {
+    if (pool == NULL)
+        return 0;
+
+    size_t result = sizeof(struct Pool);
+    for (size_t i = 0; i < pool->slabCount; ++i)
+        result += slabBytes(pool, i);
+
+    return result;
+}
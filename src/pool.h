@@ -0,0 +1,183 @@
+/** @file
+ * Interfejs klasy implementującej pulę pamięci dla obiektów o stałym
+ * rozmiarze.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Liczba obiektów mieszczących się w pierwszej płycie puli. Każda kolejna
+ * płyta jest dwa razy większa od poprzedniej. Musi być potęgą dwójki.
+ */
+#define POOL_FIRST_SLAB_SIZE 64
+
+/**
+ * Wykładnik potęgi dwójki równej @ref POOL_FIRST_SLAB_SIZE.
+ */
+#define POOL_FIRST_SLAB_SHIFT 6
+
+/**
+ * Maksymalna liczba płyt puli. Tyle płyt wystarcza do pomieszczenia
+ * obiektów o wszystkich indeksach mieszczących się w typie @ref PoolIndex.
+ */
+#define POOL_MAX_SLABS 27
+
+/**
+ * Wyrównanie (w bajtach) początku każdej płyty. Obiekty o rozmiarze
+ * będącym wielokrotnością tej wartości zajmują pełne linie pamięci
+ * podręcznej procesora.
+ */
+#define POOL_SLAB_ALIGNMENT 64
+
+/**
+ * Typ @p PoolIndex reprezentuje indeks obiektu w puli. Indeksy są
+ * o połowę mniejsze od wskaźników, dzięki czemu struktury przechowujące
+ * odwołania do innych obiektów puli zajmują mniej pamięci.
+ */
+typedef uint32_t PoolIndex;
+
+/**
+ * Indeks oznaczający brak obiektu (odpowiednik wskaźnika NULL).
+ */
+#define POOL_NULL ((PoolIndex) 0)
+
+/**
+ * Struktura reprezentująca pulę pamięci. Obiekty przydzielane są z dużych
+ * bloków (płyt) zamiast pojedynczo z użyciem funkcji malloc, a zwolnione
+ * obiekty trafiają na listę wolnych obiektów i są ponownie wykorzystywane.
+ * Płyty nie są nigdy przenoszone ani zwalniane przed usunięciem całej puli,
+ * więc obiekt o danym indeksie ma zawsze ten sam adres. Struktura jest
+ * zdefiniowana w pliku nagłówkowym, aby funkcja @ref poolGet mogła być
+ * rozwijana w miejscu wywołania.
+ */
+typedef struct Pool {
+    size_t objectSize; ///< rozmiar pojedynczego obiektu w bajtach
+    PoolIndex freeList; /**< indeks pierwszego obiektu listy wolnych obiektów
+                        lub @ref POOL_NULL, jeśli lista jest pusta */
+    PoolIndex allocated; /**< liczba obiektów, które zostały już choć raz
+                         przydzielone */
+    size_t slabCount; ///< liczba zaalokowanych płyt
+    char *slabs[POOL_MAX_SLABS]; ///< tablica wskaźników na kolejne płyty
+} Pool;
+
+/**
+ * Tworzy nową, pustą pulę pamięci dla obiektów o rozmiarze @p objectSize.
+ * @param[in] objectSize – rozmiar pojedynczego obiektu w bajtach.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, jeśli nie udało się
+ *         alokować pamięci.
+ */
+Pool *poolNew(size_t objectSize);
+
+/** @brief Usuwa pulę pamięci.
+ * Zwalnia wszystkie płyty puli @p pool, a więc również wszystkie obiekty
+ * z niej przydzielone, w czasie proporcjonalnym do liczby płyt. Nic nie
+ * robi, jeśli wskaźnik @p pool ma wartość NULL.
+ * @param[in] pool – wskaźnik na usuwaną pulę.
+ */
+void poolDelete(Pool *pool);
+
+/**
+ * Przydziela obiekt z puli @p pool. Zawartość obiektu jest nieokreślona.
+ * @param[in, out] pool – wskaźnik na pulę.
+ * @return Indeks przydzielonego obiektu lub @ref POOL_NULL, jeśli nie udało
+ *         się alokować pamięci.
+ */
+PoolIndex poolAlloc(Pool *pool);
+
+/**
+ * Zwraca obiekt o indeksie @p index do puli @p pool. Nic nie robi, jeśli
+ * @p index ma wartość @ref POOL_NULL.
+ * @param[in, out] pool – wskaźnik na pulę;
+ * @param[in] index     – indeks obiektu przydzielonego z puli @p pool.
+ */
+void poolFree(Pool *pool, PoolIndex index);
+
+/**
+ * Wyznacza rozmiar pamięci zajmowanej przez pulę @p pool, czyli przez jej
+ * strukturę i wszystkie płyty (również ich części jeszcze nieprzydzielone),
+ * w czasie proporcjonalnym do liczby płyt.
+ * @param[in] pool – wskaźnik na pulę lub NULL.
+ * @return Rozmiar pamięci w bajtach (0, jeśli @p pool ma wartość NULL).
+ */
+size_t poolReservedBytes(Pool const *pool);
+
+/** @brief Wyznacza adres obiektu.
+ * Wyznacza adres obiektu o indeksie @p index. Obiekty numerowane są od
+ * jedynki, a płyta o numerze @p k zawiera obiekty o indeksach od
+ * @ref POOL_FIRST_SLAB_SIZE * (2^k - 1) + 1 do
+ * @ref POOL_FIRST_SLAB_SIZE * (2^(k + 1) - 1), więc numer płyty jest
+ * logarytmem dwójkowym wartości (index - 1) / @ref POOL_FIRST_SLAB_SIZE + 1.
+ * @param[in] pool  – wskaźnik na pulę;
+ * @param[in] index – indeks obiektu różny od @ref POOL_NULL.
+ * @return Wskaźnik na obiekt.
+ */
+static inline void *poolGet(Pool const *pool, PoolIndex index) {
+    uint32_t slot = index - 1;
+    uint32_t group = (slot >> POOL_FIRST_SLAB_SHIFT) + 1;
+    unsigned int slab = 31 - (unsigned int) __builtin_clz(group);
+    uint32_t offset = slot - (((uint32_t) 1 << slab) - 1) *
+                             POOL_FIRST_SLAB_SIZE;
+
+    return pool->slabs[slab] + (size_t) offset * pool->objectSize;
+}
+
+/**
+ * Płyta, do której należał obiekt ostatnio wyznaczony funkcją
+ * @ref poolGetNear. Obiekty odwiedzane po kolei (np. węzły jednej ścieżki
+ * drzewa) zwykle leżą w tej samej płycie, więc zamiast wyszukiwać płytę dla
+ * każdego z nich wystarczy sprawdzić, czy indeks mieści się w zapamiętanej.
+ */
+typedef struct PoolSlabHint {
+    PoolIndex first; ///< indeks pierwszego obiektu płyty
+    size_t size; ///< liczba obiektów płyty (0, jeśli płyty nie zapamiętano)
+    char *base; ///< adres płyty
+} PoolSlabHint;
+
+/**
+ * Przygotowuje strukturę @p hint do użycia, nie zapamiętując żadnej płyty.
+ * @param[out] hint – wskaźnik na zapamiętaną płytę.
+ */
+static inline void poolHintInit(PoolSlabHint *hint) {
+    hint->first = POOL_NULL;
+    hint->size = 0;
+    hint->base = NULL;
+}
+
+/** @brief Wyznacza adres obiektu, korzystając z zapamiętanej płyty.
+ * Działa tak jak @ref poolGet, ale jeśli obiekt leży w płycie zapamiętanej
+ * w @p hint, to jego adres wyznacza bez wyszukiwania płyty i odczytu
+ * tablicy płyt, które w przeciwnym razie opóźniają każdy krok przejścia po
+ * kolejnych obiektach. W przeciwnym razie zapamiętuje płytę obiektu.
+ * @param[in] pool       – wskaźnik na pulę;
+ * @param[in, out] hint  – wskaźnik na zapamiętaną płytę;
+ * @param[in] index      – indeks obiektu różny od @ref POOL_NULL;
+ * @param[in] objectSize – rozmiar obiektów puli; stała w miejscu wywołania
+ *                         pozwala zastąpić mnożenie przesunięciem.
+ * @return Wskaźnik na obiekt.
+ */
+static inline void *poolGetNear(Pool const *pool, PoolSlabHint *hint,
+                                PoolIndex index, size_t objectSize) {
+    uint32_t offset = index - hint->first;
+
+    if (offset >= hint->size) {
+        uint32_t group = ((index - 1) >> POOL_FIRST_SLAB_SHIFT) + 1;
+        unsigned int slab = 31 - (unsigned int) __builtin_clz(group);
+
+        hint->first = (((uint32_t) 1 << slab) - 1) * POOL_FIRST_SLAB_SIZE + 1;
+        hint->size = (size_t) POOL_FIRST_SLAB_SIZE << slab;
+        hint->base = pool->slabs[slab];
+        offset = index - hint->first;
+    }
+
+    return hint->base + (size_t) offset * objectSize;
+}
+
+#endif /* POOL_H */
@@ -0,0 +1,304 @@
+/** @file
+ * Implementacja klasy implementującej pamięć podręczną wyników zapytań
+ * struktury PhoneForward.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "query_cache.h"
+#include "phone_numbers.h"
+#include "number_functions.h"
+
+/**
+ * Liczba wyników w jednym zbiorze pamięci podręcznej. Wynik zapytania może
+ * znajdować się tylko w zbiorze wyznaczonym przez skrót numeru.
+ */
+#define CACHE_WAYS 4
+
+/**
+ * Liczba liczników unieważnień każdego rodzaju zapytań (potęga dwójki).
+ */
+#define CACHE_GENERATIONS 4096
+
+/**
+ * Największa długość prefiksu, dla którego unieważnienie dotyczy tylko
+ * numerów o tym prefiksie. Zmiana dłuższego prefiksu unieważnia wszystkie
+ * numery o tych samych początkowych @ref CACHE_PREFIX_DEPTH cyfrach.
+ */
+#define CACHE_PREFIX_DEPTH 8
+
+/**
+ * Początkowa wartość skrótu numeru (skrót pustego prefiksu).
+ */
+#define HASH_SEED UINT64_C(0xcbf29ce484222325)
+
+/**
+ * Element pamięci podręcznej: wynik jednego zapytania.
+ */
+typedef struct CacheEntry {
+    uint64_t hash; ///< skrót numeru, o który pytano
+    uint64_t stamp; ///< wartość zegara modyfikacji w chwili zapamiętania
+    char *num; ///< kopia numeru lub NULL, jeśli element jest pusty
+    PhoneNumbers *result; ///< kopia wyniku zapytania
+    CacheQuery query; ///< rodzaj zapytania
+    bool referenced; /**< czy wynik był odczytany od ostatniego przejścia
+                     wskazówki algorytmu CLOCK */
+} CacheEntry;
+
+/**
+ * Struktura przechowuje wyniki w zbiorach po @ref CACHE_WAYS elementów.
+ * Gdy w zbiorze brakuje miejsca, wynik do usunięcia wybiera algorytm CLOCK
+ * (drugiej szansy) z osobną wskazówką dla każdego zbioru.
+ *
+ * Wyniki unieważniane są leniwie. Każda modyfikacja zwiększa zegar
+ * modyfikacji i zapisuje jego wartość w liczniku unieważnień prefiksu,
+ * którego dotyczy (liczniki wybierane są według skrótu prefiksu, więc
+ * kolizja może jedynie unieważnić dodatkowe wyniki). Wynik jest aktualny,
+ * jeśli liczniki wszystkich prefiksów numeru o długości nie większej niż
+ * @ref CACHE_PREFIX_DEPTH są nie większe niż wartość zegara w chwili jego
+ * zapamiętania. Unieważnienie działa więc w czasie stałym, a sprawdzenie
+ * wyniku – w czasie ograniczonym przez @ref CACHE_PREFIX_DEPTH.
+ */
+struct QueryCache {
+    CacheEntry *entries; ///< tablica wyników
+    unsigned char *hands; ///< wskazówki algorytmu CLOCK kolejnych zbiorów
+    size_t setMask; ///< liczba zbiorów pomniejszona o jeden
+    uint64_t clock; ///< zegar modyfikacji
+    /** liczniki unieważnień prefiksów dla każdego rodzaju zapytań */
+    uint64_t generations[CACHE_QUERIES][CACHE_GENERATIONS];
+    PhfwdCacheStats stats; ///< liczniki i rozmiar pamięci podręcznej
+};
+
+/**
+ * Dołącza cyfrę do skrótu numeru (algorytm FNV-1a).
+ * @param[in] hash – skrót prefiksu numeru;
+ * @param[in] c    – znak reprezentujący kolejną cyfrę.
+ * @return Skrót prefiksu przedłużonego o cyfrę @p c.
+ */
+static inline uint64_t hashStep(uint64_t hash, char c) {
+    return (hash ^ (charToDigit(c) + 1)) * UINT64_C(0x100000001b3);
+}
+
+/**
+ * Wyznacza numer licznika unieważnień prefiksu.
+ * @param[in] hash – skrót prefiksu.
+ * @return Indeks licznika w tablicy liczników jednego rodzaju zapytań.
+ */
+static inline size_t generationSlot(uint64_t hash) {
+    return (size_t) (hash ^ (hash >> 32)) & (CACHE_GENERATIONS - 1);
+}
+
+/**
+ * Wyznacza skrót numeru i największy licznik unieważnień jego prefiksów.
+ * @param[in] cache       – wskaźnik na pamięć podręczną;
+ * @param[in] query       – rodzaj zapytania;
+ * @param[in] num         – wskaźnik na napis reprezentujący numer;
+ * @param[out] generation – największy licznik unieważnień prefiksów
+ *                          numeru.
+ * @return Skrót numeru.
+ */
+static uint64_t hashNumber(QueryCache const *cache, CacheQuery query,
+                           char const *num, uint64_t *generation) {
+    uint64_t const *generations = cache->generations[query];
+    uint64_t hash = HASH_SEED;
+    uint64_t newest = generations[generationSlot(hash)];
+    size_t i = 0;
+
+    for (; num[i] != '\0' && i < CACHE_PREFIX_DEPTH; ++i) {
+        hash = hashStep(hash, num[i]);
+
+        uint64_t current = generations[generationSlot(hash)];
+        if (current > newest)
+            newest = current;
+    }
+
+    for (; num[i] != '\0'; ++i)
+        hash = hashStep(hash, num[i]);
+
+    *generation = newest;
+    return hash;
+}
+
+/**
+ * Wyznacza pierwszy element zbioru, w którym może znajdować się wynik.
+ * @param[in] cache – wskaźnik na pamięć podręczną;
+ * @param[in] hash  – skrót numeru.
+ * @return Indeks pierwszego elementu zbioru.
+ */
+static size_t setOf(QueryCache const *cache, uint64_t hash) {
+    return ((size_t) (hash >> 17) & cache->setMask) * CACHE_WAYS;
+}
+
+/**
+ * Usuwa wynik z elementu pamięci podręcznej, który staje się pusty.
+ * @param[in, out] cache – wskaźnik na pamięć podręczną;
+ * @param[in, out] entry – wskaźnik na niepusty element.
+ */
+static void dropEntry(QueryCache *cache, CacheEntry *entry) {
+    cache->stats.bytes -= strlen(entry->num) + 1 + phnumBytes(entry->result);
+    --cache->stats.entries;
+
+    free(entry->num);
+    phnumDelete(entry->result);
+    entry->num = NULL;
+    entry->result = NULL;
+}
+
+QueryCache *queryCacheNew(size_t capacity) {
+    size_t sets = 1;
+    while (sets * CACHE_WAYS < capacity && sets <= SIZE_MAX / 2 / CACHE_WAYS)
+        sets *= 2;
+
+    if (sets > SIZE_MAX / CACHE_WAYS / sizeof(CacheEntry))
+        return NULL;
+
+    QueryCache *newStruct = malloc(sizeof(struct QueryCache));
+    if (newStruct == NULL)
+        return NULL;
+
+    newStruct->entries = calloc(sets * CACHE_WAYS, sizeof(CacheEntry));
+    newStruct->hands = calloc(sets, 1);
+    if (newStruct->entries == NULL || newStruct->hands == NULL) {
+        free(newStruct->entries);
+        free(newStruct->hands);
+        free(newStruct);
+        return NULL;
+    }
+
+    newStruct->setMask = sets - 1;
+    newStruct->clock = 0;
+    memset(newStruct->generations, 0, sizeof(newStruct->generations));
+    memset(&newStruct->stats, 0, sizeof(newStruct->stats));
+    newStruct->stats.capacity = sets * CACHE_WAYS;
+    newStruct->stats.bytes = sizeof(struct QueryCache) +
+                             sets * CACHE_WAYS * sizeof(CacheEntry) + sets;
+
+    return newStruct;
+}
+
+void queryCacheDelete(QueryCache *cache) {
+    if (cache == NULL)
+        return;
+
+    for (size_t k = 0; k < cache->stats.capacity; ++k) {
+        free(cache->entries[k].num);
+        phnumDelete(cache->entries[k].result);
+    }
+
+    free(cache->entries);
+    free(cache->hands);
+    free(cache);
+}
+
+PhoneNumbers const *queryCacheFind(QueryCache *cache, CacheQuery query,
+                                   char const *num) {
+    uint64_t generation;
+    uint64_t hash = hashNumber(cache, query, num, &generation);
+    CacheEntry *set = cache->entries + setOf(cache, hash);
+
+    for (size_t w = 0; w < CACHE_WAYS; ++w) {
+        CacheEntry *entry = &set[w];
+
+        if (entry->num == NULL || entry->hash != hash ||
+            entry->query != query || strcmp(entry->num, num) != 0)
+            continue;
+
+        if (generation > entry->stamp) {
+            dropEntry(cache, entry);
+            ++cache->stats.invalidations;
+            break;
+        }
+
+        entry->referenced = true;
+        ++cache->stats.hits;
+        return entry->result;
+    }
+
+    ++cache->stats.misses;
+    return NULL;
+}
+
+/**
+ * Wybiera element zbioru, w którym zostanie zapamiętany nowy wynik: pusty
+ * element lub element wskazany przez algorytm CLOCK.
+ * @param[in, out] cache – wskaźnik na pamięć podręczną;
+ * @param[in] first      – indeks pierwszego elementu zbioru.
+ * @return Wskaźnik na wybrany element.
+ */
+static CacheEntry *chooseVictim(QueryCache *cache, size_t first) {
+    CacheEntry *set = cache->entries + first;
+    unsigned char *hand = &cache->hands[first / CACHE_WAYS];
+
+    for (size_t w = 0; w < CACHE_WAYS; ++w)
+        if (set[w].num == NULL)
+            return &set[w];
+
+    // wyniki odczytane od ostatniego przejścia wskazówki dostają drugą
+    // szansę, więc po co najwyżej jednym obrocie wskazówka się zatrzyma
+    while (set[*hand].referenced) {
+        set[*hand].referenced = false;
+        *hand = (unsigned char) ((*hand + 1) % CACHE_WAYS);
+    }
+
+    CacheEntry *victim = &set[*hand];
+    *hand = (unsigned char) ((*hand + 1) % CACHE_WAYS);
+    return victim;
+}
+
+void queryCacheInsert(QueryCache *cache, CacheQuery query, char const *num,
+                      PhoneNumbers const *result) {
+    uint64_t generation;
+    uint64_t hash = hashNumber(cache, query, num, &generation);
+    size_t length = strlen(num);
+
+    char *numCopy = malloc(length + 1);
+    PhoneNumbers *resultCopy = phnumCopy(result);
+    if (numCopy == NULL || resultCopy == NULL) {
+        free(numCopy);
+        phnumDelete(resultCopy);
+        return;
+    }
+    memcpy(numCopy, num, length + 1);
+
+    CacheEntry *entry = chooseVictim(cache, setOf(cache, hash));
+    if (entry->num != NULL) {
+        dropEntry(cache, entry);
+        ++cache->stats.evictions;
+    }
+
+    entry->hash = hash;
+    entry->stamp = cache->clock;
+    entry->num = numCopy;
+    entry->result = resultCopy;
+    entry->query = query;
+    entry->referenced = false;
+
+    ++cache->stats.insertions;
+    ++cache->stats.entries;
+    cache->stats.bytes += length + 1 + phnumBytes(resultCopy);
+}
+
+void queryCacheInvalidate(QueryCache *cache, CacheQuery query,
+                          char const *prefix) {
+    uint64_t hash = HASH_SEED;
+
+    for (size_t i = 0; prefix[i] != '\0' && i < CACHE_PREFIX_DEPTH; ++i)
+        hash = hashStep(hash, prefix[i]);
+
+    ++cache->clock;
+    cache->generations[query][generationSlot(hash)] = cache->clock;
+}
+
+void queryCacheStats(QueryCache const *cache, PhfwdCacheStats *out) {
+    *out = cache->stats;
+}
+
+size_t queryCacheBytes(QueryCache const *cache) {
+    return cache == NULL ? 0 : cache->stats.bytes;
+}
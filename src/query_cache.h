@@ -0,0 +1,110 @@
+/** @file
+ * Interfejs klasy implementującej pamięć podręczną wyników zapytań
+ * struktury PhoneForward.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "phone_forward.h"
+
+/**
+ * Rodzaj zapytania, którego wyniki przechowuje pamięć podręczna. Wyniki
+ * różnych rodzajów zapytań unieważniane są przez zmiany różnych prefiksów,
+ * więc każdy rodzaj ma własne liczniki unieważnień.
+ */
+typedef enum CacheQuery {
+    CACHE_GET, ///< @ref phfwdGet
+    CACHE_REVERSE, ///< @ref phfwdReverse
+    CACHE_QUERIES ///< liczba rodzajów zapytań
+} CacheQuery;
+
+/**
+ * Struktura reprezentująca ograniczoną pamięć podręczną wyników zapytań.
+ * Opis jej budowy znajduje się w pliku query_cache.c.
+ */
+struct QueryCache;
+
+/**
+ * Typ @p QueryCache reprezentuje strukturę @p QueryCache.
+ */
+typedef struct QueryCache QueryCache;
+
+/**
+ * Tworzy nową, pustą pamięć podręczną.
+ * @param[in] capacity – dodatnia liczba wyników, które mieszczą się
+ *                       w pamięci (zaokrąglana w górę do potęgi dwójki).
+ * @return Wskaźnik na utworzoną strukturę lub NULL, jeśli nie udało się
+ *         alokować pamięci.
+ */
+QueryCache *queryCacheNew(size_t capacity);
+
+/**
+ * Usuwa pamięć podręczną wraz z przechowywanymi wynikami. Nic nie robi,
+ * jeśli wskaźnik @p cache ma wartość NULL.
+ * @param[in] cache – wskaźnik na usuwaną strukturę.
+ */
+void queryCacheDelete(QueryCache *cache);
+
+/** @brief Wyszukuje wynik zapytania.
+ * Wyszukuje aktualny wynik zapytania rodzaju @p query o numer @p num.
+ * Znaleziony wynik, który został unieważniony, jest usuwany.
+ * @param[in, out] cache – wskaźnik na pamięć podręczną;
+ * @param[in] query      – rodzaj zapytania;
+ * @param[in] num        – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wskaźnik na wynik, ważny do najbliższej modyfikacji pamięci
+ *         podręcznej, lub NULL, jeśli aktualnego wyniku nie ma.
+ */
+PhoneNumbers const *queryCacheFind(QueryCache *cache, CacheQuery query,
+                                   char const *num);
+
+/** @brief Zapamiętuje wynik zapytania.
+ * Zapamiętuje kopię wyniku @p result zapytania rodzaju @p query o numer
+ * @p num, w razie potrzeby usuwając inny wynik. Wyniku tego zapytania nie
+ * może być w pamięci podręcznej (funkcja @ref queryCacheFind zwróciła dla
+ * niego NULL). Jeśli nie uda się alokować pamięci, wynik nie zostaje
+ * zapamiętany.
+ * @param[in, out] cache – wskaźnik na pamięć podręczną;
+ * @param[in] query      – rodzaj zapytania;
+ * @param[in] num        – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] result     – wskaźnik na wynik zapytania.
+ */
+void queryCacheInsert(QueryCache *cache, CacheQuery query, char const *num,
+                      PhoneNumbers const *result);
+
+/** @brief Unieważnia wyniki zapytań o numery o danym prefiksie.
+ * Unieważnia wszystkie wyniki zapytań rodzaju @p query o numery, których
+ * prefiksem jest @p prefix (oraz być może niektóre inne wyniki). Działa
+ * w czasie stałym względem liczby przechowywanych wyników.
+ * @param[in, out] cache – wskaźnik na pamięć podręczną;
+ * @param[in] query      – rodzaj zapytania;
+ * @param[in] prefix     – wskaźnik na napis reprezentujący poprawny numer
+ *                         lub pusty napis, który unieważnia wszystkie wyniki
+ *                         zapytań rodzaju @p query.
+ */
+void queryCacheInvalidate(QueryCache *cache, CacheQuery query,
+                          char const *prefix);
+
+/**
+ * Odczytuje liczniki i rozmiar pamięci podręcznej.
+ * @param[in] cache – wskaźnik na pamięć podręczną;
+ * @param[out] out  – wskaźnik na strukturę, w której zapisywane są liczniki.
+ */
+void queryCacheStats(QueryCache const *cache, PhfwdCacheStats *out);
+
+/**
+ * Wyznacza rozmiar pamięci zajmowanej przez pamięć podręczną wraz
+ * z przechowywanymi wynikami.
+ * @param[in] cache – wskaźnik na pamięć podręczną lub NULL.
+ * @return Rozmiar pamięci w bajtach (0, jeśli @p cache ma wartość NULL).
+ */
+size_t queryCacheBytes(QueryCache const *cache);
+
+#endif /* QUERY_CACHE_H */
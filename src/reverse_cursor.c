@@ -0,0 +1,251 @@
+/** @file
+ * Implementacja klasy implementującej kursor zwracający kolejno numery
+ * z wyników zapytań o odwrotności przekierowań.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "reverse_cursor.h"
+#include "number_functions.h"
+
+/**
+ * Liczba początkowych cyfr numeru zapisywanych w kluczu numeru (po cztery
+ * bity na cyfrę).
+ */
+#define KEY_DIGITS 16
+
+/**
+ * Numer, który zwróci kursor, zapisany jako odwołanie do nowego prefiksu
+ * i długość zastępowanego prefiksu numeru, o który pytano. Klucz zawiera
+ * początkowe cyfry numeru, więc większość porównań numerów nie wymaga
+ * odczytywania napisów.
+ */
+typedef struct ReverseCandidate {
+    uint64_t key; ///< klucz numeru
+    char const *source; ///< nowy prefiks
+    size_t index; ///< długość zastępowanego prefiksu
+} ReverseCandidate;
+
+/**
+ * Struktura przechowuje numery w kopcu minimalnym uporządkowanym
+ * leksykograficznie według numerów, które reprezentują. Numery nie są
+ * tworzone przed zwróceniem, więc pamięć kursora zależy tylko od liczby
+ * numerów, a pierwszy numer dostępny jest po czasie liniowym (ułożenie
+ * kopca), a nie po posortowaniu całego wyniku. Zwracany numer zapisywany
+ * jest w buforze, w którym pozostaje do następnego wywołania
+ * @ref phfwdReverseNext, dzięki czemu można z nim porównać kolejny numer
+ * i pominąć powtórzenia.
+ */
+struct PhfwdReverseCursor {
+    char *num; ///< kopia numeru, o który pytano
+    size_t numLength; ///< długość numeru @p num
+    ReverseCandidate *heap; ///< kopiec numerów
+    size_t count; ///< liczba numerów w kopcu
+    size_t size; ///< rozmiar tablicy @p heap
+    size_t longest; ///< długość najdłuższego numeru
+    char *buffer; /**< ostatnio zwrócony numer (pusty napis, jeśli kursor
+                  nie zwrócił jeszcze żadnego numeru) */
+    uint64_t previousKey; ///< klucz ostatnio zwróconego numeru
+    bool unique; ///< czy kursor pomija powtórzenia numerów
+};
+
+PhfwdReverseCursor *reverseCursorNew(char const *num, bool unique) {
+    PhfwdReverseCursor *newStruct = malloc(sizeof(struct PhfwdReverseCursor));
+    if (newStruct == NULL)
+        return NULL;
+
+    size_t length = strlen(num);
+    newStruct->num = malloc(length + 1);
+    if (newStruct->num == NULL) {
+        free(newStruct);
+        return NULL;
+    }
+
+    memcpy(newStruct->num, num, length + 1);
+    newStruct->numLength = length;
+    newStruct->heap = NULL;
+    newStruct->count = 0;
+    newStruct->size = 0;
+    newStruct->longest = 0;
+    newStruct->buffer = NULL;
+    newStruct->previousKey = 0;
+    newStruct->unique = unique;
+
+    return newStruct;
+}
+
+void phfwdReverseClose(PhfwdReverseCursor *cursor) {
+    if (cursor == NULL)
+        return;
+
+    free(cursor->num);
+    free(cursor->heap);
+    free(cursor->buffer);
+    free(cursor);
+}
+
+bool reverseCursorAdd(PhfwdReverseCursor *cursor, char const *source,
+                      size_t index) {
+    if (cursor->count == cursor->size) {
+        size_t size = cursor->size == 0 ? 16 : 2 * cursor->size;
+        if (size > SIZE_MAX / sizeof(ReverseCandidate))
+            return false;
+
+        ReverseCandidate *heap = realloc(cursor->heap,
+                                         size * sizeof(ReverseCandidate));
+        if (heap == NULL)
+            return false;
+
+        cursor->heap = heap;
+        cursor->size = size;
+    }
+
+    size_t sourceLength = strlen(source);
+    size_t length = sourceLength + cursor->numLength - index;
+    if (length > cursor->longest)
+        cursor->longest = length;
+
+    // kolejne cyfry zapisywane są jako ich wartości w porządku sortowania
+    // powiększone o jeden, a brak cyfry (koniec numeru) jako zero
+    uint64_t key = 0;
+    for (size_t i = 0; i < KEY_DIGITS; ++i) {
+        char c = '\0';
+        if (i < sourceLength)
+            c = source[i];
+        else if (i < length)
+            c = cursor->num[index + i - sourceLength];
+
+        key = key << 4 | (uint64_t) (sortValue(c) + 1);
+    }
+
+    cursor->heap[cursor->count].key = key;
+    cursor->heap[cursor->count].source = source;
+    cursor->heap[cursor->count].index = index;
+    ++cursor->count;
+    return true;
+}
+
+void reverseCursorClear(PhfwdReverseCursor *cursor) {
+    cursor->count = 0;
+    cursor->longest = 0;
+}
+
+size_t reverseCursorCount(PhfwdReverseCursor const *cursor) {
+    return cursor->count;
+}
+
+/** @brief Porównuje leksykograficznie dwa numery kursora.
+ * Porównuje numery reprezentowane przez @p a i @p b bez ich tworzenia:
+ * najpierw ich klucze, a jeśli są równe – napisy, przy czym po końcu
+ * nowego prefiksu porównanie przechodzi do pozostałej części numeru
+ * @p num.
+ * @param[in] num – wskaźnik na numer, o który pytano;
+ * @param[in] a   – wskaźnik na pierwszy numer;
+ * @param[in] b   – wskaźnik na drugi numer.
+ * @return Wartość ujemna, zero lub wartość dodatnia, jeśli numer @p a jest
+ *         odpowiednio mniejszy, równy lub większy niż numer @p b.
+ */
+static int compareCandidates(char const *num, ReverseCandidate const *a,
+                             ReverseCandidate const *b) {
+    if (a->key != b->key)
+        return a->key < b->key ? -1 : 1;
+
+    char const *x = a->source;
+    char const *y = b->source;
+    bool xSuffix = false;
+    bool ySuffix = false;
+
+    for (;;) {
+        if (*x == '\0' && !xSuffix) {
+            x = num + a->index;
+            xSuffix = true;
+            continue;
+        }
+        if (*y == '\0' && !ySuffix) {
+            y = num + b->index;
+            ySuffix = true;
+            continue;
+        }
+        if (*x != *y || *x == '\0')
+            return sortValue(*x) - sortValue(*y);
+
+        ++x;
+        ++y;
+    }
+}
+
+/**
+ * Przywraca własność kopca w poddrzewie elementu o indeksie @p k, którego
+ * synowie są już kopcami.
+ * @param[in, out] cursor – wskaźnik na kursor;
+ * @param[in] k           – indeks elementu kopca.
+ */
+static void siftDown(PhfwdReverseCursor *cursor, size_t k) {
+    ReverseCandidate *heap = cursor->heap;
+    ReverseCandidate item = heap[k];
+
+    for (;;) {
+        size_t child = 2 * k + 1;
+        if (child >= cursor->count)
+            break;
+
+        if (child + 1 < cursor->count &&
+            compareCandidates(cursor->num, &heap[child + 1], &heap[child]) < 0)
+            ++child;
+        if (compareCandidates(cursor->num, &heap[child], &item) >= 0)
+            break;
+
+        heap[k] = heap[child];
+        k = child;
+    }
+
+    heap[k] = item;
+}
+
+bool reverseCursorStart(PhfwdReverseCursor *cursor) {
+    cursor->buffer = malloc(cursor->longest + 1);
+    if (cursor->buffer == NULL)
+        return false;
+
+    cursor->buffer[0] = '\0';
+    for (size_t k = cursor->count / 2; k-- > 0;)
+        siftDown(cursor, k);
+
+    return true;
+}
+
+char const *phfwdReverseNext(PhfwdReverseCursor *cursor) {
+    if (cursor == NULL)
+        return NULL;
+
+    // numery są niepuste, więc pusty bufor oznacza, że kursor nie zwrócił
+    // jeszcze żadnego numeru
+    ReverseCandidate previous = {cursor->previousKey, cursor->buffer,
+                                 cursor->numLength};
+
+    while (cursor->count > 0) {
+        ReverseCandidate top = cursor->heap[0];
+
+        cursor->heap[0] = cursor->heap[--cursor->count];
+        siftDown(cursor, 0);
+
+        if (cursor->unique && cursor->buffer[0] != '\0' &&
+            compareCandidates(cursor->num, &top, &previous) == 0)
+            continue;
+
+        cursor->previousKey = top.key;
+        size_t sourceLength = strlen(top.source);
+        memcpy(cursor->buffer, top.source, sourceLength);
+        memcpy(cursor->buffer + sourceLength, cursor->num + top.index,
+               cursor->numLength - top.index + 1);
+        return cursor->buffer;
+    }
+
+    return NULL;
+}
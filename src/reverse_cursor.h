@@ -0,0 +1,70 @@
+/** @file
+ * Interfejs klasy implementującej kursor zwracający kolejno numery
+ * z wyników zapytań o odwrotności przekierowań.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef REVERSE_CURSOR_H
+#define REVERSE_CURSOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "phone_forward.h"
+
+/**
+ * Tworzy nowy kursor bez numerów.
+ * @param[in] num    – wskaźnik na napis reprezentujący numer, o który
+ *                     pytano (jest kopiowany);
+ * @param[in] unique – wartość @p true, jeśli kursor ma pomijać powtórzenia
+ *                     numerów.
+ * @return Wskaźnik na utworzony kursor lub NULL, jeśli nie udało się
+ *         alokować pamięci.
+ */
+PhfwdReverseCursor *reverseCursorNew(char const *num, bool unique);
+
+/** @brief Dodaje numer do kursora.
+ * Dodaje do kursora numer powstały z numeru, o który pytano, przez
+ * zastąpienie jego pierwszych @p index cyfr numerem @p source. Numer nie
+ * jest tworzony – kursor zapamiętuje jedynie wskaźnik @p source, który musi
+ * pozostać ważny do zamknięcia kursora.
+ * @param[in, out] cursor – wskaźnik na kursor przed wywołaniem
+ *                          @ref reverseCursorStart;
+ * @param[in] source      – wskaźnik na napis reprezentujący nowy prefiks;
+ * @param[in] index       – długość zastępowanego prefiksu, nie większa niż
+ *                          długość numeru, o który pytano.
+ * @return Wartość @p true, jeśli numer został dodany.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+bool reverseCursorAdd(PhfwdReverseCursor *cursor, char const *source,
+                      size_t index);
+
+/**
+ * Usuwa z kursora wszystkie dodane numery, np. gdy zapytanie trzeba
+ * powtórzyć.
+ * @param[in, out] cursor – wskaźnik na kursor przed wywołaniem
+ *                          @ref reverseCursorStart.
+ */
+void reverseCursorClear(PhfwdReverseCursor *cursor);
+
+/** @brief Przygotowuje kursor do zwracania numerów.
+ * Układa dodane numery w kopiec, w czasie liniowym względem ich liczby,
+ * i alokuje bufor na najdłuższy z nich. Kolejne numery zwraca potem funkcja
+ * @ref phfwdReverseNext.
+ * @param[in, out] cursor – wskaźnik na kursor.
+ * @return Wartość @p true, jeśli kursor jest gotowy.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+bool reverseCursorStart(PhfwdReverseCursor *cursor);
+
+/**
+ * Wyznacza liczbę numerów dodanych do kursora.
+ * @param[in] cursor – wskaźnik na kursor.
+ * @return Liczba numerów, których kursor jeszcze nie zwrócił.
+ */
+size_t reverseCursorCount(PhfwdReverseCursor const *cursor);
+
+#endif /* REVERSE_CURSOR_H */
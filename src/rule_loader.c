@@ -0,0 +1,368 @@
+/** @file
+ * Implementacja funkcji wczytujących przekierowania numerów telefonów
+ * z tekstu.
+ *
+ * Tekst jest wczytywany do jednego bufora fragmentami. Pełne wiersze
+ * fragmentu są sprawdzane i dzielone na numery w miejscu – za każdym numerem
+ * wpisywany jest znak NUL – a pary numerów trafiają do tablicy, która jest
+ * przekazywana funkcji @ref phfwdAddBulk, zanim bufor zostanie nadpisany.
+ * Niedokończony ostatni wiersz fragmentu przenoszony jest na początek
+ * bufora, a bufor jest powiększany tylko wtedy, gdy nie mieści się w nim
+ * jeden wiersz. Bufor i tablica par są więc alokowane raz na całe
+ * wczytywanie, a nie dla każdego wiersza.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rule_loader.h"
+#include "number_functions.h"
+
+/**
+ * Początkowy rozmiar bufora na wczytywany tekst.
+ */
+#define LOADER_BUFFER_SIZE (1 << 20)
+
+/**
+ * Struktura opisująca źródło wczytywanego tekstu: deskryptor pliku lub
+ * bufor w pamięci.
+ */
+typedef struct LoaderSource {
+    int fd; ///< deskryptor pliku lub -1, jeśli tekst pochodzi z bufora
+    char const *data; ///< bufor z tekstem
+    size_t size; ///< rozmiar bufora z tekstem
+    size_t offset; ///< liczba przeczytanych już bajtów bufora
+} LoaderSource;
+
+/**
+ * Struktura przechowująca stan wczytywania.
+ */
+typedef struct Loader {
+    PhoneForward *pf; ///< struktura, do której dodawane są przekierowania
+    bool digits[UCHAR_MAX + 1]; ///< czy dany znak jest cyfrą numeru
+    char *buffer; ///< bufor na wczytany tekst
+    size_t capacity; ///< rozmiar bufora
+    size_t used; ///< liczba bajtów tekstu w buforze
+    PhoneForwardPair *pairs; ///< pary numerów czekające na dodanie
+    size_t pairCount; ///< liczba par czekających na dodanie
+    size_t pairCapacity; ///< rozmiar tablicy par
+    size_t line; ///< liczba przetworzonych wierszy
+    size_t batchLine; ///< numer wiersza pierwszej pary czekającej na dodanie
+} Loader;
+
+/**
+ * Czyta kolejny fragment tekstu ze źródła.
+ * @param[in, out] source – wskaźnik na źródło tekstu;
+ * @param[out] buffer     – wskaźnik na bufor na tekst;
+ * @param[in] size        – rozmiar bufora;
+ * @param[out] count      – wskaźnik na zmienną, w której zapisywana jest
+ *                          liczba przeczytanych bajtów (0 na końcu tekstu).
+ * @return Wartość @p true, jeśli odczyt się powiódł.
+ *         Wartość @p false, jeśli wystąpił błąd odczytu pliku.
+ */
+static bool readSource(LoaderSource *source, char *buffer, size_t size,
+                       size_t *count) {
+    if (source->fd < 0) {
+        size_t left = source->size - source->offset;
+
+        *count = left < size ? left : size;
+        if (*count > 0)
+            memcpy(buffer, source->data + source->offset, *count);
+        source->offset += *count;
+        return true;
+    }
+
+    if (size > SSIZE_MAX)
+        size = SSIZE_MAX;
+
+    for (;;) {
+        ssize_t result = read(source->fd, buffer, size);
+
+        if (result >= 0) {
+            *count = (size_t) result;
+            return true;
+        }
+        if (errno != EINTR)
+            return false;
+    }
+}
+
+/**
+ * Sprawdza, czy znak oddziela numery w wierszu.
+ * @param[in] ch – sprawdzany znak.
+ * @return Wartość @p true, jeśli znak jest spacją lub tabulacją.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool isBlank(char ch) {
+    return ch == ' ' || ch == '\t';
+}
+
+/**
+ * Pomija białe znaki.
+ * @param[in] begin – wskaźnik na pierwszy znak;
+ * @param[in] end   – wskaźnik za ostatnim znakiem.
+ * @return Wskaźnik na pierwszy znak różny od spacji i tabulacji lub @p end.
+ */
+static char *skipBlank(char *begin, char *end) {
+    while (begin != end && isBlank(*begin))
+        ++begin;
+
+    return begin;
+}
+
+/**
+ * Pomija cyfry numeru.
+ * @param[in] loader – wskaźnik na stan wczytywania;
+ * @param[in] begin  – wskaźnik na pierwszy znak;
+ * @param[in] end    – wskaźnik za ostatnim znakiem.
+ * @return Wskaźnik na pierwszy znak niebędący cyfrą lub @p end.
+ */
+static char *skipDigits(Loader const *loader, char *begin, char *end) {
+    while (begin != end && loader->digits[(unsigned char) *begin])
+        ++begin;
+
+    return begin;
+}
+
+/**
+ * Dodaje parę numerów do tablicy par czekających na dodanie.
+ * @param[in, out] loader – wskaźnik na stan wczytywania;
+ * @param[in] num1        – wskaźnik na napis reprezentujący numer
+ *                          przekierowywany;
+ * @param[in] num2        – wskaźnik na napis reprezentujący numer, na który
+ *                          jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli para została dodana.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool appendPair(Loader *loader, char const *num1, char const *num2) {
+    if (loader->pairCount == loader->pairCapacity) {
+        size_t newCapacity = loader->pairCapacity * 2 + 1024;
+        PhoneForwardPair *tmp = NULL;
+
+        if (newCapacity < SIZE_MAX / sizeof(PhoneForwardPair))
+            tmp = realloc(loader->pairs,
+                          newCapacity * sizeof(PhoneForwardPair));
+        if (tmp == NULL)
+            return false;
+
+        loader->pairs = tmp;
+        loader->pairCapacity = newCapacity;
+    }
+
+    if (loader->pairCount == 0)
+        loader->batchLine = loader->line;
+
+    loader->pairs[loader->pairCount].num1 = num1;
+    loader->pairs[loader->pairCount].num2 = num2;
+    ++loader->pairCount;
+    return true;
+}
+
+/** @brief Przetwarza wiersz tekstu.
+ * Sprawdza wiersz i dodaje jego numery do tablicy par czekających na
+ * dodanie. Za każdym numerem wpisuje znak NUL, nadpisując znak za wierszem,
+ * jeśli numer kończy wiersz.
+ * @param[in, out] loader – wskaźnik na stan wczytywania;
+ * @param[in, out] begin  – wskaźnik na pierwszy znak wiersza;
+ * @param[in, out] end    – wskaźnik za ostatnim znakiem wiersza; można pod
+ *                          nim zapisać znak.
+ * @return Wynik przetwarzania wiersza.
+ */
+static PhfwdLoadStatus parseLine(Loader *loader, char *begin, char *end) {
+    if (end != begin && end[-1] == '\r')
+        --end;
+
+    char *num1 = skipBlank(begin, end);
+    if (num1 == end)
+        return PHFWD_LOAD_OK;
+
+    char *num1End = skipDigits(loader, num1, end);
+    char *num2 = skipBlank(num1End, end);
+    if (num1End == num1 || num2 == num1End)
+        return PHFWD_LOAD_INVALID_LINE;
+
+    char *num2End = skipDigits(loader, num2, end);
+    if (num2End == num2 || skipBlank(num2End, end) != end)
+        return PHFWD_LOAD_INVALID_LINE;
+
+    size_t length = (size_t) (num1End - num1);
+    if (length == (size_t) (num2End - num2) &&
+        memcmp(num1, num2, length) == 0)
+        return PHFWD_LOAD_INVALID_LINE;
+
+    *num1End = '\0';
+    *num2End = '\0';
+    return appendPair(loader, num1, num2) ? PHFWD_LOAD_OK :
+                                            PHFWD_LOAD_NO_MEMORY;
+}
+
+/**
+ * Dodaje do struktury przekierowania z par czekających na dodanie.
+ * @param[in, out] loader – wskaźnik na stan wczytywania.
+ * @return Wartość @p true, jeśli przekierowania zostały dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci
+ *         (przekierowania te nie są wtedy dodawane).
+ */
+static bool flushPairs(Loader *loader) {
+    bool result = phfwdAddBulk(loader->pf, loader->pairs, loader->pairCount);
+
+    loader->pairCount = 0;
+    return result;
+}
+
+/**
+ * Przetwarza pełne wiersze z bufora.
+ * @param[in, out] loader – wskaźnik na stan wczytywania;
+ * @param[in] last        – czy bufor zawiera koniec tekstu; wtedy znaki za
+ *                          ostatnim znakiem nowego wiersza również tworzą
+ *                          wiersz;
+ * @param[out] status     – wskaźnik na zmienną, w której zapisywany jest
+ *                          powód przerwania przetwarzania.
+ * @return Liczba przetworzonych bajtów bufora lub @p SIZE_MAX, jeśli
+ *         przetwarzanie przerwano z powodu błędu.
+ */
+static size_t parseLines(Loader *loader, bool last, PhfwdLoadStatus *status) {
+    char *begin = loader->buffer;
+    char *limit = loader->buffer + loader->used;
+
+    while (begin != limit) {
+        char *end = memchr(begin, '\n', (size_t) (limit - begin));
+        if (end == NULL && !last)
+            break;
+        if (end == NULL)
+            end = limit;
+
+        ++loader->line;
+        *status = parseLine(loader, begin, end);
+        if (*status != PHFWD_LOAD_OK)
+            return SIZE_MAX;
+
+        begin = end == limit ? limit : end + 1;
+    }
+
+    return (size_t) (begin - loader->buffer);
+}
+
+/**
+ * Wczytuje przekierowania ze źródła tekstu.
+ * @param[in, out] loader – wskaźnik na stan wczytywania z zaalokowanym
+ *                          buforem;
+ * @param[in, out] source – wskaźnik na źródło tekstu.
+ * @return Wynik wczytywania.
+ */
+static PhfwdLoadStatus loadSource(Loader *loader, LoaderSource *source) {
+    for (bool last = false; !last;) {
+        // w buforze zostawiamy miejsce na znak NUL za ostatnim wierszem
+        if (loader->used + 1 == loader->capacity) {
+            char *tmp = NULL;
+
+            if (loader->capacity <= SIZE_MAX / 2)
+                tmp = realloc(loader->buffer, loader->capacity * 2);
+            if (tmp == NULL) {
+                ++loader->line;
+                return PHFWD_LOAD_NO_MEMORY;
+            }
+
+            loader->buffer = tmp;
+            loader->capacity *= 2;
+        }
+
+        size_t count;
+        if (!readSource(source, loader->buffer + loader->used,
+                        loader->capacity - loader->used - 1, &count)) {
+            ++loader->line;
+            return PHFWD_LOAD_READ_ERROR;
+        }
+        last = count == 0;
+        loader->used += count;
+
+        // pary wskazują na bufor, więc trzeba je dodać przed przesunięciem
+        // niedokończonego wiersza
+        PhfwdLoadStatus status = PHFWD_LOAD_OK;
+        size_t parsed = parseLines(loader, last, &status);
+        size_t errorLine = loader->line;
+
+        if (!flushPairs(loader)) {
+            loader->line = loader->batchLine;
+            return PHFWD_LOAD_NO_MEMORY;
+        }
+        if (parsed == SIZE_MAX) {
+            loader->line = errorLine;
+            return status;
+        }
+
+        loader->used -= parsed;
+        memmove(loader->buffer, loader->buffer + parsed, loader->used);
+    }
+
+    return PHFWD_LOAD_OK;
+}
+
+/**
+ * Wczytuje przekierowania ze źródła tekstu do struktury @p pf.
+ * @param[in, out] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                          numerów;
+ * @param[in, out] source – wskaźnik na źródło tekstu;
+ * @param[out] line       – wskaźnik na zmienną na numer wiersza lub NULL.
+ * @return Wynik wczytywania.
+ */
+static PhfwdLoadStatus load(PhoneForward *pf, LoaderSource *source,
+                            size_t *line) {
+    Loader loader = {
+        .pf = pf,
+        .capacity = LOADER_BUFFER_SIZE,
+    };
+    PhfwdLoadStatus status = PHFWD_LOAD_NO_MEMORY;
+
+    // cyfry rozpoznajemy tak samo jak funkcja isCorrect, ale bez wywołania
+    // funkcji dla każdego znaku
+    for (int ch = 0; ch <= UCHAR_MAX; ++ch)
+        loader.digits[ch] = ch != '\0' && isPhNumDigit(ch);
+
+    loader.buffer = malloc(loader.capacity);
+    if (loader.buffer != NULL)
+        status = loadSource(&loader, source);
+    else
+        loader.line = 1;
+
+    if (line != NULL)
+        *line = loader.line;
+
+    free(loader.buffer);
+    free(loader.pairs);
+    return status;
+}
+
+PhfwdLoadStatus phfwdLoadFd(PhoneForward *pf, int fd, size_t *line) {
+    if (line != NULL)
+        *line = 0;
+
+    if (pf == NULL || fd < 0)
+        return PHFWD_LOAD_BAD_ARGUMENT;
+
+    LoaderSource source = {.fd = fd};
+    return load(pf, &source, line);
+}
+
+PhfwdLoadStatus phfwdLoadBuffer(PhoneForward *pf, char const *data,
+                                size_t size, size_t *line) {
+    if (line != NULL)
+        *line = 0;
+
+    if (pf == NULL || (data == NULL && size > 0))
+        return PHFWD_LOAD_BAD_ARGUMENT;
+
+    LoaderSource source = {.fd = -1, .data = data, .size = size};
+    return load(pf, &source, line);
+}
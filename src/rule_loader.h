@@ -0,0 +1,72 @@
+/** @file
+ * Interfejs funkcji wczytujących przekierowania numerów telefonów z tekstu.
+ *
+ * Tekst składa się z wierszy postaci <tt>num1 num2</tt>, w których numery
+ * oddzielone są co najmniej jedną spacją lub tabulacją. Wiersz może zaczynać
+ * się i kończyć białymi znakami oraz kończyć znakiem powrotu karetki przed
+ * znakiem nowego wiersza. Wiersze puste (lub złożone z samych białych
+ * znaków) są pomijane. Każdy wiersz działa tak jak wywołanie funkcji
+ * @ref phfwdAdd z numerami @p num1 i @p num2.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef RULE_LOADER_H
+#define RULE_LOADER_H
+
+#include <stddef.h>
+
+#include "phone_forward.h"
+
+/**
+ * Wynik wczytywania przekierowań.
+ */
+typedef enum PhfwdLoadStatus {
+    PHFWD_LOAD_OK, ///< wczytano wszystkie przekierowania
+    /** wiersz nie ma postaci <tt>num1 num2</tt> lub jego numery nie są
+        poprawne albo są identyczne */
+    PHFWD_LOAD_INVALID_LINE,
+    PHFWD_LOAD_NO_MEMORY, ///< nie udało się alokować pamięci
+    PHFWD_LOAD_READ_ERROR, ///< nie udało się odczytać pliku
+    /** wskaźnik na strukturę lub bufor ma wartość NULL albo deskryptor
+        pliku jest ujemny */
+    PHFWD_LOAD_BAD_ARGUMENT
+} PhfwdLoadStatus;
+
+/** @brief Wczytuje przekierowania z deskryptora pliku.
+ * Czyta tekst z deskryptora @p fd do jego końca i dodaje opisane w nim
+ * przekierowania do struktury @p pf. Tekst jest czytany i przetwarzany
+ * fragmentami, bez alokacji pamięci dla poszczególnych wierszy. Jeśli
+ * wczytywanie zostanie przerwane, to przekierowania z wierszy
+ * poprzedzających wiersz, na którym je przerwano, pozostają dodane,
+ * a przekierowania z kolejnych wierszy nie są dodawane.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] fd      – deskryptor pliku otwartego do odczytu;
+ * @param[out] line   – wskaźnik na zmienną, w której zapisywany jest numer
+ *                      (liczony od 1) wiersza, na którym przerwano
+ *                      wczytywanie, lub liczba wczytanych wierszy, jeśli
+ *                      wczytano wszystkie; może mieć wartość NULL.
+ * @return Wynik wczytywania.
+ */
+PhfwdLoadStatus phfwdLoadFd(PhoneForward *pf, int fd, size_t *line);
+
+/** @brief Wczytuje przekierowania z bufora.
+ * Działa tak jak funkcja @ref phfwdLoadFd, ale czyta tekst z bufora
+ * @p data o rozmiarze @p size bajtów. Bufor nie musi kończyć się znakiem
+ * NUL ani znakiem nowego wiersza.
+ * @param[in, out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] data    – wskaźnik na bufor z tekstem;
+ * @param[in] size    – rozmiar bufora w bajtach;
+ * @param[out] line   – wskaźnik na zmienną, w której zapisywany jest numer
+ *                      wiersza, tak jak w funkcji @ref phfwdLoadFd; może mieć
+ *                      wartość NULL.
+ * @return Wynik wczytywania.
+ */
+PhfwdLoadStatus phfwdLoadBuffer(PhoneForward *pf, char const *data,
+                                size_t size, size_t *line);
+
+#endif /* RULE_LOADER_H */
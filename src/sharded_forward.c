@@ -0,0 +1,265 @@
+/** @file
+ * Implementacja klasy przechowującej przekierowania numerów telefonicznych
+ * podzielone na niezależnie modyfikowane części.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sharded_forward.h"
+#include "phone_numbers.h"
+#include "number_functions.h"
+
+/**
+ * Liczba części struktury – po jednej na każdą cyfrę.
+ */
+#define SHARD_COUNT 12
+
+/**
+ * Struktura przechowująca jedną część przekierowań wraz z blokadą
+ * szeregującą jej modyfikacje. Zajmuje osobną linię pamięci podręcznej, aby
+ * pisarze różnych części nie współdzielili jednej linii.
+ */
+typedef struct Shard {
+    _Alignas(64) pthread_mutex_t lock; ///< blokada pisarzy części
+    PhoneForward *pf; ///< przekierowania przechowywane w części
+} Shard;
+
+/**
+ * Przekierowanie numerów o prefiksie @p num1 jest przechowywane w całości
+ * (wraz z odwrotnością w drzewie odwrotności przekierowań) w części
+ * odpowiadającej pierwszej cyfrze @p num1. Wszystkie numery o prefiksie
+ * @p num1 zaczynają się od tej samej cyfry, więc przekierowanie każdego
+ * numeru wyznacza jedna część, a elementy tablic odwrotności przekierowań
+ * nigdy nie wskazują węzłów innej części. Dzięki temu modyfikacje różnych
+ * części nie wymagają wspólnej blokady. Zapytania nie zakładają blokad
+ * (części mają włączone współbieżne zapytania), a zapytania o odwrotności
+ * przekierowań łączą wyniki wszystkich części.
+ */
+struct ShardedForward {
+    Shard shards[SHARD_COUNT]; ///< części struktury
+};
+
+/**
+ * Wyznacza część, w której przechowywane są przekierowania numeru.
+ * @param[in] sf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na część odpowiadającą pierwszej cyfrze numeru @p num lub
+ *         na pierwszą część, jeśli @p num nie reprezentuje numeru.
+ */
+static Shard *shardOf(ShardedForward const *sf, char const *num) {
+    unsigned int digit = isCorrect(num) ? charToDigit(num[0]) : 0;
+
+    return (Shard *) &sf->shards[digit];
+}
+
+ShardedForward *shfwdNew(void) {
+    ShardedForward *newStruct = aligned_alloc(_Alignof(ShardedForward),
+                                              sizeof(ShardedForward));
+    if (newStruct == NULL)
+        return NULL;
+
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        Shard *shard = &newStruct->shards[s];
+
+        shard->pf = phfwdNew();
+        if (shard->pf == NULL || !phfwdEnableConcurrentReads(shard->pf) ||
+            pthread_mutex_init(&shard->lock, NULL) != 0) {
+            phfwdDelete(shard->pf);
+
+            while (s-- > 0) {
+                pthread_mutex_destroy(&newStruct->shards[s].lock);
+                phfwdDelete(newStruct->shards[s].pf);
+            }
+            free(newStruct);
+            return NULL;
+        }
+    }
+
+    return newStruct;
+}
+
+void shfwdDelete(ShardedForward *sf) {
+    if (sf == NULL)
+        return;
+
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        pthread_mutex_destroy(&sf->shards[s].lock);
+        phfwdDelete(sf->shards[s].pf);
+    }
+    free(sf);
+}
+
+bool shfwdAdd(ShardedForward *sf, char const *num1, char const *num2) {
+    if (sf == NULL)
+        return false;
+
+    Shard *shard = shardOf(sf, num1);
+
+    pthread_mutex_lock(&shard->lock);
+    bool result = phfwdAdd(shard->pf, num1, num2);
+    pthread_mutex_unlock(&shard->lock);
+
+    return result;
+}
+
+bool shfwdRemove(ShardedForward *sf, char const *num) {
+    if (sf == NULL)
+        return false;
+
+    Shard *shard = shardOf(sf, num);
+
+    pthread_mutex_lock(&shard->lock);
+    bool result = phfwdRemove(shard->pf, num);
+    pthread_mutex_unlock(&shard->lock);
+
+    return result;
+}
+
+PhoneNumbers *shfwdGet(ShardedForward const *sf, char const *num) {
+    if (sf == NULL)
+        return NULL;
+
+    return phfwdGet(shardOf(sf, num)->pf, num);
+}
+
+/**
+ * Dodaje do ciągu @p result numery z ciągu @p part różne od @p skip.
+ * @param[in, out] result – wskaźnik na strukturę przechowującą ciąg numerów;
+ * @param[in] part        – wskaźnik na strukturę przechowującą dodawany ciąg
+ *                          numerów;
+ * @param[in] skip        – wskaźnik na napis reprezentujący pomijany numer
+ *                          lub NULL, jeśli żaden numer nie jest pomijany.
+ * @return Wartość @p true, jeśli numery zostały dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool appendNumbers(PhoneNumbers *result, PhoneNumbers const *part,
+                          char const *skip) {
+    char const *number;
+
+    for (size_t i = 0; (number = phnumGet(part, i)) != NULL; ++i)
+        if ((skip == NULL || strcmp(number, skip) != 0) &&
+            !phnumAdd(result, number, "", 0))
+            return false;
+
+    return true;
+}
+
+/**
+ * Łączy wyniki zapytania @p query o numer @p num ze wszystkich części.
+ * Z wyników części innej niż część numeru @p num pomijany jest sam numer
+ * @p num, jeśli @p skipOwn ma wartość @p true.
+ * @param[in] sf      – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] num     – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] query   – zapytanie wykonywane na każdej części;
+ * @param[in] skipOwn – czy pomijać numer @p num w wynikach pozostałych
+ *                      części.
+ * @return Wskaźnik na strukturę przechowującą nieposortowany ciąg numerów lub
+ *         NULL, gdy nie udało się alokować pamięci.
+ */
+static PhoneNumbers *mergeShards(ShardedForward const *sf, char const *num,
+                                 PhoneNumbers *(*query)(PhoneForward const *,
+                                                        char const *),
+                                 bool skipOwn) {
+    Shard const *own = shardOf(sf, num);
+    PhoneNumbers *result = phnumNew();
+
+    for (size_t s = 0; s < SHARD_COUNT && result != NULL; ++s) {
+        Shard const *shard = &sf->shards[s];
+        PhoneNumbers *part = query(shard->pf, num);
+        char const *skip = skipOwn && shard != own ? num : NULL;
+
+        if (part == NULL || !appendNumbers(result, part, skip)) {
+            phnumDelete(result);
+            result = NULL;
+        }
+        phnumDelete(part);
+    }
+
+    return result;
+}
+
+PhoneNumbers *shfwdReverse(ShardedForward const *sf, char const *num) {
+    if (sf == NULL)
+        return NULL;
+
+    if (!isCorrect(num))
+        return phnumNew();
+
+    // każda część zwraca też sam numer num, więc wynik trzeba oczyścić
+    // z powtórzeń
+    PhoneNumbers *result = mergeShards(sf, num, phfwdReverse, false);
+
+    if (result == NULL)
+        return NULL;
+
+    if (!phnumSort(result)) {
+        phnumDelete(result);
+        return NULL;
+    }
+    phnumRemoveDuplicates(result);
+
+    return result;
+}
+
+PhoneNumbers *shfwdGetReverse(ShardedForward const *sf, char const *num) {
+    if (sf == NULL)
+        return NULL;
+
+    if (!isCorrect(num))
+        return phnumNew();
+
+    // w częściach innych niż część numeru num numer ten nie jest
+    // przekierowany, więc zawsze należy do ich wyników – o tym, czy należy do
+    // wyniku, decyduje jedynie jego część
+    PhoneNumbers *result = mergeShards(sf, num, phfwdGetReverse, true);
+    if (result == NULL)
+        return NULL;
+
+    if (!phnumSort(result)) {
+        phnumDelete(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+/**
+ * Sumuje wyniki zapytania @p query o numer @p num we wszystkich częściach.
+ * Numery wyznaczane przez przekierowania różnych części zaczynają się od
+ * różnych cyfr, więc powtarza się jedynie sam numer @p num: wyniki
+ * @ref phfwdReverse zawierają go zawsze, a w częściach innych niż część
+ * numeru @p num nie jest on przekierowany, więc zawierają go też ich wyniki
+ * @ref phfwdGetReverse. Wliczamy go więc tylko w części numeru @p num.
+ * @param[in] sf    – wskaźnik na strukturę przechowującą przekierowania
+ *                    numerów;
+ * @param[in] num   – wskaźnik na napis reprezentujący numer;
+ * @param[in] query – zapytanie wykonywane na każdej części.
+ * @return Liczba numerów wyniku lub 0, jeśli podany napis nie reprezentuje
+ *         numeru lub wskaźnik @p sf wynosi NULL.
+ */
+static size_t sumShards(ShardedForward const *sf, char const *num,
+                        size_t (*query)(PhoneForward const *, char const *)) {
+    if (sf == NULL || !isCorrect(num))
+        return 0;
+
+    size_t count = 0;
+    for (size_t s = 0; s < SHARD_COUNT; ++s)
+        count += query(sf->shards[s].pf, num);
+
+    return count - (SHARD_COUNT - 1);
+}
+
+size_t shfwdReverseCount(ShardedForward const *sf, char const *num) {
+    return sumShards(sf, num, phfwdReverseCount);
+}
+
+size_t shfwdGetReverseCount(ShardedForward const *sf, char const *num) {
+    return sumShards(sf, num, phfwdGetReverseCount);
+}
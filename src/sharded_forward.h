@@ -0,0 +1,130 @@
+/** @file
+ * Interfejs klasy przechowującej przekierowania numerów telefonicznych
+ * podzielone na niezależnie modyfikowane części według pierwszej cyfry
+ * numeru przekierowywanego.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef SHARDED_FORWARD_H
+#define SHARDED_FORWARD_H
+
+#include <stdbool.h>
+
+#include "phone_forward.h"
+
+/**
+ * Struktura przechowująca przekierowania numerów telefonów podzielone na
+ * części. Opis jej budowy znajduje się w pliku sharded_forward.c.
+ */
+struct ShardedForward;
+
+/**
+ * Typ @p ShardedForward reprezentuje strukturę @p ShardedForward.
+ */
+typedef struct ShardedForward ShardedForward;
+
+/** @brief Tworzy nową strukturę.
+ * Tworzy nową strukturę niezawierającą żadnych przekierowań. Wszystkie
+ * funkcje struktury mogą być wywoływane współbieżnie przez wiele wątków,
+ * z wyjątkiem funkcji @ref shfwdDelete.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+ShardedForward *shfwdNew(void);
+
+/** @brief Usuwa strukturę.
+ * Usuwa strukturę wskazywaną przez @p sf. Nic nie robi, jeśli wskaźnik ten ma
+ * wartość NULL. W trakcie wywołania nie może trwać żadna inna operacja na
+ * strukturze.
+ * @param[in] sf – wskaźnik na usuwaną strukturę.
+ */
+void shfwdDelete(ShardedForward *sf);
+
+/** @brief Dodaje przekierowanie.
+ * Działa tak jak funkcja @ref phfwdAdd. Modyfikacje dotyczące numerów
+ * przekierowywanych o różnych pierwszych cyfrach są wykonywane równolegle.
+ * @param[in, out] sf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] num1    – wskaźnik na napis reprezentujący prefiks numerów
+ *                      przekierowywanych;
+ * @param[in] num2    – wskaźnik na napis reprezentujący prefiks numerów,
+ *                      na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
+ *         reprezentuje numeru, oba podane numery są identyczne lub nie udało
+ *         się alokować pamięci.
+ */
+bool shfwdAdd(ShardedForward *sf, char const *num1, char const *num2);
+
+/** @brief Usuwa przekierowania.
+ * Działa tak jak funkcja @ref phfwdRemove.
+ * @param[in, out] sf – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] num     – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli przekierowania zostały usunięte lub nie ma
+ *         przekierowań do usunięcia.
+ *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
+ *         reprezentuje numeru, nie udało się alokować pamięci lub wskaźnik
+ *         @p sf ma wartość NULL.
+ */
+bool shfwdRemove(ShardedForward *sf, char const *num);
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Działa tak jak funkcja @ref phfwdGet.
+ * @param[in] sf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub wskaźnik @p sf wynosi NULL.
+ */
+PhoneNumbers *shfwdGet(ShardedForward const *sf, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer.
+ * Działa tak jak funkcja @ref phfwdReverse. Wynik łączy wyniki wszystkich
+ * części, z których każda jest odczytywana spójnie, ale nie wszystkie
+ * w tej samej chwili.
+ * @param[in] sf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub wskaźnik @p sf wynosi NULL.
+ */
+PhoneNumbers *shfwdReverse(ShardedForward const *sf, char const *num);
+
+/** @brief Wyznacza numery przekierowywane na dany numer.
+ * Działa tak jak funkcja @ref phfwdGetReverse. Wynik łączy wyniki wszystkich
+ * części, z których każda jest odczytywana spójnie, ale nie wszystkie
+ * w tej samej chwili.
+ * @param[in] sf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub wskaźnik @p sf wynosi NULL.
+ */
+PhoneNumbers *shfwdGetReverse(ShardedForward const *sf, char const *num);
+
+/** @brief Wyznacza liczbę przekierowań na dany numer.
+ * Działa tak jak funkcja @ref phfwdReverseCount. Wynik sumuje wyniki
+ * wszystkich części, z których każda jest odczytywana spójnie, ale nie
+ * wszystkie w tej samej chwili.
+ * @param[in] sf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Liczba numerów wyniku funkcji @ref shfwdReverse. Wartość 0, jeśli
+ *         podany napis nie reprezentuje numeru lub wskaźnik @p sf wynosi
+ *         NULL.
+ */
+size_t shfwdReverseCount(ShardedForward const *sf, char const *num);
+
+/** @brief Wyznacza liczbę numerów przekierowywanych na dany numer.
+ * Działa tak jak funkcja @ref phfwdGetReverseCount. Wynik sumuje wyniki
+ * wszystkich części, z których każda jest odczytywana spójnie, ale nie
+ * wszystkie w tej samej chwili.
+ * @param[in] sf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Liczba numerów wyniku funkcji @ref shfwdGetReverse. Wartość 0,
+ *         jeśli wynik jest pusty, podany napis nie reprezentuje numeru lub
+ *         wskaźnik @p sf wynosi NULL.
+ */
+size_t shfwdGetReverseCount(ShardedForward const *sf, char const *num);
+
+#endif /* SHARDED_FORWARD_H */
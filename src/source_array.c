@@ -0,0 +1,243 @@
+/** @file
+ * Implementacja klasy implementującej tablicę numerów przekierowanych na
+ * jeden numer, przechowywaną w węźle drzewa odwrotności przekierowań.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "source_array.h"
+
+/**
+ * Element tablicy: węzeł drzewa przekierowań i kopia odpowiadającego mu
+ * numeru. Pola elementu zapisywane i odczytywane są niepodzielnie, bo
+ * mogą je odczytywać współbieżni czytelnicy.
+ */
+typedef struct SourceEntry {
+    char *source; ///< numer odpowiadający węzłowi @p node
+    PoolIndex node; ///< indeks węzła drzewa przekierowań
+} SourceEntry;
+
+/**
+ * Struktura przechowuje nagłówek tablicy, za którym w tym samym bloku
+ * pamięci znajduje się numer target zakończony znakiem '\0', a za nim
+ * (od najbliższego adresu wyrównanego do rozmiaru elementu) elementy
+ * tablicy. Numer target leży tuż za nagłówkiem, więc zapytanie
+ * o przekierowanie odczytuje zwykle tylko jedną linię pamięci podręcznej.
+ * Elementy węzłów mających synów poprzedzają elementy liści, więc liczbę
+ * elementów liści wyznacza się bez przeglądania tablicy.
+ */
+struct SourceArray {
+    uint32_t length; /**< liczba elementów tablicy, odczytywana przez
+                     współbieżnych czytelników */
+    uint32_t reserved; ///< liczba zarezerwowanych miejsc
+    uint32_t capacity; ///< liczba elementów mieszczących się w tablicy
+    uint32_t targetLength; ///< długość numeru target
+    uint32_t inner; /**< liczba początkowych elementów tablicy, których
+                    węzły mają synów, odczytywana przez współbieżnych
+                    czytelników */
+    uint32_t padding; ///< wyrównanie numeru target do 8 bajtów
+    char target[]; ///< numer target, a za nim elementy tablicy
+};
+
+/**
+ * Wyznacza rozmiar miejsca na numer target wraz z wyrównaniem elementów.
+ * @param[in] targetLength – długość numeru target.
+ * @return Odległość w bajtach od początku numeru target do pierwszego
+ *         elementu tablicy.
+ */
+static size_t targetSpace(size_t targetLength) {
+    size_t align = _Alignof(SourceEntry);
+
+    return (targetLength + align) / align * align;
+}
+
+/**
+ * Wyznacza rozmiar bloku tablicy przekazywany do puli.
+ * @param[in] capacity     – pojemność tablicy;
+ * @param[in] targetLength – długość numeru target nie większa niż
+ *                           UINT32_MAX.
+ * @return Rozmiar bloku w bajtach lub 0, jeśli wykracza on poza zakres
+ *         typu size_t.
+ */
+static size_t blockSize(uint32_t capacity, size_t targetLength) {
+    size_t header = sizeof(struct SourceArray) + targetSpace(targetLength);
+
+    if (capacity > (SIZE_MAX - header) / sizeof(SourceEntry))
+        return 0;
+
+    return header + (size_t) capacity * sizeof(SourceEntry);
+}
+
+/**
+ * Wyznacza adres elementów w bloku tablicy.
+ * @param[in] array – wskaźnik na tablicę.
+ * @return Wskaźnik na pierwszy element tablicy.
+ */
+static SourceEntry *entriesAt(SourceArray const *array) {
+    return (SourceEntry *) (array->target + targetSpace(array->targetLength));
+}
+
+/**
+ * Zapisuje element tablicy. Współbieżny czytelnik może właśnie odczytywać
+ * ten element, więc każde pole zapisywane jest niepodzielnie, z semantyką
+ * zwolnienia, aby czytelnik, który zobaczy nowy napis, zobaczył również
+ * jego zawartość. Czytelnik może zobaczyć pola pochodzące z różnych
+ * elementów, ale jego wynik zostanie wtedy odrzucony.
+ * @param[out] entry – wskaźnik na element;
+ * @param[in] node   – indeks węzła drzewa przekierowań;
+ * @param[in] source – wskaźnik na napis.
+ */
+static void storeEntry(SourceEntry *entry, PoolIndex node, char *source) {
+    __atomic_store_n(&entry->source, source, __ATOMIC_RELEASE);
+    __atomic_store_n(&entry->node, node, __ATOMIC_RELEASE);
+}
+
+SourceArray *sourceArrayNew(StringPool *pool, char const *target,
+                            size_t length, uint32_t capacity) {
+    if (length > UINT32_MAX)
+        return NULL;
+
+    size_t size = blockSize(capacity, length);
+    if (size == 0)
+        return NULL;
+
+    SourceArray *newStruct = stringPoolAlloc(pool, size);
+    if (newStruct != NULL) {
+        newStruct->length = 0;
+        newStruct->reserved = 0;
+        newStruct->capacity = capacity;
+        newStruct->targetLength = (uint32_t) length;
+        newStruct->inner = 0;
+        newStruct->padding = 0;
+        memcpy(newStruct->target, target, length);
+        newStruct->target[length] = '\0';
+    }
+
+    return newStruct;
+}
+
+void sourceArrayDelete(StringPool *pool, SourceArray *array) {
+    if (array != NULL)
+        stringPoolRelease(pool, array,
+                          blockSize(array->capacity, array->targetLength));
+}
+
+SourceArray *sourceArrayGrow(StringPool *pool, SourceArray const *array) {
+    if (array->capacity > UINT32_MAX / 2)
+        return NULL;
+
+    SourceArray *newStruct = sourceArrayNew(pool, array->target,
+                                            array->targetLength,
+                                            2 * array->capacity);
+    if (newStruct != NULL) {
+        newStruct->length = array->length;
+        newStruct->reserved = array->reserved;
+        newStruct->inner = array->inner;
+        memcpy(entriesAt(newStruct), entriesAt(array),
+               array->length * sizeof(SourceEntry));
+    }
+
+    return newStruct;
+}
+
+bool sourceArrayReserve(SourceArray *array) {
+    if (array->length + array->reserved == array->capacity)
+        return false;
+
+    ++array->reserved;
+    return true;
+}
+
+void sourceArrayCancel(SourceArray *array) {
+    --array->reserved;
+}
+
+uint32_t sourceArrayPush(SourceArray *array, PoolIndex node, char *source) {
+    SourceEntry *entries = entriesAt(array);
+    uint32_t slot = array->length;
+
+    --array->reserved;
+    storeEntry(&entries[slot], node, source);
+    __atomic_store_n(&array->length, slot + 1, __ATOMIC_RELEASE);
+
+    return slot;
+}
+
+PoolIndex sourceArrayRemove(SourceArray *array, uint32_t slot) {
+    SourceEntry *entries = entriesAt(array);
+    uint32_t last = array->length - 1;
+    PoolIndex moved = POOL_NULL;
+
+    if (slot != last) {
+        moved = entries[last].node;
+        storeEntry(&entries[slot], moved, entries[last].source);
+    }
+    __atomic_store_n(&array->length, last, __ATOMIC_RELEASE);
+
+    return moved;
+}
+
+PoolIndex sourceArraySetLeaf(SourceArray *array, uint32_t *slot, bool leaf) {
+    SourceEntry *entries = entriesAt(array);
+    uint32_t inner = array->inner;
+
+    // element zamieniamy miejscami ze skrajnym elementem drugiej części
+    // tablicy, po czym przesuwamy granicę między częściami
+    uint32_t border = leaf ? inner - 1 : inner;
+    PoolIndex moved = POOL_NULL;
+
+    if (*slot != border) {
+        SourceEntry entry = entries[*slot];
+
+        moved = entries[border].node;
+        storeEntry(&entries[*slot], moved, entries[border].source);
+        storeEntry(&entries[border], entry.node, entry.source);
+        *slot = border;
+    }
+    __atomic_store_n(&array->inner, leaf ? inner - 1 : inner + 1,
+                     __ATOMIC_RELEASE);
+
+    return moved;
+}
+
+bool sourceArrayIsUnused(SourceArray const *array) {
+    return array->length == 0 && array->reserved == 0;
+}
+
+size_t sourceArrayLength(SourceArray const *array) {
+    return __atomic_load_n(&array->length, __ATOMIC_ACQUIRE);
+}
+
+size_t sourceArrayUsed(SourceArray const *array) {
+    return (size_t) array->length + array->reserved;
+}
+
+size_t sourceArrayBytes(SourceArray const *array) {
+    return stringPoolBlockFootprint(blockSize(array->capacity,
+                                              array->targetLength));
+}
+
+PoolIndex sourceArrayNode(SourceArray const *array, size_t slot) {
+    return __atomic_load_n(&entriesAt(array)[slot].node, __ATOMIC_ACQUIRE);
+}
+
+char *sourceArraySource(SourceArray const *array, size_t slot) {
+    return __atomic_load_n(&entriesAt(array)[slot].source, __ATOMIC_ACQUIRE);
+}
+
+bool sourceArrayIsLeaf(SourceArray const *array, size_t slot) {
+    return slot >= __atomic_load_n(&array->inner, __ATOMIC_ACQUIRE);
+}
+
+size_t sourceArrayInnerLength(SourceArray const *array) {
+    return __atomic_load_n(&array->inner, __ATOMIC_ACQUIRE);
+}
+
+char const *sourceArrayTarget(SourceArray const *array) {
+    return array->target;
+}
@@ -0,0 +1,211 @@
+/** @file
+ * Interfejs klasy implementującej tablicę numerów przekierowanych na jeden
+ * numer, przechowywaną w węźle drzewa odwrotności przekierowań.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef SOURCE_ARRAY_H
+#define SOURCE_ARRAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pool.h"
+#include "string_pool.h"
+
+/**
+ * Struktura reprezentująca tablicę numerów przekierowanych na wspólny numer
+ * (ang. target). Jeden blok pamięci zawiera długość i pojemność tablicy,
+ * jej elementy – indeksy węzłów drzewa przekierowań wraz z kopiami
+ * odpowiadających im numerów – oraz sam numer target, więc przeglądanie
+ * tablicy jest liniowym przejściem po pamięci. Elementy węzłów mających
+ * synów znajdują się przed elementami liści drzewa. Bloki przydzielane są
+ * z puli napisów, więc są zwalniane wraz z nią. Elementy usuwane są przez
+ * przeniesienie na ich miejsce ostatniego elementu. Blok nie jest nigdy
+ * powiększany w miejscu: funkcja @ref sourceArrayGrow tworzy jego większą
+ * kopię, dzięki czemu czytelnik, który właśnie przegląda stary blok, może
+ * bezpiecznie dokończyć przeglądanie.
+ */
+struct SourceArray;
+
+/**
+ * Typ @p SourceArray reprezentuje strukturę @p SourceArray.
+ */
+typedef struct SourceArray SourceArray;
+
+/**
+ * Tworzy nową, pustą tablicę.
+ * @param[in, out] pool – wskaźnik na pulę, z której przydzielana jest
+ *                        tablica;
+ * @param[in] target   – wskaźnik na napis reprezentujący numer, na który
+ *                       przekierowane są numery tablicy;
+ * @param[in] length   – długość napisu @p target;
+ * @param[in] capacity – dodatnia liczba elementów, które zmieszczą się
+ *                       w tablicy.
+ * @return Wskaźnik na utworzoną tablicę lub NULL, jeśli nie udało się
+ *         alokować pamięci.
+ */
+SourceArray *sourceArrayNew(StringPool *pool, char const *target,
+                            size_t length, uint32_t capacity);
+
+/**
+ * Zwraca tablicę do puli (bez napisów wskazywanych przez jej elementy).
+ * Nic nie robi, jeśli wskaźnik @p array ma wartość NULL.
+ * @param[in, out] pool – wskaźnik na pulę, z której przydzielono tablicę;
+ * @param[in] array     – wskaźnik na usuwaną tablicę.
+ */
+void sourceArrayDelete(StringPool *pool, SourceArray *array);
+
+/**
+ * Tworzy kopię tablicy o dwukrotnie większej pojemności. Tablica @p array
+ * nie jest zmieniana.
+ * @param[in, out] pool – wskaźnik na pulę, z której przydzielana jest kopia;
+ * @param[in] array     – wskaźnik na tablicę.
+ * @return Wskaźnik na kopię tablicy lub NULL, jeśli nie udało się alokować
+ *         pamięci.
+ */
+SourceArray *sourceArrayGrow(StringPool *pool, SourceArray const *array);
+
+/** @brief Rezerwuje miejsce na element.
+ * Rezerwuje w tablicy miejsce na jeden element, który zostanie później
+ * dodany funkcją @ref sourceArrayPush. Rezerwacja pozwala dodać element bez
+ * alokowania pamięci.
+ * @param[in, out] array – wskaźnik na tablicę.
+ * @return Wartość @p true, jeśli miejsce zostało zarezerwowane.
+ *         Wartość @p false, jeśli tablica jest pełna.
+ */
+bool sourceArrayReserve(SourceArray *array);
+
+/**
+ * Anuluje rezerwację miejsca dokonaną funkcją @ref sourceArrayReserve.
+ * @param[in, out] array – wskaźnik na tablicę.
+ */
+void sourceArrayCancel(SourceArray *array);
+
+/** @brief Dodaje element na koniec tablicy.
+ * Dodaje element liścia drzewa w miejscu zarezerwowanym funkcją
+ * @ref sourceArrayReserve. Element węzła mającego synów należy następnie
+ * przenieść funkcją @ref sourceArraySetLeaf. Zwiększenie długości tablicy
+ * ma semantykę zwolnienia, więc współbieżny czytelnik, który zobaczy nową
+ * długość, zobaczy również element.
+ * @param[in, out] array – wskaźnik na tablicę;
+ * @param[in] node       – indeks węzła drzewa przekierowań;
+ * @param[in] source     – wskaźnik na napis (nie jest kopiowany).
+ * @return Indeks dodanego elementu w tablicy.
+ */
+uint32_t sourceArrayPush(SourceArray *array, PoolIndex node, char *source);
+
+/** @brief Usuwa element tablicy.
+ * Usuwa element liścia drzewa o indeksie @p slot, przenosząc na jego
+ * miejsce ostatni element tablicy. Element węzła mającego synów należy
+ * najpierw przenieść funkcją @ref sourceArraySetLeaf.
+ * @param[in, out] array – wskaźnik na tablicę;
+ * @param[in] slot       – indeks usuwanego elementu.
+ * @return Indeks węzła drzewa przekierowań przechowywany w przeniesionym
+ *         elemencie (którego indeksem jest teraz @p slot) lub
+ *         @ref POOL_NULL, jeśli usunięty element był ostatni.
+ */
+PoolIndex sourceArrayRemove(SourceArray *array, uint32_t slot);
+
+/** @brief Przenosi element między elementy liści lub węzłów mających synów.
+ * Wywoływana, gdy węzeł drzewa przekierowań przechowywany w elemencie
+ * tablicy zyskuje pierwszego syna lub traci ostatniego (albo gdy element
+ * ma zostać usunięty). Element zamieniany jest miejscami ze skrajnym
+ * elementem drugiej części tablicy, więc operacja działa w czasie stałym.
+ * @param[in, out] array – wskaźnik na tablicę;
+ * @param[in, out] slot  – wskaźnik na indeks elementu, zmieniany na jego
+ *                         nowy indeks;
+ * @param[in] leaf       – wartość @p true, jeśli węzeł nie ma synów
+ *                         (element musi należeć do elementów węzłów
+ *                         mających synów), a @p false, jeśli je ma (element
+ *                         musi należeć do elementów liści).
+ * @return Indeks węzła drzewa przekierowań przechowywany w elemencie
+ *         przeniesionym na dawne miejsce elementu @p *slot lub
+ *         @ref POOL_NULL, jeśli żaden element nie został przeniesiony.
+ */
+PoolIndex sourceArraySetLeaf(SourceArray *array, uint32_t *slot, bool leaf);
+
+/**
+ * Sprawdza, czy tablica nie ma elementów ani zarezerwowanych miejsc, czyli
+ * czy można ją usunąć.
+ * @param[in] array – wskaźnik na tablicę.
+ * @return Wartość @p true, jeśli tablica jest nieużywana.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+bool sourceArrayIsUnused(SourceArray const *array);
+
+/**
+ * Wyznacza liczbę elementów tablicy. Odczyt ma semantykę nabycia, więc
+ * elementy o mniejszych indeksach są widoczne.
+ * @param[in] array – wskaźnik na tablicę.
+ * @return Liczba elementów tablicy.
+ */
+size_t sourceArrayLength(SourceArray const *array);
+
+/**
+ * Wyznacza liczbę elementów tablicy wraz z zarezerwowanymi miejscami.
+ * @param[in] array – wskaźnik na tablicę.
+ * @return Liczba elementów i zarezerwowanych miejsc tablicy.
+ */
+size_t sourceArrayUsed(SourceArray const *array);
+
+/**
+ * Wyznacza rozmiar pamięci zajmowanej przez tablicę w puli (wraz
+ * z zaokrągleniem do rozmiaru obiektu puli).
+ * @param[in] array – wskaźnik na tablicę.
+ * @return Rozmiar tablicy w bajtach.
+ */
+size_t sourceArrayBytes(SourceArray const *array);
+
+/**
+ * Znajduje węzeł przechowywany w elemencie tablicy. Odczyt ma semantykę
+ * nabycia, więc węzeł jest widoczny w całości.
+ * @param[in] array – wskaźnik na tablicę;
+ * @param[in] slot  – indeks elementu mniejszy niż długość tablicy.
+ * @return Indeks węzła drzewa przekierowań.
+ */
+PoolIndex sourceArrayNode(SourceArray const *array, size_t slot);
+
+/**
+ * Znajduje napis przechowywany w elemencie tablicy. Odczyt ma semantykę
+ * nabycia, więc napis jest widoczny w całości.
+ * @param[in] array – wskaźnik na tablicę;
+ * @param[in] slot  – indeks elementu mniejszy niż długość tablicy.
+ * @return Wskaźnik na napis @p source przekazany do funkcji
+ *         @ref sourceArrayPush.
+ */
+char *sourceArraySource(SourceArray const *array, size_t slot);
+
+/** @brief Sprawdza, czy węzeł elementu tablicy jest liściem.
+ * Sprawdza, czy węzeł drzewa przekierowań przechowywany w elemencie tablicy
+ * nie ma synów. Przekierowania liścia nie przesłania żadne dłuższe
+ * przekierowanie, więc można to stwierdzić bez schodzenia w drzewie.
+ * @param[in] array – wskaźnik na tablicę;
+ * @param[in] slot  – indeks elementu mniejszy niż długość tablicy.
+ * @return Wartość @p true, jeśli węzeł nie ma synów.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+bool sourceArrayIsLeaf(SourceArray const *array, size_t slot);
+
+/**
+ * Wyznacza liczbę elementów tablicy, których węzły mają synów. Elementy te
+ * mają najmniejsze indeksy, a pozostałe elementy tablicy są elementami
+ * liści drzewa.
+ * @param[in] array – wskaźnik na tablicę.
+ * @return Liczba elementów węzłów mających synów.
+ */
+size_t sourceArrayInnerLength(SourceArray const *array);
+
+/**
+ * Znajduje numer, na który przekierowane są numery tablicy.
+ * @param[in] array – wskaźnik na tablicę.
+ * @return Wskaźnik na kopię napisu @p target przekazanego do funkcji
+ *         @ref sourceArrayNew, przechowywaną w bloku tablicy.
+ */
+char const *sourceArrayTarget(SourceArray const *array);
+
+#endif /* SOURCE_ARRAY_H */
@@ -0,0 +1,103 @@
+/** @file
+ * Makra zbierające liczniki operacji struktury PhoneForward.
+ *
+ * Liczniki zbierane są tylko wtedy, gdy zdefiniowane jest makro
+ * @p PHFWD_STATS. W przeciwnym przypadku wszystkie makra z tego pliku są
+ * puste, a ich argumenty nie są obliczane. Liczniki zwiększane są
+ * atomowo bez wymuszania kolejności (ang. relaxed), więc mogą je zwiększać
+ * współbieżne zapytania.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "phone_forward.h"
+
+#ifdef PHFWD_STATS
+
+#include <time.h>
+
+/**
+ * Wyznacza czas w nanosekundach od ustalonej chwili. Używa funkcji
+ * standardu C11, więc nie wymaga rozszerzeń POSIX.
+ * @return Czas w nanosekundach.
+ */
+static inline uint64_t statsNow(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * Zwiększa przedział histogramu odpowiadający wartości.
+ * @param[in, out] histogram – tablica @ref PHFWD_HISTOGRAM_BUCKETS
+ *                             liczników;
+ * @param[in] value          – zliczana wartość.
+ */
+static inline void statsRecord(uint64_t *histogram, uint64_t value) {
+    unsigned int bucket = value == 0 ? 0 : 63 - __builtin_clzll(value);
+
+    if (bucket >= PHFWD_HISTOGRAM_BUCKETS)
+        bucket = PHFWD_HISTOGRAM_BUCKETS - 1;
+    __atomic_fetch_add(&histogram[bucket], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Zlicza w histogramie czas, który upłynął od danej chwili. Zegar może
+ * zostać cofnięty, więc ujemny czas traktowany jest jak zerowy.
+ * @param[in, out] histogram – tablica @ref PHFWD_HISTOGRAM_BUCKETS
+ *                             liczników;
+ * @param[in] start          – chwila rozpoczęcia w nanosekundach.
+ */
+static inline void statsRecordSince(uint64_t *histogram, uint64_t start) {
+    uint64_t end = statsNow();
+
+    statsRecord(histogram, end > start ? end - start : 0);
+}
+
+/**
+ * Zwiększa licznik @p field struktury liczników @p stats o @p value.
+ */
+#define STATS_ADD(stats, field, value) \
+    __atomic_fetch_add(&(stats)->field, (uint64_t) (value), __ATOMIC_RELAXED)
+
+/**
+ * Zlicza wartość @p value w histogramie @p field struktury liczników
+ * @p stats.
+ */
+#define STATS_RECORD(stats, field, value) \
+    statsRecord((stats)->field, (uint64_t) (value))
+
+/**
+ * Zapamiętuje w zmiennej @p timer chwilę rozpoczęcia operacji.
+ */
+#define STATS_TIMER_START(timer) uint64_t timer = statsNow()
+
+/**
+ * Zlicza w histogramie czasu operacji @p operation czas, który upłynął od
+ * chwili zapamiętanej w zmiennej @p timer.
+ */
+#define STATS_TIMER_STOP(stats, operation, timer) \
+    statsRecordSince((stats)->latency[operation], (timer))
+
+#else
+
+/** Pusta wersja makra zwiększającego licznik. */
+#define STATS_ADD(stats, field, value) ((void) 0)
+
+/** Pusta wersja makra zliczającego wartość w histogramie. */
+#define STATS_RECORD(stats, field, value) ((void) 0)
+
+/** Pusta wersja makra zapamiętującego chwilę rozpoczęcia operacji. */
+#define STATS_TIMER_START(timer) ((void) 0)
+
+/** Pusta wersja makra zliczającego czas operacji. */
+#define STATS_TIMER_STOP(stats, operation, timer) ((void) 0)
+
+#endif /* PHFWD_STATS */
+
+#endif /* STATS_H */
@@ -0,0 +1,308 @@
+/** @file
+ * Implementacja klasy implementującej pulę pamięci dla napisów i innych
+ * bloków o zmiennym rozmiarze.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "string_pool.h"
+#include "pool.h"
+
+/**
+ * Rozmiar (w bajtach) obiektów najmniejszej klasy rozmiarów. Obiekty każdej
+ * kolejnej klasy są dwa razy większe.
+ */
+#define STRING_POOL_MIN_SIZE 16
+
+/**
+ * Liczba klas rozmiarów. Napisy i bloki nie mieszczące się w obiektach
+ * największej klasy przydzielane są funkcją malloc.
+ */
+#define STRING_POOL_CLASSES 8
+
+/**
+ * Nagłówek długiego napisu lub bloku przydzielonego funkcją malloc. Długie
+ * napisy i bloki tworzą listę dwukierunkową, dzięki czemu można je zwolnić
+ * wraz z pulą.
+ */
+typedef struct LargeString {
+    struct LargeString *prev; ///< poprzedni długi napis lub NULL
+    struct LargeString *next; ///< następny długi napis lub NULL
+} LargeString;
+
+/**
+ * Nagłówek bloku przydzielonego funkcją @ref stringPoolAlloc. Zajmuje
+ * 8 bajtów, więc blok zachowuje wyrównanie obiektu, w którym się znajduje.
+ */
+typedef struct BlockHeader {
+    _Alignas(8) PoolIndex index; /**< indeks obiektu, w którym znajduje się
+                                 blok (nieużywany dla długich bloków) */
+} BlockHeader;
+
+/**
+ * Struktura reprezentująca pulę napisów. Każdy krótki napis poprzedzony jest
+ * indeksem obiektu, w którym się znajduje, a klasę rozmiaru obiektu można
+ * wyznaczyć na podstawie długości napisu.
+ */
+struct StringPool {
+    Pool *classes[STRING_POOL_CLASSES]; /**< pule obiektów kolejnych klas
+                                        rozmiarów, tworzone przy pierwszym
+                                        użyciu */
+    LargeString *large; ///< pierwszy element listy długich napisów lub NULL
+    size_t largeBytes; ///< łączny rozmiar bloków długich napisów
+};
+
+/**
+ * Wyznacza klasę rozmiaru obiektu o danej liczbie bajtów.
+ * @param[in] bytes – wymagany rozmiar obiektu.
+ * @return Numer najmniejszej klasy, której obiekty mają co najmniej
+ *         @p bytes bajtów, lub @ref STRING_POOL_CLASSES, jeśli takiej nie
+ *         ma.
+ */
+static unsigned int byteClass(size_t bytes) {
+    size_t size = STRING_POOL_MIN_SIZE;
+    unsigned int result = 0;
+
+    while (result < STRING_POOL_CLASSES && size < bytes) {
+        size *= 2;
+        ++result;
+    }
+
+    return result;
+}
+
+/**
+ * Wyznacza klasę rozmiaru obiektu, w którym mieści się napis.
+ * @param[in] length – długość napisu.
+ * @return Numer najmniejszej klasy, której obiekty mieszczą napis wraz
+ *         z indeksem i kończącym znakiem '\0', lub @ref STRING_POOL_CLASSES,
+ *         jeśli napis jest długi.
+ */
+static unsigned int sizeClass(size_t length) {
+    return byteClass(sizeof(PoolIndex) + length + 1);
+}
+
+/**
+ * Wyznacza klasę rozmiaru obiektu, w którym mieści się blok.
+ * @param[in] size – rozmiar bloku.
+ * @return Numer najmniejszej klasy, której obiekty mieszczą blok wraz
+ *         z nagłówkiem, lub @ref STRING_POOL_CLASSES, jeśli blok jest
+ *         długi.
+ */
+static unsigned int blockClass(size_t size) {
+    if (size > SIZE_MAX - sizeof(BlockHeader))
+        return STRING_POOL_CLASSES;
+    return byteClass(sizeof(BlockHeader) + size);
+}
+
+StringPool *stringPoolNew(void) {
+    StringPool *newStruct = malloc(sizeof(struct StringPool));
+
+    if (newStruct != NULL) {
+        for (unsigned int i = 0; i < STRING_POOL_CLASSES; ++i)
+            newStruct->classes[i] = NULL;
+        newStruct->large = NULL;
+        newStruct->largeBytes = 0;
+    }
+
+    return newStruct;
+}
+
+void stringPoolDelete(StringPool *pool) {
+    if (pool == NULL)
+        return;
+
+    for (unsigned int i = 0; i < STRING_POOL_CLASSES; ++i)
+        poolDelete(pool->classes[i]);
+
+    while (pool->large != NULL) {
+        LargeString *next = pool->large->next;
+        free(pool->large);
+        pool->large = next;
+    }
+
+    free(pool);
+}
+
+/**
+ * Przydziela obiekt danej klasy rozmiaru, w razie potrzeby tworząc pulę
+ * obiektów tej klasy.
+ * @param[in, out] pool – wskaźnik na pulę napisów;
+ * @param[in] class     – klasa rozmiaru mniejsza niż
+ *                        @ref STRING_POOL_CLASSES;
+ * @param[out] index    – wskaźnik na indeks przydzielonego obiektu.
+ * @return Wskaźnik na obiekt lub NULL, jeśli nie udało się alokować
+ *         pamięci.
+ */
+static void *allocObject(StringPool *pool, unsigned int class,
+                         PoolIndex *index) {
+    if (pool->classes[class] == NULL) {
+        pool->classes[class] = poolNew((size_t) STRING_POOL_MIN_SIZE << class);
+        if (pool->classes[class] == NULL)
+            return NULL;
+    }
+
+    *index = poolAlloc(pool->classes[class]);
+    if (*index == POOL_NULL)
+        return NULL;
+
+    return poolGet(pool->classes[class], *index);
+}
+
+/**
+ * Przydziela funkcją malloc długi napis lub blok i dołącza go do listy
+ * długich napisów.
+ * @param[in, out] pool – wskaźnik na pulę napisów;
+ * @param[in] bytes     – rozmiar obiektu bez nagłówka listy.
+ * @return Wskaźnik na obiekt lub NULL, jeśli nie udało się alokować
+ *         pamięci.
+ */
+static void *allocLarge(StringPool *pool, size_t bytes) {
+    if (bytes > SIZE_MAX - sizeof(LargeString))
+        return NULL;
+
+    LargeString *header = malloc(sizeof(LargeString) + bytes);
+    if (header == NULL)
+        return NULL;
+
+    header->prev = NULL;
+    header->next = pool->large;
+    if (pool->large != NULL)
+        pool->large->prev = header;
+    pool->large = header;
+    pool->largeBytes += sizeof(LargeString) + bytes;
+    return header + 1;
+}
+
+/**
+ * Odłącza od listy długich napisów i zwalnia obiekt przydzielony funkcją
+ * @ref allocLarge.
+ * @param[in, out] pool – wskaźnik na pulę napisów;
+ * @param[in] object    – wskaźnik na obiekt;
+ * @param[in] bytes     – rozmiar obiektu bez nagłówka listy.
+ */
+static void freeLarge(StringPool *pool, void *object, size_t bytes) {
+    LargeString *header = (LargeString *) object - 1;
+
+    if (header->prev != NULL)
+        header->prev->next = header->next;
+    else
+        pool->large = header->next;
+    if (header->next != NULL)
+        header->next->prev = header->prev;
+    pool->largeBytes -= sizeof(LargeString) + bytes;
+    free(header);
+}
+
+char *stringPoolCopy(StringPool *pool, char const *str, size_t length) {
+    unsigned int class = sizeClass(length);
+    char *result;
+
+    if (class < STRING_POOL_CLASSES) {
+        PoolIndex index;
+        char *object = allocObject(pool, class, &index);
+        if (object == NULL)
+            return NULL;
+
+        memcpy(object, &index, sizeof(PoolIndex));
+        result = object + sizeof(PoolIndex);
+    } else {
+        if (length == SIZE_MAX)
+            return NULL;
+
+        result = allocLarge(pool, length + 1);
+        if (result == NULL)
+            return NULL;
+    }
+
+    memcpy(result, str, length);
+    result[length] = '\0';
+    return result;
+}
+
+void stringPoolFree(StringPool *pool, char *str) {
+    if (str == NULL)
+        return;
+
+    size_t length = strlen(str);
+    unsigned int class = sizeClass(length);
+
+    if (class < STRING_POOL_CLASSES) {
+        PoolIndex index;
+        memcpy(&index, str - sizeof(PoolIndex), sizeof(PoolIndex));
+        poolFree(pool->classes[class], index);
+    } else {
+        freeLarge(pool, str, length + 1);
+    }
+}
+
+void *stringPoolAlloc(StringPool *pool, size_t size) {
+    unsigned int class = blockClass(size);
+    BlockHeader *header;
+
+    if (class < STRING_POOL_CLASSES) {
+        PoolIndex index;
+        header = allocObject(pool, class, &index);
+        if (header == NULL)
+            return NULL;
+
+        header->index = index;
+    } else {
+        if (size > SIZE_MAX - sizeof(BlockHeader))
+            return NULL;
+
+        header = allocLarge(pool, sizeof(BlockHeader) + size);
+        if (header == NULL)
+            return NULL;
+
+        header->index = POOL_NULL;
+    }
+
+    return header + 1;
+}
+
+void stringPoolRelease(StringPool *pool, void *block, size_t size) {
+    if (block == NULL)
+        return;
+
+    BlockHeader *header = (BlockHeader *) block - 1;
+    unsigned int class = blockClass(size);
+
+    if (class < STRING_POOL_CLASSES)
+        poolFree(pool->classes[class], header->index);
+    else
+        freeLarge(pool, header, sizeof(BlockHeader) + size);
+}
+
+size_t stringPoolFootprint(size_t length) {
+    unsigned int class = sizeClass(length);
+
+    if (class < STRING_POOL_CLASSES)
+        return (size_t) STRING_POOL_MIN_SIZE << class;
+
+    return sizeof(LargeString) + length + 1;
+}
+
+size_t stringPoolBlockFootprint(size_t size) {
+    unsigned int class = blockClass(size);
+
+    if (class < STRING_POOL_CLASSES)
+        return (size_t) STRING_POOL_MIN_SIZE << class;
+
+    return sizeof(LargeString) + sizeof(BlockHeader) + size;
+}
+
+size_t stringPoolReservedBytes(StringPool const *pool) {
+    size_t result = sizeof(struct StringPool) + pool->largeBytes;
+
+    for (unsigned int i = 0; i < STRING_POOL_CLASSES; ++i)
+        result += poolReservedBytes(pool->classes[i]);
+
+    return result;
+}
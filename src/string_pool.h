@@ -0,0 +1,105 @@
+/** @file
+ * Interfejs klasy implementującej pulę pamięci dla napisów i innych bloków
+ * o zmiennym rozmiarze.
+ *
+ * @author Cezary Botta <cb439922@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <stddef.h>
+
+/**
+ * Struktura reprezentująca pulę pamięci dla napisów. Krótkie napisy
+ * przydzielane są z pul obiektów o stałych rozmiarach (kolejnych potęgach
+ * dwójki), a długie bezpośrednio funkcją malloc. Z tych samych pul można
+ * przydzielać bloki pamięci o dowolnym rozmiarze. Wszystkie napisy i bloki
+ * zwalniane są wraz z usunięciem puli.
+ */
+struct StringPool;
+
+/**
+ * Typ @p StringPool reprezentuje strukturę @p StringPool.
+ */
+typedef struct StringPool StringPool;
+
+/**
+ * Tworzy nową, pustą pulę napisów.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, jeśli nie udało się
+ *         alokować pamięci.
+ */
+StringPool *stringPoolNew(void);
+
+/** @brief Usuwa pulę napisów.
+ * Usuwa pulę @p pool wraz ze wszystkimi przydzielonymi z niej napisami. Nic
+ * nie robi, jeśli wskaźnik @p pool ma wartość NULL.
+ * @param[in] pool – wskaźnik na usuwaną pulę.
+ */
+void stringPoolDelete(StringPool *pool);
+
+/**
+ * Tworzy w puli @p pool kopię napisu @p str o długości @p length.
+ * @param[in, out] pool – wskaźnik na pulę napisów;
+ * @param[in] str       – wskaźnik na kopiowany napis;
+ * @param[in] length    – długość napisu (bez kończącego znaku '\0').
+ * @return Wskaźnik na kopię napisu lub NULL, jeśli nie udało się alokować
+ *         pamięci.
+ */
+char *stringPoolCopy(StringPool *pool, char const *str, size_t length);
+
+/**
+ * Zwraca do puli @p pool napis @p str. Nic nie robi, jeśli wskaźnik @p str
+ * ma wartość NULL.
+ * @param[in, out] pool – wskaźnik na pulę napisów;
+ * @param[in] str       – wskaźnik na napis przydzielony z puli @p pool.
+ */
+void stringPoolFree(StringPool *pool, char *str);
+
+/**
+ * Wyznacza rozmiar pamięci zajmowanej przez kopię napisu o danej długości
+ * utworzoną funkcją @ref stringPoolCopy (wraz z nagłówkiem i zaokrągleniem
+ * do rozmiaru obiektu klasy).
+ * @param[in] length – długość napisu (bez kończącego znaku '\0').
+ * @return Rozmiar pamięci w bajtach.
+ */
+size_t stringPoolFootprint(size_t length);
+
+/**
+ * Przydziela z puli @p pool blok pamięci wyrównany do 8 bajtów.
+ * @param[in, out] pool – wskaźnik na pulę napisów;
+ * @param[in] size      – rozmiar bloku w bajtach.
+ * @return Wskaźnik na blok lub NULL, jeśli nie udało się alokować pamięci.
+ */
+void *stringPoolAlloc(StringPool *pool, size_t size);
+
+/**
+ * Zwraca do puli @p pool blok pamięci. Nic nie robi, jeśli wskaźnik
+ * @p block ma wartość NULL.
+ * @param[in, out] pool – wskaźnik na pulę napisów;
+ * @param[in] block     – wskaźnik na blok przydzielony z puli @p pool;
+ * @param[in] size      – rozmiar bloku przekazany do funkcji
+ *                        @ref stringPoolAlloc.
+ */
+void stringPoolRelease(StringPool *pool, void *block, size_t size);
+
+/**
+ * Wyznacza rozmiar pamięci zajmowanej przez blok o danym rozmiarze
+ * przydzielony funkcją @ref stringPoolAlloc (wraz z nagłówkiem
+ * i zaokrągleniem do rozmiaru obiektu klasy).
+ * @param[in] size – rozmiar bloku w bajtach.
+ * @return Rozmiar pamięci w bajtach.
+ */
+size_t stringPoolBlockFootprint(size_t size);
+
+/**
+ * Wyznacza rozmiar pamięci zajmowanej przez pulę @p pool: jej strukturę,
+ * płyty pul obiektów wszystkich klas rozmiarów oraz długie napisy i bloki.
+ * @param[in] pool – wskaźnik na pulę napisów.
+ * @return Rozmiar pamięci w bajtach.
+ */
+size_t stringPoolReservedBytes(StringPool const *pool);
+
+#endif /* STRING_POOL_H */
@@ -8,317 +8,1620 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "trie.h"
-#include "list.h"
+#include "source_array.h"
 #include "number_functions.h"
 
 /**
- * Struktura reprezentująca węzeł drzewa trie poza wskaźnikami do
- * przechowywanych danych i synów zawiera również wskaźnik do ojca.
+ * Maksymalna liczba cyfr etykiety krawędzi prowadzącej do węzła drzewa.
+ * Drzewo jest skompresowane (drzewo Patricia): jeden węzeł odpowiada
+ * ciągowi do @ref TRIE_LABEL_CAPACITY cyfr, a węzły tworzone są tylko tam,
+ * gdzie drzewo się rozgałęzia, gdzie przechowywane są dane lub gdzie
+ * etykieta nie mieściłaby się w węźle. Wartość 1 odpowiada zwykłemu drzewu
+ * trie z jednym węzłem na cyfrę, więc implementację można wybrać przy
+ * kompilacji, definiując tę stałą.
+ */
+#ifndef TRIE_LABEL_CAPACITY
+#define TRIE_LABEL_CAPACITY 7
+#endif
+
+#if TRIE_LABEL_CAPACITY < 1 || TRIE_LABEL_CAPACITY > 7
+#error "TRIE_LABEL_CAPACITY musi należeć do przedziału od 1 do 7"
+#endif
+
+/**
+ * Liczba zejść w drzewie przeplatanych przez funkcję
+ * @ref trieFindLongestBatch. Powinna być na tyle duża, aby w czasie
+ * oczekiwania na pobranie węzła z pamięci można było wykonać kroki
+ * pozostałych zejść.
+ */
+#define TRIE_BATCH_WIDTH 16
+
+/**
+ * Struktura reprezentująca węzeł drzewa trie poza danymi i indeksami synów
+ * zawiera również indeks ojca oraz etykietę krawędzi prowadzącej od ojca.
+ * Odwołania do innych węzłów są 32-bitowymi indeksami w puli pamięci, a dane
+ * węzła zależą od rodzaju drzewa i zajmują wspólne 8 bajtów, dzięki czemu
+ * węzeł zajmuje dokładnie jedną 64-bajtową linię pamięci podręcznej (płyty
+ * puli są odpowiednio wyrównane).
  */
 struct TrieNode {
-    TrieNode *fwdNode; /**< Wskaźnik na węzeł drzewa. W drzewie przekierowań
-                       wskazuje na węzeł drzewa odwrotności przekierowań, na
-                       które dany węzeł jest przekierowany (lub NULL, jeśli
-                       węzeł przekierowany nie jest), a w drzewie odwrotności
-                       przekierowań jest równy NULL */
-    ListNode *listNode; /**< Wskaźnik na węzeł listy. W drzewie odwrotności
-                        przekierowań wskazuje na początek listy węzłów, które
-                        zostały przekierowane na dany węzeł, a w drzewie
-                        przekierowań wskazuje na element listy w węźle @p
-                        fwdNode, który przechowuje wskaźnik na dany węzeł */
-
-    TrieNode *children[12]; /**< wskaźniki do synów węzła drzewa odpowiadające
-                            odpowiednim cyfrom, jeśli dany syn nie istnieje,
-                            to odpowiedni wskaźnik wynosi NULL */
-    TrieNode *parent; /**< wskaźnik na ojca węzła drzewa,
-                      NULL w przypadku korzenia */
+    _Alignas(64) PoolIndex children[12]; /**< indeksy synów węzła drzewa
+                                         odpowiadające odpowiednim cyfrom,
+                                         jeśli dany syn nie istnieje, to
+                                         odpowiedni indeks wynosi
+                                         @ref POOL_NULL */
+    PoolIndex parent; /**< indeks ojca węzła drzewa,
+                      @ref POOL_NULL w przypadku korzenia */
+    uint32_t label; /**< etykieta krawędzi prowadzącej od ojca do węzła:
+                    najmłodsze 4 bity przechowują liczbę cyfr etykiety,
+                    a kolejne czwórki bitów wartości kolejnych cyfr;
+                    pierwsza cyfra etykiety wyznacza syna ojca, którym
+                    jest węzeł, a etykieta korzenia jest pusta */
+    /** dane węzła; są zerowe wtedy i tylko wtedy, gdy węzeł jest pusty */
+    union {
+        /** dane węzła drzewa przekierowań */
+        struct {
+            PoolIndex fwdNode; /**< indeks węzła drzewa odwrotności
+                               przekierowań, na który dany węzeł jest
+                               przekierowany, lub @ref POOL_NULL, jeśli
+                               węzeł przekierowany nie jest */
+            uint32_t slot; /**< indeks elementu tablicy w węźle
+                           @p fwdNode, który przechowuje indeks danego
+                           węzła (0, jeśli węzeł nie jest przekierowany) */
+        };
+        /** tablica numerów przekierowanych na numer węzła drzewa
+            odwrotności przekierowań lub NULL */
+        SourceArray *sources;
+        uint64_t data; ///< wszystkie dane węzła naraz
+    };
 };
 
-TrieNode *trieNew(void) {
-    TrieNode *newStruct = malloc(sizeof(struct TrieNode));
+_Static_assert(sizeof(struct TrieNode) == 64,
+               "węzeł drzewa powinien zajmować jedną linię pamięci podręcznej");
+
+/**
+ * Rodzaj zmiany drzew zapisanej w dzienniku.
+ */
+typedef enum JournalKind {
+    JOURNAL_NODE, ///< dodanie nowego liścia
+    JOURNAL_SPLIT, ///< rozdzielenie krawędzi nowym węzłem pośrednim
+    JOURNAL_DATA, ///< zmiana przekierowania węzła drzewa przekierowań
+    JOURNAL_DETACH ///< odłączenie poddrzewa drzewa przekierowań
+} JournalKind;
+
+/**
+ * Dziennik jest stosem zmian drzew, które można wycofać w odwrotnej
+ * kolejności bez alokowania pamięci. Każda modyfikacja rezerwuje miejsce na
+ * swoje wpisy, zanim cokolwiek zmieni. Poza transakcją dziennik zawiera
+ * jedynie węzły utworzone przez trwającą modyfikację, które usuwa się, gdy
+ * nie powiedzie się jej dalsza część. W trakcie transakcji zawiera również
+ * zmiany przekierowań i odłączenia poddrzew, a żadna operacja nie zwalnia
+ * węzłów, więc indeksy zapisane w dzienniku pozostają ważne, a wycofanie
+ * zmian w odwrotnej kolejności przywraca dokładnie poprzedni kształt drzew.
+ * Razem z miejscem na wpis rezerwowane jest miejsce na wszystkie obiekty,
+ * które może zwolnić jego wycofanie lub zatwierdzenie (zob.
+ * @ref epochReserve), więc również ich odroczenie nie alokuje pamięci.
+ */
+struct JournalEntry {
+    PoolIndex node; ///< węzeł, którego dotyczy zmiana
+    PoolIndex other; /**< dla @ref JOURNAL_DATA węzeł drzewa odwrotności
+                     przekierowań, na który węzeł @p node był wcześniej
+                     przekierowany, lub @ref POOL_NULL, a dla
+                     @ref JOURNAL_DETACH ojciec odłączonego węzła */
+    union {
+        char *sourceCopy; /**< dla @ref JOURNAL_DATA kopia numeru, dla
+                          której zarezerwowano miejsce w tablicy numerów
+                          węzła @p other, lub NULL */
+        size_t depth; /**< dla @ref JOURNAL_DETACH długość numeru ojca
+                      wyznaczana przy zatwierdzaniu transakcji */
+    };
+    size_t retires; /**< łączna liczba obiektów, które może zwolnić
+                    wycofanie lub zatwierdzenie tego wpisu i wpisów
+                    wcześniejszych */
+    JournalKind kind; ///< rodzaj zmiany
+    TrieKind tree; ///< rodzaj drzewa, do którego należy węzeł @p node
+};
+
+/**
+ * Wyznacza adres węzła drzewa o danym indeksie.
+ * @param[in] ctx   – wskaźnik na pule pamięci;
+ * @param[in] index – indeks węzła różny od @ref POOL_NULL.
+ * @return Wskaźnik na węzeł drzewa.
+ */
+static inline TrieNode *nodeAt(TrieContext const *ctx, PoolIndex index) {
+    return poolGet(ctx->nodePool, index);
+}
+
+/**
+ * Odczytuje indeks syna węzła. Pola węzła mogą być równocześnie zmieniane
+ * przez pisarza, więc współbieżni czytelnicy odczytują każde z nich
+ * niepodzielnie i tylko raz. Odczyt ma semantykę nabycia, więc czytelnik
+ * widzi zawartość syna zapisaną przed jego dołączeniem do węzła.
+ * @param[in] node  – wskaźnik na węzeł drzewa;
+ * @param[in] digit – cyfra odpowiadająca synowi.
+ * @return Indeks syna lub @ref POOL_NULL, jeśli syn nie istnieje.
+ */
+static inline PoolIndex childAt(TrieNode const *node, unsigned int digit) {
+    return __atomic_load_n(&node->children[digit], __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Odczytuje indeks ojca węzła (zob. @ref childAt).
+ * @param[in] node – wskaźnik na węzeł drzewa.
+ * @return Indeks ojca lub @ref POOL_NULL.
+ */
+static inline PoolIndex parentOf(TrieNode const *node) {
+    return __atomic_load_n(&node->parent, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Odczytuje etykietę krawędzi prowadzącej do węzła (zob. @ref childAt).
+ * @param[in] node – wskaźnik na węzeł drzewa.
+ * @return Etykieta węzła.
+ */
+static inline uint32_t labelOf(TrieNode const *node) {
+    return __atomic_load_n(&node->label, __ATOMIC_RELAXED);
+}
+
+/**
+ * Ustawia ojca węzła. Zapis ma semantykę zwolnienia, więc współbieżny
+ * czytelnik, który przejdzie do nowego ojca, zobaczy jego zawartość.
+ * @param[in, out] node – wskaźnik na węzeł drzewa;
+ * @param[in] parent    – indeks ojca lub @ref POOL_NULL.
+ */
+static inline void setParent(TrieNode *node, PoolIndex parent) {
+    __atomic_store_n(&node->parent, parent, __ATOMIC_RELEASE);
+}
+
+/**
+ * Ustawia etykietę krawędzi prowadzącej do węzła.
+ * @param[in, out] node – wskaźnik na węzeł drzewa;
+ * @param[in] label     – etykieta.
+ */
+static inline void setLabel(TrieNode *node, uint32_t label) {
+    __atomic_store_n(&node->label, label, __ATOMIC_RELAXED);
+}
+
+/**
+ * Ustawia indeks elementu tablicy numerów odpowiadającego przekierowanemu
+ * węzłowi drzewa przekierowań. Indeks nie jest odczytywany przez
+ * czytelników, ale należy do danych węzła sprawdzanych przez
+ * @ref isEmpty.
+ * @param[in, out] node – wskaźnik na węzeł drzewa;
+ * @param[in] slot      – indeks elementu.
+ */
+static inline void setSlot(TrieNode *node, uint32_t slot) {
+    __atomic_store_n(&node->slot, slot, __ATOMIC_RELAXED);
+}
+
+/**
+ * Wyznacza fragment etykiety.
+ * @param[in] label – etykieta;
+ * @param[in] from  – numer pierwszej cyfry fragmentu;
+ * @param[in] to    – numer cyfry następującej po ostatniej cyfrze fragmentu.
+ * @return Etykieta złożona z cyfr @p label o numerach od @p from do
+ *         @p to - 1.
+ */
+static inline uint32_t labelSlice(uint32_t label, unsigned int from,
+                                  unsigned int to) {
+    uint32_t digits = (label >> 4) >> (4 * from);
+    uint32_t mask = ((uint32_t) 1 << (4 * (to - from))) - 1;
+
+    return ((digits & mask) << 4) | (to - from);
+}
+
+/**
+ * Skleja dwie etykiety, których łączna długość nie przekracza
+ * @ref TRIE_LABEL_CAPACITY.
+ * @param[in] first  – pierwsza etykieta;
+ * @param[in] second – druga etykieta.
+ * @return Etykieta złożona z cyfr @p first, po których następują cyfry
+ *         @p second.
+ */
+static inline uint32_t labelConcat(uint32_t first, uint32_t second) {
+    unsigned int firstLength = labelLength(first);
+
+    return (first & ~(uint32_t) 0xF) |
+           ((second >> 4) << (4 + 4 * firstLength)) |
+           (firstLength + labelLength(second));
+}
+
+/**
+ * Tworzy etykietę złożoną z początkowych cyfr numeru.
+ * @param[in] num    – wskaźnik na napis reprezentujący numer;
+ * @param[in] length – liczba cyfr etykiety, nie większa niż długość @p num
+ *                     i niż @ref TRIE_LABEL_CAPACITY.
+ * @return Etykieta złożona z @p length pierwszych cyfr @p num.
+ */
+static uint32_t labelFromNumber(char const *num, unsigned int length) {
+    uint32_t label = length;
 
-    if (newStruct != NULL) {
-        newStruct->fwdNode = NULL;
-        newStruct->listNode = NULL;
+    for (unsigned int k = 0; k < length; ++k)
+        label |= (uint32_t) charToDigit(num[k]) << (4 + 4 * k);
+
+    return label;
+}
+
+bool trieContextInit(TrieContext *ctx) {
+    ctx->nodePool = poolNew(sizeof(struct TrieNode));
+    if (ctx->nodePool == NULL)
+        return false;
+
+    ctx->stringPool = stringPoolNew();
+    if (ctx->stringPool == NULL) {
+        poolDelete(ctx->nodePool);
+        return false;
+    }
+
+    ctx->epoch = NULL;
+    memset(ctx->shape, 0, sizeof(ctx->shape));
+    ctx->strings = 0;
+    ctx->stringBytes = 0;
+    ctx->arrayBytes = 0;
+    ctx->lengthCounts = NULL;
+    ctx->lengthCountsSize = 0;
+    ctx->longestArray = 0;
+    ctx->detached = NULL;
+    ctx->detachedCount = 0;
+    ctx->detachedSize = 0;
+    memset(ctx->detachedGroups, 0, sizeof(ctx->detachedGroups));
+    ctx->reclaimCursor = POOL_NULL;
+    ctx->journal = NULL;
+    ctx->journalCount = 0;
+    ctx->journalSize = 0;
+    ctx->transaction = false;
+
+    return true;
+}
+
+void trieContextDestroy(TrieContext *ctx) {
+    epochDelete(ctx->epoch);
+    poolDelete(ctx->nodePool);
+    stringPoolDelete(ctx->stringPool);
+    free(ctx->lengthCounts);
+    free(ctx->detached);
+    free(ctx->journal);
+}
+
+/**
+ * Wypełnia część raportu o pamięci dotyczącą jednego drzewa.
+ * @param[in] shape    – wskaźnik na rozmiar i kształt drzewa;
+ * @param[in] nodeSize – rozmiar węzła drzewa w bajtach;
+ * @param[out] usage   – wskaźnik na wypełnianą część raportu.
+ */
+static void treeUsage(TrieShape const *shape, size_t nodeSize,
+                      PhfwdTreeUsage *usage) {
+    // korzeń jest pusty, ale nie jest węzłem pośrednim
+    size_t passThrough = shape->nodes - shape->dataNodes - 1;
+
+    usage->nodes.count = shape->nodes;
+    usage->nodes.bytes = shape->nodes * nodeSize;
+    usage->passThrough.count = passThrough;
+    usage->passThrough.bytes = passThrough * nodeSize;
+    memcpy(usage->fanOut, shape->fanOut, sizeof(usage->fanOut));
+    memcpy(usage->depth, shape->depth, sizeof(usage->depth));
+}
+
+void trieMemoryUsage(TrieContext const *ctx, PhfwdMemoryReport *report) {
+    // każde przekierowanie ma dokładnie jeden element tablicy, a jego węzeł
+    // w drzewie przekierowań jest niepusty
+    size_t entries = ctx->shape[TRIE_FORWARD].dataNodes;
+
+    treeUsage(&ctx->shape[TRIE_FORWARD], ctx->nodePool->objectSize,
+              &report->forward);
+    treeUsage(&ctx->shape[TRIE_REVERSE], ctx->nodePool->objectSize,
+              &report->reverse);
+    report->sourceEntries.count = entries;
+    report->sourceEntries.bytes = ctx->arrayBytes;
+    report->strings.count = ctx->strings;
+    report->strings.bytes = ctx->stringBytes;
+    report->longestReverseList = ctx->longestArray;
+    report->reservedBytes = poolReservedBytes(ctx->nodePool) +
+                            stringPoolReservedBytes(ctx->stringPool) +
+                            ctx->lengthCountsSize * sizeof(size_t) +
+                            ctx->detachedSize * sizeof(DetachedRoot) +
+                            ctx->journalSize * sizeof(JournalEntry);
+}
+
+/**
+ * Wyznacza liczbę synów węzła.
+ * @param[in] node – wskaźnik na węzeł drzewa.
+ * @return Liczba synów węzła @p node.
+ */
+static unsigned int childCount(TrieNode const *node) {
+    unsigned int result = 0;
+
+    for (unsigned int i = 0; i < 12; ++i)
+        if (node->children[i] != POOL_NULL)
+            ++result;
+
+    return result;
+}
+
+PoolIndex trieNew(TrieContext *ctx, TrieKind kind) {
+    PoolIndex newIndex = poolAlloc(ctx->nodePool);
+
+    if (newIndex != POOL_NULL) {
+        TrieNode *newStruct = nodeAt(ctx, newIndex);
+        STATS_ADD(ctx->stats, nodesAllocated, 1);
+        ++ctx->shape[kind].nodes;
+        ++ctx->shape[kind].fanOut[0];
+
+        newStruct->data = 0;
 
         for (unsigned int i = 0; i < 12; ++i)
-            newStruct->children[i] = NULL;
-        newStruct->parent = NULL;
+            newStruct->children[i] = POOL_NULL;
+        newStruct->parent = POOL_NULL;
+        newStruct->label = 0;
     }
 
-    return newStruct;
+    return newIndex;
+}
+
+/**
+ * Zwraca obiekt do puli. Funkcja typu @ref EpochReclaim.
+ * @param[in, out] pool – wskaźnik na pulę;
+ * @param[in] index     – indeks obiektu.
+ */
+static void reclaimPoolObject(void *pool, uintptr_t index) {
+    poolFree(pool, (PoolIndex) index);
+}
+
+/**
+ * Zwraca napis do puli napisów. Funkcja typu @ref EpochReclaim.
+ * @param[in, out] stringPool – wskaźnik na pulę napisów;
+ * @param[in] string          – adres napisu.
+ */
+static void reclaimString(void *stringPool, uintptr_t string) {
+    stringPoolFree(stringPool, (char *) string);
+}
+
+/**
+ * Zwraca tablicę numerów do puli napisów. Funkcja typu @ref EpochReclaim.
+ * @param[in, out] stringPool – wskaźnik na pulę napisów;
+ * @param[in] array           – adres tablicy.
+ */
+static void reclaimSourceArray(void *stringPool, uintptr_t array) {
+    sourceArrayDelete(stringPool, (SourceArray *) array);
+}
+
+/**
+ * Zwalnia węzeł drzewa odłączony od drzewa (z ewentualnym odroczeniem).
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] kind     – rodzaj drzewa, do którego należał węzeł;
+ * @param[in] node     – indeks węzła.
+ */
+static void retireNode(TrieContext *ctx, TrieKind kind, PoolIndex node) {
+    STATS_ADD(ctx->stats, nodesFreed, 1);
+    --ctx->shape[kind].nodes;
+    --ctx->shape[kind].fanOut[childCount(nodeAt(ctx, node))];
+    epochRetire(ctx->epoch, reclaimPoolObject, ctx->nodePool, node);
+}
+
+/**
+ * Zwalnia napis, do którego nie prowadzi już żaden element tablicy
+ * (z ewentualnym odroczeniem).
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] string   – wskaźnik na napis.
+ */
+static void retireString(TrieContext *ctx, char *string) {
+    epochRetire(ctx->epoch, reclaimString, ctx->stringPool,
+                (uintptr_t) string);
+}
+
+/**
+ * Zwalnia tablicę numerów, która została zastąpiona lub odłączona od węzła
+ * (z ewentualnym odroczeniem).
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] array    – wskaźnik na tablicę.
+ */
+static void retireSourceArray(TrieContext *ctx, SourceArray *array) {
+    ctx->arrayBytes -= sourceArrayBytes(array);
+    epochRetire(ctx->epoch, reclaimSourceArray, ctx->stringPool,
+                (uintptr_t) array);
+}
+
+/**
+ * Przenosi element tablicy numerów odpowiadający węzłowi drzewa przekierowań
+ * między elementy liści lub węzłów mających synów (zob.
+ * @ref sourceArraySetLeaf), poprawiając indeksy elementów zapisane
+ * w węzłach.
+ * @param[in, out] ctx   – wskaźnik na pule pamięci;
+ * @param[in, out] array – wskaźnik na tablicę numerów zawierającą element
+ *                         węzła @p node;
+ * @param[in, out] node  – wskaźnik na przekierowany węzeł drzewa
+ *                         przekierowań;
+ * @param[in] leaf       – wartość @p true, jeśli element ma trafić między
+ *                         elementy liści.
+ */
+static void setSourceLeaf(TrieContext *ctx, SourceArray *array,
+                          TrieNode *node, bool leaf) {
+    uint32_t slot = node->slot;
+    uint32_t newSlot = slot;
+    PoolIndex moved = sourceArraySetLeaf(array, &newSlot, leaf);
+
+    setSlot(node, newSlot);
+    if (moved != POOL_NULL)
+        setSlot(nodeAt(ctx, moved), slot);
+}
+
+/**
+ * Ustawia syna węzła drzewa. Zapis ma semantykę zwolnienia, więc
+ * współbieżny czytelnik, który zobaczy nowego syna, zobaczy również jego
+ * zawartość. Jeśli przekierowany węzeł drzewa przekierowań zyskuje
+ * pierwszego syna lub traci ostatniego, to przenosi jego element tablicy
+ * numerów.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] kind     – rodzaj drzewa, do którego należy węzeł;
+ * @param[in] node     – indeks węzła;
+ * @param[in] digit    – cyfra odpowiadająca synowi;
+ * @param[in] child    – indeks syna lub @ref POOL_NULL.
+ */
+static void setChild(TrieContext *ctx, TrieKind kind, PoolIndex node,
+                     unsigned int digit, PoolIndex child) {
+    TrieNode *current = nodeAt(ctx, node);
+
+    // liczba synów zmienia się tylko wtedy, gdy syn pojawia się lub znika
+    if ((current->children[digit] == POOL_NULL) != (child == POOL_NULL)) {
+        size_t *fanOut = ctx->shape[kind].fanOut;
+        unsigned int count = childCount(current);
+
+        --fanOut[count];
+        ++fanOut[child == POOL_NULL ? count - 1 : count + 1];
+
+        if (kind == TRIE_FORWARD && current->fwdNode != POOL_NULL &&
+            count == (child == POOL_NULL ? 1 : 0))
+            setSourceLeaf(ctx, nodeAt(ctx, current->fwdNode)->sources,
+                          current, child == POOL_NULL);
+    }
+
+    __atomic_store_n(&current->children[digit], child, __ATOMIC_RELEASE);
 }
 
 /** @brief Sprawdza, czy węzeł jest pusty.
  * Sprawdza, czy węzeł @p node nie został przekierowany lub czy nie został
  * na niego przekierowany inny węzeł.
- * @param[in] node – wskaźnik na węzeł drzewa
- * @return Wartość @p true, jeśli węzeł @p num jest pusty lub jest równy NULL.
+ * @param[in] ctx  – wskaźnik na pule pamięci;
+ * @param[in] node – indeks węzła drzewa
+ * @return Wartość @p true, jeśli węzeł @p num jest pusty lub jest równy
+ *         @ref POOL_NULL.
  *         Wartość @p false, jeśli węzeł @p num jest korzeniem drzewa lub
  *         nie jest pusty.
  */
-static bool isEmpty(TrieNode *node) {
-    if (node == NULL)
+static bool isEmpty(TrieContext const *ctx, PoolIndex node) {
+    if (node == POOL_NULL)
         return true;
-    if (node->parent == NULL)
+
+    TrieNode const *current = nodeAt(ctx, node);
+    if (__atomic_load_n(&current->parent, __ATOMIC_RELAXED) == POOL_NULL)
         return false;
-    return node->fwdNode == NULL && node->listNode == NULL;
+    return __atomic_load_n(&current->data, __ATOMIC_RELAXED) == 0;
+}
+
+/**
+ * Wyznacza jedynego syna węzła.
+ * @param[in] node – wskaźnik na węzeł drzewa.
+ * @return Indeks jedynego syna węzła @p node lub @ref POOL_NULL, jeśli węzeł
+ *         nie ma synów lub ma ich więcej niż jednego.
+ */
+static PoolIndex onlyChild(TrieNode const *node) {
+    PoolIndex result = POOL_NULL;
+
+    for (unsigned int i = 0; i < 12; ++i) {
+        if (node->children[i] != POOL_NULL) {
+            if (result != POOL_NULL)
+                return POOL_NULL;
+            result = node->children[i];
+        }
+    }
+
+    return result;
 }
 
-void deleteDeadBranch(TrieNode *node) {
+/**
+ * Sprawdza, czy węzeł jest liściem.
+ * @param[in] node – wskaźnik na węzeł drzewa.
+ * @return Wartość @p true, jeśli węzeł @p node nie ma synów.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+static bool isLeaf(TrieNode const *node) {
     for (unsigned int i = 0; i < 12; ++i)
-        if (node->children[i] != NULL)
-            return;
+        if (node->children[i] != POOL_NULL)
+            return false;
 
-    TrieNode *current = node;
-    bool isLeaf = true;
+    return true;
+}
 
-    while (isEmpty(current) && isLeaf) {
-        TrieNode *currentParent = current->parent;
+/** @brief Scala pusty węzeł z jego jedynym synem.
+ * Jeśli węzeł @p node jest pusty, ma dokładnie jednego syna, a łączna
+ * długość ich etykiet nie przekracza @ref TRIE_LABEL_CAPACITY, to usuwa
+ * @p node, przedłużając etykietę syna. Syn zachowuje swój indeks, więc
+ * odwołania do niego pozostają ważne.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] kind     – rodzaj drzewa, do którego należy @p node;
+ * @param[in] node     – indeks węzła drzewa.
+ */
+static void mergeWithChild(TrieContext *ctx, TrieKind kind, PoolIndex node) {
+    if (!isEmpty(ctx, node))
+        return;
 
-        for (unsigned int i = 0; i < 12; ++i) {
-            if (currentParent->children[i] == current)
-                currentParent->children[i] = NULL;
-            else if (currentParent->children[i] != NULL)
-                isLeaf = false;
-        }
+    TrieNode *current = nodeAt(ctx, node);
+    PoolIndex child = onlyChild(current);
+    if (child == POOL_NULL)
+        return;
+
+    TrieNode *childNode = nodeAt(ctx, child);
+    if (labelLength(current->label) + labelLength(childNode->label) >
+        TRIE_LABEL_CAPACITY)
+        return;
 
-        free(current);
+    setLabel(childNode, labelConcat(current->label, childNode->label));
+    setParent(childNode, current->parent);
+    setChild(ctx, kind, current->parent, labelDigit(current->label, 0),
+             child);
+    retireNode(ctx, kind, node);
+}
+
+void deleteDeadBranch(TrieContext *ctx, TrieKind kind, PoolIndex node) {
+    PoolIndex current = node;
+
+    while (isEmpty(ctx, current) && isLeaf(nodeAt(ctx, current))) {
+        TrieNode *currentNode = nodeAt(ctx, current);
+        PoolIndex currentParent = currentNode->parent;
+
+        setChild(ctx, kind, currentParent, labelDigit(currentNode->label, 0),
+                 POOL_NULL);
+        retireNode(ctx, kind, current);
         current = currentParent;
     }
+
+    // pierwszy nieusunięty węzeł mógł stać się zbędnym węzłem pośrednim
+    mergeWithChild(ctx, kind, current);
+}
+
+/**
+ * Wyznacza liczbę obiektów, które może zwolnić wycofanie lub zatwierdzenie
+ * wpisów dziennika sprzed danego punktu.
+ * @param[in] ctx  – wskaźnik na pule pamięci;
+ * @param[in] mark – punkt dziennika.
+ * @return Liczba obiektów.
+ */
+static size_t journalRetires(TrieContext const *ctx, size_t mark) {
+    return mark == 0 ? 0 : ctx->journal[mark - 1].retires;
+}
+
+/**
+ * Zapewnia miejsce na kolejne wpisy dziennika i na obiekty, które może
+ * zwolnić ich wycofanie lub zatwierdzenie.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] count    – liczba wpisów;
+ * @param[in] retires  – liczba obiektów, które może zwolnić wycofanie lub
+ *                       zatwierdzenie tych wpisów.
+ * @return Wartość @p true, jeśli w dzienniku jest miejsce na @p count
+ *         wpisów.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool reserveJournal(TrieContext *ctx, size_t count, size_t retires) {
+    if (!epochReserve(ctx->epoch,
+                      journalRetires(ctx, ctx->journalCount) + retires))
+        return false;
+
+    if (ctx->journalSize - ctx->journalCount >= count)
+        return true;
+
+    size_t size = ctx->journalSize == 0 ? 16 : ctx->journalSize;
+    while (size - ctx->journalCount < count) {
+        if (size > SIZE_MAX / 2 / sizeof(JournalEntry))
+            return false;
+        size *= 2;
+    }
+
+    JournalEntry *journal = realloc(ctx->journal,
+                                    size * sizeof(JournalEntry));
+    if (journal == NULL)
+        return false;
+
+    ctx->journal = journal;
+    ctx->journalSize = size;
+    return true;
+}
+
+/**
+ * Zapisuje zmianę drzew w miejscu zarezerwowanym funkcją
+ * @ref reserveJournal.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] kind     – rodzaj zmiany;
+ * @param[in] tree     – rodzaj drzewa, do którego należy @p node;
+ * @param[in] node     – indeks węzła, którego dotyczy zmiana;
+ * @param[in] other    – indeks drugiego węzła (zob. @ref JournalEntry);
+ * @param[in] retires  – liczba obiektów, które może zwolnić wycofanie lub
+ *                       zatwierdzenie zmiany, uwzględniona w rezerwacji.
+ * @return Wskaźnik na zapisany wpis.
+ */
+static JournalEntry *journalPush(TrieContext *ctx, JournalKind kind,
+                                 TrieKind tree, PoolIndex node,
+                                 PoolIndex other, size_t retires) {
+    size_t previous = journalRetires(ctx, ctx->journalCount);
+    JournalEntry *entry = &ctx->journal[ctx->journalCount++];
+
+    entry->node = node;
+    entry->other = other;
+    entry->sourceCopy = NULL;
+    entry->retires = previous + retires;
+    entry->kind = kind;
+    entry->tree = tree;
+    return entry;
+}
+
+/**
+ * Rozdziela krawędź prowadzącą do węzła, tworząc nowy węzeł pośredni.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] kind     – rodzaj drzewa, do którego należy @p node;
+ * @param[in] node     – indeks węzła drzewa różnego od korzenia;
+ * @param[in] length   – liczba cyfr etykiety @p node, które mają trafić do
+ *                       nowego węzła, dodatnia i mniejsza niż długość
+ *                       etykiety.
+ * @return Indeks nowego węzła, będącego ojcem @p node, lub @ref POOL_NULL,
+ *         jeśli nie udało się alokować pamięci (wówczas drzewo nie zostaje
+ *         zmienione).
+ */
+static PoolIndex splitEdge(TrieContext *ctx, TrieKind kind, PoolIndex node,
+                           unsigned int length) {
+    PoolIndex middle = trieNew(ctx, kind);
+    if (middle == POOL_NULL)
+        return POOL_NULL;
+
+    TrieNode *current = nodeAt(ctx, node);
+    TrieNode *middleNode = nodeAt(ctx, middle);
+    uint32_t label = current->label;
+    unsigned int labelLen = labelLength(label);
+
+    setLabel(middleNode, labelSlice(label, 0, length));
+    setParent(middleNode, current->parent);
+    setChild(ctx, kind, middle, labelDigit(label, length), node);
+    setChild(ctx, kind, current->parent, labelDigit(label, 0), middle);
+
+    setLabel(current, labelSlice(label, length, labelLen));
+    setParent(current, middle);
+
+    return middle;
 }
 
-TrieNode *trieAdd(TrieNode *t, char const *num) {
-    TrieNode *current = t;
+PoolIndex trieAdd(TrieContext *ctx, TrieKind kind, PoolIndex t,
+                  char const *num) {
+    // dodanie numeru rozdziela co najwyżej jedną krawędź i tworzy gałąź
+    // węzłów o pełnych etykietach, więc miejsce w dzienniku rezerwujemy
+    // przed zmianą drzewa; wycofanie każdego wpisu zwalnia jeden węzeł
+    size_t length = strlen(num);
+    size_t entries = 1 + (length + TRIE_LABEL_CAPACITY - 1) /
+                         TRIE_LABEL_CAPACITY;
+    if (!reserveJournal(ctx, entries, entries))
+        return POOL_NULL;
+
+    size_t mark = ctx->journalCount;
+    PoolIndex current = t;
+    TrieNode const *currentNode = nodeAt(ctx, t);
+    PoolSlabHint hint;
     size_t i = 0;
 
-    // znajdujemy najdłuższy prefiks num w drzewie
-    while (num[i] != '\0' && current->children[charToDigit(num[i])] != NULL) {
-        current = current->children[charToDigit(num[i])];
+    // znajdujemy najdłuższy prefiks num w drzewie; węzły ścieżki zwykle
+    // leżą w jednej płycie puli, więc nie wyszukujemy jej dla każdego z nich
+    poolHintInit(&hint);
+    while (num[i] != '\0') {
+        PoolIndex child = currentNode->children[charToDigit(num[i])];
+        if (child == POOL_NULL)
+            break;
+
+        TrieNode const *childNode = poolGetNear(ctx->nodePool, &hint, child,
+                                                sizeof(TrieNode));
+        uint32_t label = childNode->label;
+        unsigned int labelLen = labelLength(label);
+
+        // pierwsza cyfra etykiety wyznaczyła syna, więc porównujemy jedynie
+        // dłuższe etykiety; jeśli numer odchodzi od etykiety w jej środku,
+        // to rozdzielamy krawędź, tak aby prefiks numeru odpowiadał węzłowi
+        if (labelLen > 1) {
+            unsigned int matched = labelMatch(label, num + i);
+
+            if (matched < labelLen) {
+                child = splitEdge(ctx, kind, child, matched);
+                if (child == POOL_NULL)
+                    return POOL_NULL;
+
+                journalPush(ctx, JOURNAL_SPLIT, kind, child, POOL_NULL, 1);
+                current = child;
+                i += matched;
+                break;
+            }
+
+            i += labelLen - 1;
+        }
+
+        // przesunięcie o pierwszą cyfrę nie zależy od odczytanej etykiety,
+        // więc przy etykietach jednocyfrowych wybór kolejnego syna nie czeka
+        // na jej odczyt i porównanie
+        current = child;
+        currentNode = childNode;
         ++i;
     }
 
-    // jeśli w drzewie jest cały numer, to zwracamy wskaźnik na odpowiedni
-    // węzeł drzewa
+    // jeśli w drzewie jest cały numer, to zwracamy indeks odpowiedniego
+    // węzła drzewa
     if (num[i] == '\0')
         return current;
 
     while (num[i] != '\0') {
-        TrieNode *newNode = trieNew();
+        PoolIndex newNode = trieNew(ctx, kind);
 
-        // gdy zabraknie pamięci usuwamy dodane węzły
-        if (newNode == NULL) {
-            deleteDeadBranch(current);
-            return NULL;
+        // gdy zabraknie pamięci usuwamy dodane węzły (i scalamy ewentualnie
+        // rozdzieloną krawędź)
+        if (newNode == POOL_NULL) {
+            trieJournalUndo(ctx, mark);
+            return POOL_NULL;
         }
 
-        current->children[charToDigit(num[i])] = newNode;
-        newNode->parent = current;
+        unsigned int labelLen = 0;
+        while (labelLen < TRIE_LABEL_CAPACITY && num[i + labelLen] != '\0')
+            ++labelLen;
+
+        setParent(nodeAt(ctx, newNode), current);
+        setLabel(nodeAt(ctx, newNode), labelFromNumber(num + i, labelLen));
+        setChild(ctx, kind, current, charToDigit(num[i]), newNode);
+        journalPush(ctx, JOURNAL_NODE, kind, newNode, POOL_NULL, 1);
         current = newNode;
-        ++i;
+        i += labelLen;
     }
 
     return current;
 }
 
-void deleteFwdData(TrieNode *node) {
-    if (node->fwdNode == NULL)
+PoolIndex trieAddNear(TrieContext *ctx, TrieKind kind, PoolIndex t,
+                      PoolIndex hint, char const *hintNum, char const *num) {
+    if (hint == POOL_NULL)
+        return trieAdd(ctx, kind, t, num);
+
+    size_t common = 0;
+    while (hintNum[common] != '\0' && hintNum[common] == num[common])
+        ++common;
+
+    // wspinamy się od węzła hint do najgłębszego jego przodka, któremu
+    // odpowiada prefiks obu numerów
+    PoolIndex start = hint;
+    size_t depth = strlen(hintNum);
+    while (depth > common) {
+        TrieNode const *current = nodeAt(ctx, start);
+
+        depth -= labelLength(current->label);
+        start = current->parent;
+    }
+
+    return trieAdd(ctx, kind, start, num + depth);
+}
+
+/**
+ * Uwzględnia w kształcie drzewa dodanie lub usunięcie danych niepustego
+ * węzła.
+ * @param[in, out] shape – wskaźnik na rozmiar i kształt drzewa;
+ * @param[in] length     – długość numeru odpowiadającego węzłowi;
+ * @param[in] added      – wartość @p true, jeśli węzeł stał się niepusty,
+ *                         lub @p false, jeśli stał się pusty.
+ */
+static void countDataNode(TrieShape *shape, size_t length, bool added) {
+    size_t bucket = length < PHFWD_DEPTH_BUCKETS ? length
+                                                 : PHFWD_DEPTH_BUCKETS - 1;
+
+    if (added) {
+        ++shape->dataNodes;
+        ++shape->depth[bucket];
+    } else {
+        --shape->dataNodes;
+        --shape->depth[bucket];
+    }
+}
+
+/**
+ * Uwzględnia dodanie lub usunięcie napisu przechowywanego w tablicach.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] length   – długość napisu;
+ * @param[in] added    – wartość @p true, jeśli napis został dodany, lub
+ *                       @p false, jeśli został usunięty.
+ */
+static void countString(TrieContext *ctx, size_t length, bool added) {
+    if (added) {
+        ++ctx->strings;
+        ctx->stringBytes += stringPoolFootprint(length);
+    } else {
+        --ctx->strings;
+        ctx->stringBytes -= stringPoolFootprint(length);
+    }
+}
+
+/**
+ * Zapewnia, że tablica liczb tablic numerów o danych długościach ma
+ * element odpowiadający długości @p length.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] length   – długość tablicy numerów.
+ * @return Wartość @p true, jeśli tablica ma taki element.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool reserveLengthCount(TrieContext *ctx, size_t length) {
+    if (length < ctx->lengthCountsSize)
+        return true;
+
+    // długości tablic rosną o jeden, więc wystarczy podwoić tablicę
+    size_t size = ctx->lengthCountsSize == 0 ? 16 : 2 * ctx->lengthCountsSize;
+    if (size > SIZE_MAX / sizeof(size_t))
+        return false;
+
+    size_t *counts = realloc(ctx->lengthCounts, size * sizeof(size_t));
+    if (counts == NULL)
+        return false;
+
+    memset(counts + ctx->lengthCountsSize, 0,
+           (size - ctx->lengthCountsSize) * sizeof(size_t));
+    ctx->lengthCounts = counts;
+    ctx->lengthCountsSize = size;
+    return true;
+}
+
+/** @brief Uwzględnia zmianę długości tablicy numerów.
+ * Uwzględnia zmianę długości jednej z tablic numerów z @p from na @p to,
+ * różniące się o jeden (długość 0 oznacza pustą tablicę lub jej brak).
+ * Długości tablic zmieniają się o jeden, więc gdy znika ostatnia najdłuższa
+ * tablica, to najdłuższą staje się właśnie skrócona.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] from     – poprzednia długość tablicy;
+ * @param[in] to       – nowa długość tablicy, dla której zarezerwowano
+ *                       miejsce funkcją @ref reserveLengthCount.
+ */
+static void countArrayLength(TrieContext *ctx, size_t from, size_t to) {
+    if (from > 0)
+        --ctx->lengthCounts[from];
+    if (to > 0)
+        ++ctx->lengthCounts[to];
+
+    if (to > ctx->longestArray)
+        ctx->longestArray = to;
+    else if (from == ctx->longestArray && ctx->lengthCounts[from] == 0)
+        ctx->longestArray = to;
+}
+
+/**
+ * Usuwa tablicę numerów z węzła drzewa odwrotności przekierowań, jeśli nie
+ * ma ona już elementów ani zarezerwowanych miejsc. Nie usuwa nieużywanych
+ * węzłów drzewa.
+ * @param[in, out] ctx     – wskaźnik na pule pamięci;
+ * @param[in, out] reverse – wskaźnik na węzeł drzewa odwrotności
+ *                           przekierowań, który ma tablicę numerów.
+ */
+static void dropUnusedSources(TrieContext *ctx, TrieNode *reverse) {
+    SourceArray *array = reverse->sources;
+
+    if (!sourceArrayIsUnused(array))
         return;
 
-    if (node->fwdNode->listNode == node->listNode)
-        node->fwdNode->listNode = getNext(node->fwdNode->listNode);
+    countDataNode(&ctx->shape[TRIE_REVERSE],
+                  strlen(sourceArrayTarget(array)), false);
+    __atomic_store_n(&reverse->sources, NULL, __ATOMIC_RELEASE);
+    retireSourceArray(ctx, array);
+}
+
+void deleteFwdData(TrieContext *ctx, PoolIndex node) {
+    TrieNode *current = nodeAt(ctx, node);
+    PoolIndex reverse = current->fwdNode;
+
+    if (reverse == POOL_NULL)
+        return;
 
-    listRemove(node->listNode);
-    deleteDeadBranch(node->fwdNode);
+    TrieNode *reverseNode = nodeAt(ctx, reverse);
+    SourceArray *array = reverseNode->sources;
+    size_t length = sourceArrayLength(array);
+
+    // element węzła mającego synów (również węzła zwalnianego z odłączonego
+    // poddrzewa, którego tablica synów się nie zmienia) przenosimy najpierw
+    // między elementy liści
+    if (!sourceArrayIsLeaf(array, current->slot))
+        setSourceLeaf(ctx, array, current, true);
+
+    uint32_t slot = current->slot;
+    char *source = sourceArraySource(array, slot);
+
+    // najpierw odłączamy węzeł od tablicy, a dopiero potem zwalniamy napis;
+    // na miejsce usuniętego elementu trafia ostatni, więc poprawiamy indeks
+    // przechowywany w jego węźle
+    __atomic_store_n(&current->data, 0, __ATOMIC_RELAXED);
+    PoolIndex moved = sourceArrayRemove(array, slot);
+    if (moved != POOL_NULL)
+        setSlot(nodeAt(ctx, moved), slot);
+    countArrayLength(ctx, length, length - 1);
+
+    size_t sourceLength = strlen(source);
+    countDataNode(&ctx->shape[TRIE_FORWARD], sourceLength, false);
+    countString(ctx, sourceLength, false);
+    retireString(ctx, source);
+
+    // w trakcie transakcji węzły nie są usuwane, bo mogą do nich prowadzić
+    // wpisy dziennika; nieużywane węzły usuwa zatwierdzenie transakcji
+    dropUnusedSources(ctx, reverseNode);
+    if (!ctx->transaction)
+        deleteDeadBranch(ctx, TRIE_REVERSE, reverse);
 }
 
 /**
  * Usuwanie poddrzewa zaimplementowane zostało iteracyjnie w celu uniknięcia
- * przepełnienia stosu przy przechowywaniu długich numerów. Używamy przy tym
- * następującego algorytmu: przemieszczamy się od korzenia poddrzewa do
- * pierwszego syna aż nie dojdziemy do węzła, który pierwszego syna nie ma.
- * Wówczas ustawiamy jako jego pierwszego syna drugiego syna korzenia
- * i powtarzamy tę procedurę, tworząc dowiązania do kolejnych synów korzenia.
- * W momencie, w którym mamy dowiązania do wszystkich synów korzenia możemy
- * usunąć korzeń i ustawić jego pierwszego syna (w już potencjalnie
- * zmodyfikowanym drzewie) jako nowy korzeń. W ten sposób otrzymaliśmy drzewo
- * o jednym węźle mniej, więc powtarzając tę procedurę w końcu usuniemy całe
- * poddrzewo.
- */
-void trieDelete(TrieNode *node) {
-    TrieNode *root = node;
-    TrieNode *current = root;
-
-    while (root != NULL) {
-        while (current->children[0] != NULL)
-            current = current->children[0];
-
-        for (unsigned int i = 1; i < 12; ++i) {
-            current->children[0] = root->children[i];
-            while (current->children[0] != NULL)
-                current = current->children[0];
+ * przepełnienia stosu przy przechowywaniu długich numerów. Poddrzewo
+ * obchodzimy w porządku postorder, wracając do ojca po wskaźnikach parent.
+ * Tablice synów usuwanych węzłów nie są zmieniane, więc liczba synów
+ * każdego z nich jest zgodna z histogramem kształtu drzewa, a współbieżny
+ * czytelnik przechodzi po niezmienionym poddrzewie.
+ */
+void trieDelete(TrieContext *ctx, PoolIndex node) {
+    PoolIndex current = node;
+    unsigned int next = 0;
+
+    for (;;) {
+        TrieNode const *currentNode = nodeAt(ctx, current);
+
+        while (next < 12 && currentNode->children[next] == POOL_NULL)
+            ++next;
+
+        if (next < 12) {
+            current = currentNode->children[next];
+            next = 0;
+            continue;
         }
 
-        TrieNode *tmp = root;
-        root = root->children[0];
-        deleteFwdData(tmp);
-        free(tmp);
+        // ojca i cyfrę odczytujemy przed zwolnieniem węzła
+        PoolIndex parent = currentNode->parent;
+        unsigned int digit = labelDigit(currentNode->label, 0);
+
+        deleteFwdData(ctx, current);
+        retireNode(ctx, TRIE_FORWARD, current);
+        if (current == node)
+            return;
+
+        current = parent;
+        next = digit + 1;
     }
 }
 
-TrieNode *trieFind(TrieNode *t, char const *num) {
-    TrieNode *current = t;
+PoolIndex trieFind(TrieContext const *ctx, PoolIndex t, char const *num) {
+    PoolIndex current = t;
     size_t i = 0;
 
     while (num[i] != '\0') {
-        if (current == NULL)
-            return NULL;
+        current = nodeAt(ctx, current)->children[charToDigit(num[i])];
+        if (current == POOL_NULL)
+            return POOL_NULL;
 
-        current = current->children[charToDigit(num[i])];
-        ++i;
+        uint32_t label = nodeAt(ctx, current)->label;
+        unsigned int matched = labelMatch(label, num + i);
+
+        // numer może kończyć się w środku etykiety, ale nie może od niej
+        // odchodzić
+        if (matched < labelLength(label) && num[i + matched] != '\0')
+            return POOL_NULL;
+
+        i += matched;
     }
 
     return current;
 }
 
-TrieNode *trieFindNextNonEmpty(TrieNode *node, char const *num,
-                               size_t *currIndex) {
-    if (num[*currIndex] == '\0')
-        return NULL;
+PoolIndex trieFindNextNonEmpty(TrieContext const *ctx, PoolIndex node,
+                               char const *num, size_t *currIndex) {
+    size_t i = *currIndex;
+    PoolIndex current = node;
+    PoolIndex result = POOL_NULL;
+    size_t visited = 0;
 
-    size_t originalIndex = *currIndex;
+    while (num[i] != '\0') {
+        current = childAt(nodeAt(ctx, current), charToDigit(num[i]));
+        if (current == POOL_NULL)
+            break;
+
+        ++visited;
+        uint32_t label = labelOf(nodeAt(ctx, current));
+        unsigned int length = labelLength(label);
+        if (labelMatch(label, num + i) < length)
+            break;
+
+        i += length;
+        if (!isEmpty(ctx, current)) {
+            *currIndex = i;
+            result = current;
+            break;
+        }
+    }
 
-    TrieNode *current = node->children[charToDigit(num[*currIndex])];
-    ++(*currIndex);
+    STATS_ADD(ctx->stats, walks, 1);
+    STATS_ADD(ctx->stats, walkNodes, visited);
+    return result;
+}
 
-    while (num[*currIndex] != '\0' && current != NULL) {
-        if (!isEmpty(current)) {
-            return current;
-        }
+/**
+ * Stan jednego z zejść w drzewie przeplatanych przez funkcję
+ * @ref trieFindLongestBatch.
+ */
+typedef struct BatchDescent {
+    size_t query; ///< numer zapytania, którego dotyczy zejście
+    size_t position; /**< pozycja w numerze, od której zaczyna się etykieta
+                     krawędzi prowadzącej do węzła @p next */
+    PoolIndex next; /**< indeks kolejnego węzła zejścia, który został już
+                    zażądany z pamięci */
+} BatchDescent;
+
+/**
+ * Przechodzi do kolejnego węzła zejścia w drzewie i zleca pobranie
+ * z wyprzedzeniem węzła, który będzie potrzebny w następnym kroku.
+ * @param[in] ctx          – wskaźnik na pule pamięci;
+ * @param[in] num          – wskaźnik na napis reprezentujący numer;
+ * @param[in, out] descent – wskaźnik na stan zejścia;
+ * @param[out] node        – wskaźnik na indeks najgłębszego znalezionego
+ *                           niepustego węzła;
+ * @param[out] index       – wskaźnik na długość prefiksu odpowiadającego
+ *                           temu węzłowi.
+ * @return Wartość @p true, jeśli zejście nie zostało zakończone.
+ *         Wartość @p false, jeśli zejście zostało zakończone.
+ */
+static bool batchStep(TrieContext const *ctx, char const *num,
+                      BatchDescent *descent, PoolIndex *node, size_t *index) {
+    TrieNode const *current = nodeAt(ctx, descent->next);
+    uint32_t label = labelOf(current);
+    unsigned int length = labelLength(label);
+
+    if (labelMatch(label, num + descent->position) < length)
+        return false;
 
-        current = current->children[charToDigit(num[*currIndex])];
-        ++(*currIndex);
+    descent->position += length;
+    if (!isEmpty(ctx, descent->next)) {
+        *node = descent->next;
+        *index = descent->position;
     }
 
-    if (isEmpty(current)) {
-        *currIndex = originalIndex;
-        return NULL;
+    if (num[descent->position] == '\0')
+        return false;
+
+    descent->next = childAt(current, charToDigit(num[descent->position]));
+    if (descent->next == POOL_NULL)
+        return false;
+
+    __builtin_prefetch(nodeAt(ctx, descent->next));
+    return true;
+}
+
+void trieFindLongestBatch(TrieContext const *ctx, PoolIndex t,
+                          char const *const *nums, size_t count,
+                          PoolIndex *nodes, size_t *indices) {
+    BatchDescent active[TRIE_BATCH_WIDTH];
+    size_t activeCount = 0;
+    size_t nextQuery = 0;
+    TrieNode const *root = nodeAt(ctx, t);
+
+    while (activeCount > 0 || nextQuery < count) {
+        // uzupełniamy zbiór trwających zejść kolejnymi zapytaniami
+        while (activeCount < TRIE_BATCH_WIDTH && nextQuery < count) {
+            size_t k = nextQuery++;
+            nodes[k] = t;
+            indices[k] = 0;
+
+            PoolIndex child = childAt(root, charToDigit(nums[k][0]));
+            if (child != POOL_NULL) {
+                __builtin_prefetch(nodeAt(ctx, child));
+                active[activeCount].query = k;
+                active[activeCount].position = 0;
+                active[activeCount].next = child;
+                ++activeCount;
+            }
+        }
+
+        // wykonujemy po jednym kroku każdego zejścia, a zakończone
+        // zastępujemy ostatnim z trwających
+        size_t s = 0;
+        while (s < activeCount) {
+            size_t k = active[s].query;
+
+            if (batchStep(ctx, nums[k], &active[s], &nodes[k], &indices[k]))
+                ++s;
+            else
+                active[s] = active[--activeCount];
+        }
     }
-    return current;
 }
 
-void trieRemove(TrieNode *t, char const *num) {
-    TrieNode *nodeToDelete = trieFind(t, num);
+/**
+ * Zapewnia miejsce na stosie korzeni odłączonych poddrzew.
+ * @param[in, out] ctx – wskaźnik na pule pamięci.
+ * @return Wartość @p true, jeśli na stosie jest miejsce na kolejny korzeń.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool reserveDetached(TrieContext *ctx) {
+    size_t count = ctx->detachedCount;
 
-    if (nodeToDelete != NULL) {
-        TrieNode *parent = nodeToDelete->parent;
+    if (count == ctx->detachedSize) {
+        size_t size = count == 0 ? 16 : 2 * count;
+        if (size > SIZE_MAX / sizeof(DetachedRoot))
+            return false;
 
-        for (unsigned int i = 0; i < 12; ++i)
-            if (parent->children[i] == nodeToDelete)
-                parent->children[i] = NULL;
+        DetachedRoot *detached = realloc(ctx->detached,
+                                         size * sizeof(DetachedRoot));
+        if (detached == NULL)
+            return false;
 
-        trieDelete(nodeToDelete);
-        deleteDeadBranch(parent);
+        ctx->detached = detached;
+        ctx->detachedSize = size;
     }
+
+    return true;
 }
 
-bool addToReverseFwdList(TrieNode *node, TrieNode *nodeToAdd) {
-    return listAdd(&node->listNode, nodeToAdd);
+/**
+ * Wyznacza grupę odłączonych poddrzew, do której należy numer.
+ * @param[in] num – wskaźnik na napis reprezentujący niepusty numer.
+ * @return Indeks grupy wyznaczony przez pierwszą cyfrę numeru, jeśli numer
+ *         ma jedną cyfrę, lub przez jego pierwsze dwie cyfry.
+ */
+static uint32_t detachedGroup(char const *num) {
+    unsigned int first = charToDigit(num[0]);
+
+    if (num[1] == '\0')
+        return first;
+
+    return 12 + 12 * first + charToDigit(num[1]);
 }
 
-TrieNode *getFwdNode(TrieNode *node) {
-    return node->fwdNode;
+/**
+ * Zmienia liczbę odłączonych poddrzew w grupie.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] group    – indeks grupy;
+ * @param[in] delta    – zmiana liczby poddrzew (1 lub -1).
+ */
+static void addDetachedGroup(TrieContext *ctx, uint32_t group, int delta) {
+    __atomic_store_n(&ctx->detachedGroups[group],
+                     ctx->detachedGroups[group] + (uint32_t) delta,
+                     __ATOMIC_RELEASE);
 }
 
-void setFwdNode(TrieNode *node, TrieNode *nodeToAdd) {
-    node->fwdNode = nodeToAdd;
+/**
+ * Zapamiętuje korzeń odłączonego poddrzewa drzewa przekierowań, tak aby
+ * jego węzły zwolniła funkcja @ref trieReclaim, i oznacza go jako korzeń
+ * (odłączony węzeł nie ma ojca).
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] node     – indeks węzła odłączonego od ojca;
+ * @param[in] num      – wskaźnik na napis reprezentujący numer, który
+ *                       wyznaczył węzeł @p node.
+ * @return Wartość @p true, jeśli poddrzewo zostało zapamiętane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool pushDetached(TrieContext *ctx, PoolIndex node, char const *num) {
+    if (!reserveDetached(ctx))
+        return false;
+
+    // poddrzewo, którego zwalnianie trwa, pozostaje na szczycie stosu, bo
+    // wskazuje na nie reclaimCursor
+    size_t count = ctx->detachedCount;
+    DetachedRoot root = {.node = node, .group = detachedGroup(num)};
+    ctx->detached[count] = root;
+    if (ctx->reclaimCursor != POOL_NULL) {
+        ctx->detached[count] = ctx->detached[count - 1];
+        ctx->detached[count - 1] = root;
+    }
+
+    addDetachedGroup(ctx, root.group, 1);
+    setParent(nodeAt(ctx, node), POOL_NULL);
+    __atomic_store_n(&ctx->detachedCount, count + 1, __ATOMIC_RELEASE);
+    return true;
 }
 
-ListNode *getListNode(TrieNode *node) {
-    return node->listNode;
+/**
+ * Usuwa ze stosu korzeni odłączonych poddrzew korzeń zapamiętany jako
+ * ostatni (pod poddrzewem, którego zwalnianie trwa).
+ * @param[in, out] ctx – wskaźnik na pule pamięci.
+ */
+static void popDetached(TrieContext *ctx) {
+    size_t count = ctx->detachedCount;
+    size_t last = ctx->reclaimCursor != POOL_NULL ? count - 2 : count - 1;
+
+    addDetachedGroup(ctx, ctx->detached[last].group, -1);
+    ctx->detached[last] = ctx->detached[count - 1];
+    __atomic_store_n(&ctx->detachedCount, count - 1, __ATOMIC_RELEASE);
 }
 
-void setListNode(TrieNode *node, ListNode *nodeToAdd) {
-    node->listNode = nodeToAdd;
+bool trieRemove(TrieContext *ctx, PoolIndex t, char const *num) {
+    PoolIndex nodeToDelete = trieFind(ctx, t, num);
+
+    if (nodeToDelete == POOL_NULL)
+        return true;
+
+    TrieNode *node = nodeAt(ctx, nodeToDelete);
+    PoolIndex parent = node->parent;
+    unsigned int digit = labelDigit(node->label, 0);
+
+    // w trakcie transakcji odłączenie musi dać się wycofać, więc ojciec
+    // pozostaje w drzewie nawet wtedy, gdy stał się zbędny; zatwierdzenie
+    // usuwa go wraz ze zbędnymi przodkami, których jest mniej niż cyfr
+    // numeru, i scala co najwyżej jeden węzeł
+    if (ctx->transaction) {
+        size_t retires = strlen(num);
+        if (!reserveJournal(ctx, 1, retires) || !reserveDetached(ctx))
+            return false;
+
+        setChild(ctx, TRIE_FORWARD, parent, digit, POOL_NULL);
+        journalPush(ctx, JOURNAL_DETACH, TRIE_FORWARD, nodeToDelete, parent,
+                    retires);
+        pushDetached(ctx, nodeToDelete, num);
+        return true;
+    }
+
+    setChild(ctx, TRIE_FORWARD, parent, digit, POOL_NULL);
+
+    // pojedynczy węzeł zwalniamy od razu, a większe poddrzewo tylko
+    // odłączamy, aby usuwanie nie trwało proporcjonalnie do jego
+    // rozmiaru
+    if (isLeaf(node) || !pushDetached(ctx, nodeToDelete, num))
+        trieDelete(ctx, nodeToDelete);
+    deleteDeadBranch(ctx, TRIE_FORWARD, parent);
+    return true;
 }
 
 /**
- * Znajduje długość numeru odpowiadającego węzłowi drzewa.
+ * Wyznacza pierwszego syna węzła.
  * @param[in] node – wskaźnik na węzeł drzewa.
- * @return Długość numeru odpowiadającego węzłowi @p node.
+ * @return Indeks syna węzła @p node o najmniejszej cyfrze lub
+ *         @ref POOL_NULL, jeśli węzeł nie ma synów.
  */
-static size_t length(TrieNode *node) {
-    if (node == NULL)
-        return 0;
+static PoolIndex firstChild(TrieNode const *node) {
+    for (unsigned int i = 0; i < 12; ++i)
+        if (node->children[i] != POOL_NULL)
+            return node->children[i];
 
-    size_t result = 0;
+    return POOL_NULL;
+}
 
-    while (node->parent != NULL) {
-        ++result;
-        node = node->parent;
+bool trieReclaim(TrieContext *ctx, size_t budget) {
+    PoolIndex current = ctx->reclaimCursor;
+
+    if (ctx->transaction)
+        return ctx->detachedCount == 0;
+
+    // schodzimy do liścia, zwalniamy go i wracamy do ojca, który być może
+    // stał się liściem; odłączanie zwolnionych węzłów od ojców sprawia, że
+    // do wznowienia wystarczy zapamiętać jeden węzeł
+    for (size_t step = 0; step < budget && ctx->detachedCount > 0; ++step) {
+        epochWriteYield(ctx->epoch);
+
+        PoolIndex root = ctx->detached[ctx->detachedCount - 1].node;
+        if (current == POOL_NULL)
+            current = root;
+
+        TrieNode *currentNode = nodeAt(ctx, current);
+        PoolIndex child = firstChild(currentNode);
+        if (child != POOL_NULL) {
+            current = child;
+            continue;
+        }
+
+        PoolIndex parent = currentNode->parent;
+        deleteFwdData(ctx, current);
+        if (current == root) {
+            __atomic_store_n(&ctx->detachedCount, ctx->detachedCount - 1,
+                             __ATOMIC_RELEASE);
+            addDetachedGroup(ctx,
+                             ctx->detached[ctx->detachedCount].group, -1);
+        } else {
+            setChild(ctx, TRIE_FORWARD, parent,
+                     labelDigit(currentNode->label, 0), POOL_NULL);
+        }
+        retireNode(ctx, TRIE_FORWARD, current);
+
+        // ojciec korzenia ma wartość POOL_NULL
+        current = parent;
     }
 
-    return result;
+    ctx->reclaimCursor = current;
+    return ctx->detachedCount == 0;
 }
 
-/**
- * Odwraca prefiks numeru.
- * @param[in, out] num – wskaźnik na numer;
- * @param[in] index    – długość prefiksu do odwrócenia.
- */
-static void mirror(char *num, size_t index) {
-    if (index == 0)
-        return;
+bool trieHasDetached(TrieContext const *ctx) {
+    return __atomic_load_n(&ctx->detachedCount, __ATOMIC_ACQUIRE) > 0;
+}
+
+bool trieIsDetached(TrieContext const *ctx, PoolIndex t, PoolIndex node,
+                    char const *source) {
+    if (!trieHasDetached(ctx))
+        return false;
+
+    // numer poza grupami odłączonych poddrzew należy do drzewa t
+    uint32_t group = detachedGroup(source);
+    if (__atomic_load_n(&ctx->detachedGroups[charToDigit(source[0])],
+                        __ATOMIC_ACQUIRE) == 0 &&
+        (group < 12 ||
+         __atomic_load_n(&ctx->detachedGroups[group], __ATOMIC_ACQUIRE) == 0))
+        return false;
 
-    for (size_t i = 0; 2 * i < index - 1; ++i) {
-        char tmp = num[i];
-        num[i] = num[index - i - 1];
-        num[index - i - 1] = tmp;
+    // korzeń odłączonego poddrzewa nie ma ojca, tak jak korzeń drzewa
+    PoolIndex current = node;
+    PoolIndex parent = parentOf(nodeAt(ctx, current));
+    while (parent != POOL_NULL) {
+        current = parent;
+        parent = parentOf(nodeAt(ctx, current));
     }
+
+    return current != t;
 }
 
-char *changePrefix(char const *num, TrieNode *newPrefixNode,
-                   size_t index) {
-    char *result;
-    size_t numLength = index;
+bool trieIsLeaf(TrieContext const *ctx, PoolIndex node) {
+    return isLeaf(nodeAt(ctx, node));
+}
 
-    while (num[numLength] != '\0')
-        ++numLength;
+char *reserveReverseFwd(TrieContext *ctx, PoolIndex node,
+                        char const *source, char const *target) {
+    TrieNode *reverse = nodeAt(ctx, node);
+    SourceArray *array = reverse->sources;
+    size_t used = array == NULL ? 0 : sourceArrayUsed(array);
 
-    size_t newPrefLength = length(newPrefixNode);
+    // każde zarezerwowane miejsce może zostać zajęte, więc długość tablicy
+    // może osiągnąć liczbę jej elementów i rezerwacji
+    if (!reserveLengthCount(ctx, used + 1))
+        return NULL;
 
-    result = malloc((newPrefLength + numLength - index + 1) * sizeof(char));
+    char *sourceCopy = stringPoolCopy(ctx->stringPool, source,
+                                      strlen(source));
+    if (sourceCopy == NULL)
+        return NULL;
 
-    if (result == NULL)
+    if (array != NULL && sourceArrayReserve(array))
+        return sourceCopy;
+
+    // tablicę zastępujemy większą kopią, bo współbieżny czytelnik może
+    // właśnie przeglądać starą
+    size_t targetLength = array == NULL ? strlen(target) : 0;
+    SourceArray *newArray = array == NULL
+                            ? sourceArrayNew(ctx->stringPool, target,
+                                             targetLength, 1)
+                            : sourceArrayGrow(ctx->stringPool, array);
+    if (newArray == NULL) {
+        stringPoolFree(ctx->stringPool, sourceCopy);
         return NULL;
+    }
 
-    size_t i = 0;
-    if (newPrefLength > 0) {
-        TrieNode *current = newPrefixNode;
+    sourceArrayReserve(newArray);
+    ctx->arrayBytes += sourceArrayBytes(newArray);
+    __atomic_store_n(&reverse->sources, newArray, __ATOMIC_RELEASE);
 
-        while (i < newPrefLength) {
-            TrieNode *parent = current->parent;
+    if (array == NULL)
+        countDataNode(&ctx->shape[TRIE_REVERSE], targetLength, true);
+    else
+        retireSourceArray(ctx, array);
 
-            for (unsigned int j = 0; j < 12; ++j) {
-                if (parent->children[j] == current)
-                    result[i] = digitToChar(j);
-            }
+    return sourceCopy;
+}
+
+void cancelReverseFwd(TrieContext *ctx, PoolIndex node, char *sourceCopy) {
+    TrieNode *reverse = nodeAt(ctx, node);
+
+    // kopia numeru nie była jeszcze widoczna dla czytelników
+    stringPoolFree(ctx->stringPool, sourceCopy);
+    sourceArrayCancel(reverse->sources);
+    dropUnusedSources(ctx, reverse);
+}
+
+void setFwdData(TrieContext *ctx, PoolIndex node, PoolIndex reverse,
+                char *sourceCopy) {
+    deleteFwdData(ctx, node);
+
+    TrieNode *current = nodeAt(ctx, node);
+    SourceArray *array = nodeAt(ctx, reverse)->sources;
+    size_t length = sourceArrayLength(array);
+    size_t sourceLength = strlen(sourceCopy);
+
+    // indeks węzła drzewa odwrotności przekierowań zapisujemy na końcu, bo
+    // to on czyni węzeł niepustym dla współbieżnego czytelnika
+    setSlot(current, sourceArrayPush(array, node, sourceCopy));
+    if (!isLeaf(current))
+        setSourceLeaf(ctx, array, current, false);
+    __atomic_store_n(&current->fwdNode, reverse, __ATOMIC_RELEASE);
+
+    countArrayLength(ctx, length, length + 1);
+    countDataNode(&ctx->shape[TRIE_FORWARD], sourceLength, true);
+    countString(ctx, sourceLength, true);
+}
+
+bool trieJournalFwdData(TrieContext *ctx, PoolIndex node,
+                        char const *source) {
+    if (!ctx->transaction)
+        return true;
+
+    PoolIndex previous = nodeAt(ctx, node)->fwdNode;
+    char const *target = previous == POOL_NULL
+                         ? NULL
+                         : sourceArrayTarget(nodeAt(ctx, previous)->sources);
 
-            current = parent;
-            ++i;
+    // wycofanie zwalnia napis i tablicę numerów, a zatwierdzenie – tablicę
+    // numerów oraz pustą gałąź drzewa odwrotności przekierowań, której węzłów
+    // jest nie więcej niż cyfr numeru, i co najwyżej jeden scalony węzeł
+    size_t retires = target == NULL ? 2 : strlen(target) + 2;
+    if (!reserveJournal(ctx, 1, retires))
+        return false;
+
+    char *sourceCopy = NULL;
+    if (target != NULL) {
+        sourceCopy = reserveReverseFwd(ctx, previous, source, target);
+        if (sourceCopy == NULL)
+            return false;
+    }
+
+    journalPush(ctx, JOURNAL_DATA, TRIE_FORWARD, node, previous,
+                retires)->sourceCopy = sourceCopy;
+    return true;
+}
+
+size_t trieJournalMark(TrieContext const *ctx) {
+    return ctx->journalCount;
+}
+
+void trieJournalUndo(TrieContext *ctx, size_t mark) {
+    // miejsca zarezerwowane dla wycofywanych wpisów zwalniamy przed
+    // wycofaniem, aby odroczenia mogły je zająć
+    epochReserve(ctx->epoch, journalRetires(ctx, mark));
+
+    while (ctx->journalCount > mark) {
+        // każdy wpis wycofujemy w całości, więc pomiędzy wpisami drzewa są
+        // spójne (choć czytelnik może zobaczyć częściowo wycofane zmiany)
+        epochWriteYield(ctx->epoch);
+
+        JournalEntry const *entry = &ctx->journal[--ctx->journalCount];
+        TrieNode *node = nodeAt(ctx, entry->node);
+
+        // późniejsze zmiany zostały już wycofane, więc każdy węzeł ma taki
+        // kształt jak tuż po zapisanej zmianie
+        switch (entry->kind) {
+        case JOURNAL_NODE:
+            setChild(ctx, entry->tree, node->parent,
+                     labelDigit(node->label, 0), POOL_NULL);
+            retireNode(ctx, entry->tree, entry->node);
+            break;
+        case JOURNAL_SPLIT:
+            mergeWithChild(ctx, entry->tree, entry->node);
+            break;
+        case JOURNAL_DATA:
+            if (entry->other == POOL_NULL)
+                deleteFwdData(ctx, entry->node);
+            else
+                setFwdData(ctx, entry->node, entry->other, entry->sourceCopy);
+            break;
+        case JOURNAL_DETACH:
+            popDetached(ctx);
+            setParent(node, entry->other);
+            setChild(ctx, TRIE_FORWARD, entry->other,
+                     labelDigit(node->label, 0), entry->node);
+            break;
         }
+    }
+}
 
-        // dodawaliśmy kolejne znaki do wyniku w odwrotnej kolejności,
-        // więc odwracamy ten fragment wyniku
-        mirror(result, newPrefLength);
+void trieJournalRelease(TrieContext *ctx, size_t mark) {
+    if (!ctx->transaction) {
+        ctx->journalCount = mark;
+        epochReserve(ctx->epoch, journalRetires(ctx, mark));
     }
+}
 
-    while (i < newPrefLength + numLength - index + 1) {
-        result[i] = num[i - newPrefLength + index];
-        ++i;
+void trieBegin(TrieContext *ctx) {
+    ctx->transaction = true;
+}
+
+/**
+ * Wyznacza długość numeru odpowiadającego węzłowi drzewa (w odłączonym
+ * poddrzewie – długość liczoną od jego korzenia).
+ * @param[in] ctx  – wskaźnik na pule pamięci;
+ * @param[in] node – indeks węzła drzewa.
+ * @return Suma długości etykiet na ścieżce od korzenia do węzła @p node.
+ */
+static size_t nodeDepth(TrieContext const *ctx, PoolIndex node) {
+    size_t depth = 0;
+
+    for (PoolIndex current = node; current != POOL_NULL;
+         current = nodeAt(ctx, current)->parent)
+        depth += labelLength(nodeAt(ctx, current)->label);
+
+    return depth;
+}
+
+/**
+ * Porównuje wpisy dziennika tak, aby odłączenia poddrzew znalazły się na
+ * początku, uporządkowane według długości numerów ojców odłączonych
+ * węzłów, a odłączenia od tego samego ojca sąsiadowały ze sobą.
+ * @param[in] a – wskaźnik na pierwszy wpis;
+ * @param[in] b – wskaźnik na drugi wpis.
+ * @return Wartość ujemna, zero lub wartość dodatnia, jeśli wpis @p a
+ *         powinien znaleźć się odpowiednio przed wpisem @p b, w dowolnym
+ *         miejscu względem niego lub po nim.
+ */
+static int compareDetach(void const *a, void const *b) {
+    JournalEntry const *x = a;
+    JournalEntry const *y = b;
+    bool xDetach = x->kind == JOURNAL_DETACH;
+    bool yDetach = y->kind == JOURNAL_DETACH;
+
+    if (xDetach != yDetach)
+        return xDetach ? -1 : 1;
+    if (!xDetach)
+        return 0;
+    if (x->depth != y->depth)
+        return x->depth < y->depth ? -1 : 1;
+    return (x->other > y->other) - (x->other < y->other);
+}
+
+void trieCommit(TrieContext *ctx) {
+    JournalEntry *journal = ctx->journal;
+    size_t count = ctx->journalCount;
+
+    ctx->transaction = false;
+    ctx->journalCount = 0;
+    epochReserve(ctx->epoch, 0);
+
+    // zastąpione przekierowania nie wrócą, więc anulujemy rezerwacje i usuwamy
+    // węzły drzewa odwrotności przekierowań, które pozostały puste; węzły
+    // z kolejnymi rezerwacjami są niepuste, więc nie zostaną usunięte
+    for (size_t k = 0; k < count; ++k) {
+        JournalEntry *entry = &journal[k];
+
+        epochWriteYield(ctx->epoch);
+        if (entry->kind == JOURNAL_DATA && entry->other != POOL_NULL) {
+            cancelReverseFwd(ctx, entry->other, entry->sourceCopy);
+            deleteDeadBranch(ctx, TRIE_REVERSE, entry->other);
+        } else if (entry->kind == JOURNAL_DETACH) {
+            entry->depth = nodeDepth(ctx, entry->other);
+        }
     }
 
-    return result;
-}
\ No newline at end of file
+    // ojcowie odłączonych węzłów mogli stać się zbędni; usunięcie martwej
+    // gałęzi zwalnia jedynie węzeł i jego przodków, więc przy ojcach
+    // uporządkowanych według długości numerów żaden nie zostanie zwolniony
+    // przed jego przetworzeniem
+    if (count > 0)
+        qsort(journal, count, sizeof(JournalEntry), compareDetach);
+    for (size_t k = 0; k < count && journal[k].kind == JOURNAL_DETACH; ++k) {
+        epochWriteYield(ctx->epoch);
+        if (k == 0 || journal[k].other != journal[k - 1].other)
+            deleteDeadBranch(ctx, TRIE_FORWARD, journal[k].other);
+    }
+}
+
+void trieRollback(TrieContext *ctx) {
+    trieJournalUndo(ctx, 0);
+    ctx->transaction = false;
+}
+
+PoolIndex getFwdNode(TrieContext const *ctx, PoolIndex node) {
+    return __atomic_load_n(&nodeAt(ctx, node)->fwdNode, __ATOMIC_ACQUIRE);
+}
+
+char const *getFwdNumber(TrieContext const *ctx, PoolIndex node) {
+    PoolIndex reverse = getFwdNode(ctx, node);
+
+    if (reverse == POOL_NULL)
+        return NULL;
+
+    // współbieżny pisarz mógł w międzyczasie usunąć przekierowanie
+    SourceArray const *array = getSources(ctx, reverse);
+    return array == NULL ? NULL : sourceArrayTarget(array);
+}
+
+SourceArray const *getSources(TrieContext const *ctx, PoolIndex node) {
+    return __atomic_load_n(&nodeAt(ctx, node)->sources, __ATOMIC_ACQUIRE);
+}
+
+PoolIndex getChild(TrieContext const *ctx, PoolIndex node,
+                   unsigned int digit) {
+    return childAt(nodeAt(ctx, node), digit);
+}
+
+uint32_t getLabel(TrieContext const *ctx, PoolIndex node) {
+    return labelOf(nodeAt(ctx, node));
+}
@@ -11,13 +11,24 @@
 #define TRIE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-#include "list.h"
+#include "epoch.h"
+#include "number_functions.h"
+#include "phone_forward.h"
+#include "pool.h"
+#include "source_array.h"
+#include "stats.h"
+#include "string_pool.h"
 
 /**
- * Struktura reprezentująca węzeł drzewa trie. Przechowuje wskaźnik do
- * innego obiektu typu @p TrieNode oraz wskaźnik do obiektu typu @p ListNode.
- * Opisy zastosowań tych wskaźników znajdują się w pliku trie.c.
+ * Struktura reprezentująca węzeł drzewa trie. W drzewie przekierowań
+ * przechowuje indeks węzła drzewa odwrotności przekierowań, a w nim tablicę
+ * typu @p SourceArray. Opisy zastosowań tych danych znajdują się w pliku
+ * trie.c. Węzły przydzielane
+ * są z puli pamięci i poza plikiem trie.c identyfikowane są wyłącznie przez
+ * swoje indeksy w tej puli (wartość @ref POOL_NULL oznacza brak węzła).
  */
 struct TrieNode;
 
@@ -27,131 +38,544 @@ struct TrieNode;
 typedef struct TrieNode TrieNode;
 
 /**
- * Tworzy nowy, pusty węzeł drzewa.
- * @return Wskaźnik na utworzoną strukturę lub NULL, jeśli nie udało się
+ * Wyznacza liczbę cyfr etykiety krawędzi drzewa (kodowanie etykiet opisane
+ * jest w pliku trie.c).
+ * @param[in] label – etykieta.
+ * @return Liczba cyfr etykiety.
+ */
+static inline unsigned int labelLength(uint32_t label) {
+    return label & 0xF;
+}
+
+/**
+ * Wyznacza cyfrę etykiety.
+ * @param[in] label – etykieta;
+ * @param[in] k     – numer cyfry, mniejszy niż długość etykiety.
+ * @return Wartość @p k-tej cyfry etykiety.
+ */
+static inline unsigned int labelDigit(uint32_t label, unsigned int k) {
+    return (label >> (4 + 4 * k)) & 0xF;
+}
+
+/**
+ * Wyznacza długość najdłuższego wspólnego prefiksu etykiety i numeru.
+ * @param[in] label – etykieta;
+ * @param[in] num   – wskaźnik na napis reprezentujący numer.
+ * @return Liczba początkowych cyfr etykiety zgodnych z kolejnymi cyframi
+ *         @p num.
+ */
+static inline unsigned int labelMatch(uint32_t label, char const *num) {
+    unsigned int length = labelLength(label);
+    unsigned int k = 0;
+
+    while (k < length && num[k] != '\0' &&
+           labelDigit(label, k) == charToDigit(num[k]))
+        ++k;
+
+    return k;
+}
+
+/**
+ * Rodzaj drzewa, do którego należy węzeł. Węzły obu drzew przydzielane są
+ * z tej samej puli, więc funkcje tworzące i usuwające węzły otrzymują rodzaj
+ * drzewa, aby zliczać jego rozmiar i kształt.
+ */
+typedef enum TrieKind {
+    TRIE_FORWARD, ///< drzewo przekierowań
+    TRIE_REVERSE, ///< drzewo odwrotności przekierowań
+    TRIE_KINDS ///< liczba rodzajów drzew
+} TrieKind;
+
+/**
+ * Rozmiar i kształt drzewa aktualizowane przy każdej jego modyfikacji.
+ */
+typedef struct TrieShape {
+    size_t nodes; ///< liczba węzłów drzewa wraz z korzeniem
+    size_t dataNodes; ///< liczba niepustych węzłów drzewa
+    /** liczby węzłów o danej liczbie synów */
+    size_t fanOut[PHFWD_FANOUT_BUCKETS];
+    /** liczby niepustych węzłów odpowiadających numerom o danej długości */
+    size_t depth[PHFWD_DEPTH_BUCKETS];
+} TrieShape;
+
+/**
+ * Struktura reprezentująca wpis dziennika zmian drzew. Opis dziennika
+ * znajduje się w pliku trie.c.
+ */
+struct JournalEntry;
+
+/**
+ * Typ @p JournalEntry reprezentuje strukturę @p JournalEntry.
+ */
+typedef struct JournalEntry JournalEntry;
+
+/**
+ * Liczba grup, na które dzielone są odłączone poddrzewa drzewa przekierowań
+ * według pierwszej cyfry lub pierwszych dwóch cyfr numeru ich korzenia.
+ */
+#define TRIE_DETACHED_GROUPS (12 + 12 * 12)
+
+/**
+ * Korzeń poddrzewa odłączonego od drzewa przekierowań.
+ */
+typedef struct DetachedRoot {
+    PoolIndex node; ///< indeks korzenia poddrzewa
+    uint32_t group; /**< grupa wyznaczona przez początek numeru, który
+                    przekazano funkcji @ref trieRemove */
+} DetachedRoot;
+
+/**
+ * Struktura przechowująca pule pamięci, z których przydzielane są węzły drzewa
+ * przekierowań i drzewa odwrotności przekierowań jednej struktury PhoneForward
+ * oraz napisy przechowywane w tablicach numerów w ich węzłach.
+ * Wszystkie funkcje modyfikujące drzewa przyjmują wskaźnik na tę strukturę.
+ * Jeśli struktura @p epoch istnieje, usuwane obiekty nie są zwalniane od
+ * razu, tylko gdy nie może ich już odczytywać żaden współbieżny czytelnik.
+ * Struktura zlicza ponadto obiekty obu drzew, tak aby raport funkcji
+ * @ref phfwdMemoryUsage można było wyznaczyć w czasie stałym, oraz
+ * przechowuje poddrzewa odłączone od drzewa przekierowań przez funkcję
+ * @ref trieRemove, których węzły zwalnia stopniowo funkcja
+ * @ref trieReclaim. Zmiany drzew zapisywane są w dzienniku, dzięki czemu
+ * przerwaną modyfikację lub całą transakcję można wycofać bez alokowania
+ * pamięci.
+ */
+typedef struct TrieContext {
+    Pool *nodePool; ///< pula węzłów drzew
+    StringPool *stringPool; /**< pula tablic numerów i przechowywanych
+                            w nich napisów */
+    Epoch *epoch; /**< struktura odraczająca zwalnianie obiektów lub NULL,
+                  jeśli drzewa nie są odczytywane współbieżnie */
+    TrieShape shape[TRIE_KINDS]; ///< rozmiar i kształt obu drzew
+    size_t strings; ///< liczba napisów przechowywanych w tablicach
+    size_t stringBytes; ///< pamięć zajmowana przez te napisy
+    size_t arrayBytes; ///< pamięć zajmowana przez tablice numerów
+    size_t *lengthCounts; /**< tablica, której @p k-ty element jest liczbą
+                          tablic numerów o długości @p k, lub NULL */
+    size_t lengthCountsSize; ///< rozmiar tablicy @p lengthCounts
+    size_t longestArray; ///< długość najdłuższej tablicy numerów
+    DetachedRoot *detached; /**< stos korzeni odłączonych poddrzew drzewa
+                            przekierowań, których węzły nie zostały jeszcze
+                            zwolnione, lub NULL */
+    size_t detachedCount; /**< liczba odłączonych poddrzew, odczytywana
+                          przez współbieżnych czytelników */
+    size_t detachedSize; ///< rozmiar tablicy @p detached
+    /** liczby odłączonych poddrzew w poszczególnych grupach, odczytywane
+        przez współbieżnych czytelników; numer należy do poddrzewa tylko
+        wtedy, gdy jego grupa jest niepusta */
+    uint32_t detachedGroups[TRIE_DETACHED_GROUPS];
+    PoolIndex reclaimCursor; /**< węzeł poddrzewa na szczycie stosu
+                             @p detached, od którego funkcja
+                             @ref trieReclaim wznowi zwalnianie, lub
+                             @ref POOL_NULL, jeśli należy zacząć od jego
+                             korzenia */
+    JournalEntry *journal; ///< dziennik zmian drzew lub NULL
+    size_t journalCount; ///< liczba wpisów dziennika
+    size_t journalSize; ///< rozmiar tablicy @p journal
+    bool transaction; /**< czy trwa transakcja rozpoczęta funkcją
+                      @ref trieBegin */
+#ifdef PHFWD_STATS
+    PhfwdStats *stats; /**< liczniki operacji, które należy ustawić przed
+                       pierwszym użyciem pul */
+#endif
+} TrieContext;
+
+/**
+ * Inicjalizuje pule pamięci struktury @p ctx. Obiekty są początkowo
+ * zwalniane natychmiast (pole @p epoch ma wartość NULL).
+ * @param[out] ctx – wskaźnik na inicjalizowaną strukturę.
+ * @return Wartość @p true, jeśli inicjalizacja się powiodła.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+bool trieContextInit(TrieContext *ctx);
+
+/** @brief Zwalnia pule pamięci.
+ * Zwalnia pule pamięci struktury @p ctx, a tym samym wszystkie węzły drzew,
+ * napisy i tablice numerów z nich przydzielone, w czasie proporcjonalnym do
+ * liczby płyt pul, a nie do liczby węzłów. Wcześniej zwalnia obiekty,
+ * których zwolnienie zostało odroczone.
+ * @param[in, out] ctx – wskaźnik na strukturę.
+ */
+void trieContextDestroy(TrieContext *ctx);
+
+/**
+ * Wypełnia części raportu o pamięci dotyczące drzew, tablic i napisów oraz
+ * pamięci zarezerwowanej przez pule.
+ * @param[in] ctx     – wskaźnik na pule pamięci;
+ * @param[out] report – wskaźnik na wypełniany raport.
+ */
+void trieMemoryUsage(TrieContext const *ctx, PhfwdMemoryReport *report);
+
+/**
+ * Tworzy nowy, pusty węzeł drzewa. Węzeł nie jest dołączany do żadnego
+ * drzewa, ale jest wliczany do rozmiaru drzewa rodzaju @p kind.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] kind     – rodzaj drzewa, do którego zostanie dołączony węzeł.
+ * @return Indeks utworzonego węzła lub @ref POOL_NULL, jeśli nie udało się
  *         alokować pamięci.
  */
-TrieNode *trieNew(void);
+PoolIndex trieNew(TrieContext *ctx, TrieKind kind);
 
 /** @brief Usuwa martwą gałąź drzewa.
  * Jeśli parametr @p node jest liściem drzewa, to usuwa maksymalną gałąź
  * składającą się z pustych węzłów zawierającą @p node za wyjątkiem korzenia.
- * W szczególności jeśli @p node jest niepusty, to nie usuwa nic.
- * @param[in, out] node – wskaźnik na węzeł drzewa.
+ * W szczególności jeśli @p node jest niepusty, to nie usuwa nic. Jeśli
+ * pierwszy nieusunięty węzeł jest pusty i ma jednego syna, to zostaje scalony
+ * z tym synem (o ile zmieszczą się ich etykiety), więc w drzewie nie
+ * pozostają zbędne węzły pośrednie.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] kind     – rodzaj drzewa, do którego należy @p node;
+ * @param[in] node     – indeks węzła drzewa.
  */
-void deleteDeadBranch(TrieNode *node);
+void deleteDeadBranch(TrieContext *ctx, TrieKind kind, PoolIndex node);
 
 /** @brief Dodaje nowy element do drzewa.
  * Jeśli w drzewie o korzeniu @p t znajduje się węzeł odpowiadający numerowi
  * @p num, to nie modyfikuje drzewa. W przeciwnym wypadku dodaje do @p t
- * nowy węzeł odpowiadający numerowi @p num.
- * @param[in, out] t – wskaźnik na korzeń drzewa;
- * @param[in] num    – wskaźnik na napis reprezentujący numer.
- * @return Wskaźnik na węzeł drzewa odpowiadający numerowi @p num lub NULL,
- *         jeśli nie udało się alokować pamięci.
+ * nowy węzeł odpowiadający numerowi @p num. Utworzone węzły zapisuje
+ * w dzienniku, więc można je usunąć funkcją @ref trieJournalUndo.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] kind     – rodzaj drzewa @p t;
+ * @param[in] t        – indeks korzenia drzewa;
+ * @param[in] num      – wskaźnik na napis reprezentujący numer.
+ * @return Indeks węzła drzewa odpowiadającego numerowi @p num lub
+ *         @ref POOL_NULL, jeśli nie udało się alokować pamięci (wówczas
+ *         drzewo nie zostaje zmienione).
  */
-TrieNode *trieAdd(TrieNode *t, char const *num);
+PoolIndex trieAdd(TrieContext *ctx, TrieKind kind, PoolIndex t,
+                  char const *num);
+
+/** @brief Dodaje nowy element do drzewa, zaczynając od pobliskiego węzła.
+ * Działa tak jak funkcja @ref trieAdd, ale zamiast od korzenia zaczyna
+ * schodzić od najgłębszego przodka węzła @p hint, któremu odpowiada wspólny
+ * prefiks numerów @p hintNum i @p num. Przy dodawaniu numerów w porządku
+ * leksykograficznym pomija to wspólne początki kolejnych zejść.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] kind     – rodzaj drzewa @p t;
+ * @param[in] t        – indeks korzenia drzewa;
+ * @param[in] hint     – indeks węzła drzewa @p t odpowiadającego numerowi
+ *                       @p hintNum lub @ref POOL_NULL;
+ * @param[in] hintNum  – wskaźnik na napis reprezentujący numer (nieużywany,
+ *                       jeśli @p hint ma wartość @ref POOL_NULL);
+ * @param[in] num      – wskaźnik na napis reprezentujący numer.
+ * @return Indeks węzła drzewa odpowiadającego numerowi @p num lub
+ *         @ref POOL_NULL, jeśli nie udało się alokować pamięci.
+ */
+PoolIndex trieAddNear(TrieContext *ctx, TrieKind kind, PoolIndex t,
+                      PoolIndex hint, char const *hintNum, char const *num);
 
 /** @brief Usuwa dane w węźle drzewa przekierowań.
  * Usuwa dane przechowane w węźle drzewa przekierowań oraz odpowiadający
- * mu element w liście w drzewie odwrotności przekierowań (i w razie potrzeby
- * również nieużywane węzły w tym drzewie).
- * @param[in, out] node – wskaźnik na węzeł drzewa przekierowań.
+ * mu element tablicy w drzewie odwrotności przekierowań wraz z jego
+ * napisem (i w razie potrzeby również tablicę i nieużywane węzły w tym
+ * drzewie, chyba że trwa transakcja).
+ * @param[in, out] ctx  – wskaźnik na pule pamięci;
+ * @param[in] node     – indeks węzła drzewa przekierowań.
  */
-void deleteFwdData(TrieNode *node);
+void deleteFwdData(TrieContext *ctx, PoolIndex node);
 
 /** @brief Usuwa poddrzewo drzewa przekierowań.
  * Usuwa poddrzewo węzła @p node (włącznie z tym węzłem) drzewa przekierowań
- * usuwając przy tym odpowiednie elementy list w drzewie odwrotności
+ * usuwając przy tym odpowiednie elementy tablic w drzewie odwrotności
  * przekierowań i nieużywane po tej operacji węzły tego drzewa.
- * @param[in, out] node – wskaźnik na węzeł drzewa przekierowań.
+ * @param[in, out] ctx  – wskaźnik na pule pamięci;
+ * @param[in] node     – indeks węzła drzewa przekierowań.
  */
-void trieDelete(TrieNode *node);
+void trieDelete(TrieContext *ctx, PoolIndex node);
 
 /** Znajduje węzeł drzewa odpowiadający numerowi.
- * Znajduje węzeł drzewa o korzeniu @p t odpowiadający numerowi @p num.
- * @param[in] t   – wskaźnik na korzeń drzewa;
+ * Znajduje węzeł drzewa o korzeniu @p t odpowiadający numerowi @p num. Jeśli
+ * numer kończy się w środku etykiety krawędzi drzewa skompresowanego, to
+ * znajduje węzeł, do którego prowadzi ta krawędź (jego poddrzewo odpowiada
+ * wtedy dokładnie numerom, których prefiksem jest @p num).
+ * @param[in] ctx – wskaźnik na pule pamięci;
+ * @param[in] t   – indeks korzenia drzewa;
  * @param[in] num – wskaźnik na napis reprezentujący numer.
- * @return Węzeł drzewa @p t odpowiadający numerowi @p num lub NULL, jeśli
- *         taki nie istnieje.
+ * @return Indeks węzła drzewa @p t odpowiadającego numerowi @p num lub
+ *         @ref POOL_NULL, jeśli taki nie istnieje.
  */
-TrieNode *trieFind(TrieNode *t, char const *num);
+PoolIndex trieFind(TrieContext const *ctx, PoolIndex t, char const *num);
 
 /** @brief Znajduje pierwszy niepusty węzeł odpowiadający fragmentowi numeru.
  * Znajduje pierwszy niepusty węzeł (tzn. taki, w którym jeden
- * z przechowywanych wskaźników jest różny od NULL) odpowiadający prefiksowi
+ * z przechowywanych indeksów jest różny od @ref POOL_NULL) odpowiadający
+ * prefiksowi
  * sufiksu numeru @p num od pozycji @p *currIndex poczynając od @p node
  * (jeśli @p node jest niepusty, to go nie wliczamy). Wartość @p *currIndex
  * jest przy tym odpowiednio zmieniana na indeks, dla którego znaleziono
  * niepusty węzeł.
- * @param[in] node           – wskaźnik na węzeł drzewa;
+ * @param[in] ctx            – wskaźnik na pule pamięci;
+ * @param[in] node           – indeks węzła drzewa;
  * @param[in] num            – wskaźnik na napis reprezentujący numer.
  * @param[in, out] currIndex – wskaźnik na aktualny indeks @p num
- * @return Znaleziony węzeł lub NULL, jeśli taki nie istnieje.
+ * @return Indeks znalezionego węzła lub @ref POOL_NULL, jeśli taki nie
+ *         istnieje.
+ */
+PoolIndex trieFindNextNonEmpty(TrieContext const *ctx, PoolIndex node,
+                               char const *num, size_t *currIndex);
+
+/** @brief Znajduje najdłuższe niepuste prefiksy wielu numerów.
+ * Dla każdego numeru @p nums[k] znajduje najgłębszy niepusty węzeł drzewa
+ * o korzeniu @p t odpowiadający prefiksowi tego numeru i zapisuje jego indeks
+ * w @p nodes[k], a długość tego prefiksu w @p indices[k]. Jeśli taki węzeł
+ * nie istnieje, zapisuje odpowiednio @p t i zero. Wynik jest taki sam, jak
+ * przy wielokrotnym wywołaniu funkcji @ref trieFindNextNonEmpty, ale zejścia
+ * w drzewie dla kilku numerów przeplatają się, a węzeł potrzebny w kolejnym
+ * kroku danego zejścia jest z wyprzedzeniem pobierany do pamięci podręcznej,
+ * dzięki czemu opóźnienia dostępu do pamięci nakładają się na siebie.
+ * @param[in] ctx      – wskaźnik na pule pamięci;
+ * @param[in] t        – indeks korzenia drzewa;
+ * @param[in] nums     – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count    – liczba numerów;
+ * @param[out] nodes   – tablica o rozmiarze @p count na indeksy węzłów;
+ * @param[out] indices – tablica o rozmiarze @p count na długości prefiksów.
  */
-TrieNode *trieFindNextNonEmpty(TrieNode *node, char const *num,
-                               size_t *currIndex);
+void trieFindLongestBatch(TrieContext const *ctx, PoolIndex t,
+                          char const *const *nums, size_t count,
+                          PoolIndex *nodes, size_t *indices);
 
 /** @brief Usuwa węzły z drzewa przekierowań.
  * Usuwa wszystkie węzły z drzewa @p t, które odpowiadają numerom, który @p
- * num jest prefiksem. Usuwa przy tym odpowiednie elementy list w drzewie
- * odwrotności przekierowań i nieużywane po tej operacji węzły tego drzewa.
- * @param[in, out] t – wskaźnik na korzeń drzewa przekierowań;
- * @param[in] num    – wskaźnik na napis reprezentujący numer.
+ * num jest prefiksem. Węzeł bez synów jest usuwany od razu wraz
+ * z odpowiednim elementem tablicy w drzewie odwrotności przekierowań.
+ * Większe poddrzewo jest jedynie odłączane od drzewa w czasie
+ * proporcjonalnym do długości @p num, a jego węzły i elementy tablic
+ * zwalnia później funkcja @ref trieReclaim. Do tego czasu elementy tablic
+ * odwołujące się do jego węzłów pozostają w drzewie odwrotności
+ * przekierowań i należy je pomijać (funkcja @ref trieIsDetached). Jeśli nie
+ * uda się alokować pamięci na zapamiętanie poddrzewa, jest ono usuwane od
+ * razu. W trakcie transakcji każde poddrzewo jest tylko odłączane, a puste
+ * węzły, które pozostały po nim w drzewie, usuwa dopiero funkcja
+ * @ref trieCommit, tak aby odłączenie można było wycofać.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] t        – indeks korzenia drzewa przekierowań;
+ * @param[in] num      – wskaźnik na napis reprezentujący numer.
+ * @return Wartość @p true, jeśli węzły zostały usunięte lub w drzewie nie
+ *         ma węzłów odpowiadających numerom o prefiksie @p num.
+ *         Wartość @p false, jeśli w trakcie transakcji nie udało się
+ *         alokować pamięci (wówczas drzewo nie zostaje zmienione).
+ */
+bool trieRemove(TrieContext *ctx, PoolIndex t, char const *num);
+
+/** @brief Zwalnia węzły odłączonych poddrzew.
+ * Zwalnia węzły poddrzew odłączonych przez funkcję @ref trieRemove
+ * w porządku postorder (od liści), więc przodkowie każdego niezwolnionego
+ * węzła pozostają w pamięci. Wykonuje co najwyżej @p budget kroków, z których
+ * każdy przechodzi do syna węzła albo zwalnia węzeł, więc poddrzewo
+ * o @p n węzłach wymaga co najwyżej 2 @p n kroków. W trakcie transakcji
+ * nie zwalnia niczego, bo odłączenie poddrzew może zostać wycofane. Nie
+ * alokuje pamięci.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] budget   – największa liczba kroków.
+ * @return Wartość @p true, jeśli wszystkie odłączone poddrzewa zostały
+ *         zwolnione.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+bool trieReclaim(TrieContext *ctx, size_t budget);
+
+/** @brief Sprawdza, czy węzeł należy do odłączonego poddrzewa.
+ * Sprawdza, czy węzeł drzewa przekierowań należy do poddrzewa odłączonego
+ * przez funkcję @ref trieRemove. Numer @p source należy do odłączonego
+ * poddrzewa tylko wtedy, gdy zaczyna się tak jak numer jego korzenia, więc
+ * jeśli żadne odłączone poddrzewo nie ma korzenia o tej samej pierwszej
+ * cyfrze lub tych samych pierwszych dwóch cyfrach, to funkcja działa
+ * w czasie stałym, nie odczytując drzewa. W przeciwnym przypadku wspina
+ * się po wskaźnikach na ojca do korzenia, co wymaga czasu proporcjonalnego
+ * do głębokości węzła.
+ * @param[in] ctx    – wskaźnik na pule pamięci;
+ * @param[in] t      – indeks korzenia drzewa przekierowań;
+ * @param[in] node   – indeks niezwolnionego węzła drzewa przekierowań;
+ * @param[in] source – wskaźnik na napis reprezentujący numer węzła @p node.
+ * @return Wartość @p true, jeśli węzeł nie należy już do drzewa @p t.
+ *         Wartość @p false w przeciwnym przypadku.
  */
-void trieRemove(TrieNode *t, char const *num);
+bool trieIsDetached(TrieContext const *ctx, PoolIndex t, PoolIndex node,
+                    char const *source);
 
 /**
- * Dodaje element do listy w węźle drzewa odwrotności przekierowań.
- * @param[in, out] node – wskaźnik na węzeł odwrotności drzewa przekierowań.
- * @param[in] nodeToAdd – wskaźnik na węzeł, który ma być dodany do listy.
- * @return Wartość @p true, jeśli element został dodany.
- *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ * Sprawdza, czy istnieją poddrzewa odłączone przez funkcję
+ * @ref trieRemove, których węzły nie zostały jeszcze zwolnione.
+ * @param[in] ctx – wskaźnik na pule pamięci.
+ * @return Wartość @p true, jeśli takie poddrzewa istnieją.
+ *         Wartość @p false w przeciwnym przypadku.
  */
-bool addToReverseFwdList(TrieNode *node, TrieNode *nodeToAdd);
+bool trieHasDetached(TrieContext const *ctx);
+
+/**
+ * Sprawdza, czy węzeł drzewa nie ma synów.
+ * @param[in] ctx  – wskaźnik na pule pamięci;
+ * @param[in] node – indeks węzła drzewa.
+ * @return Wartość @p true, jeśli węzeł @p node jest liściem.
+ *         Wartość @p false w przeciwnym przypadku.
+ */
+bool trieIsLeaf(TrieContext const *ctx, PoolIndex node);
+
+/** @brief Rezerwuje miejsce na przekierowanie w drzewie odwrotności.
+ * Rezerwuje w tablicy numerów węzła @p node miejsce na element, który
+ * zostanie dodany funkcją @ref setFwdData, w razie potrzeby tworząc lub
+ * powiększając tablicę, i kopiuje numer @p source. Po udanej rezerwacji
+ * węzeł @p node jest niepusty, a dodanie elementu nie wymaga już
+ * alokowania pamięci.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] node     – indeks węzła drzewa odwrotności przekierowań;
+ * @param[in] source   – wskaźnik na napis reprezentujący numer
+ *                       przekierowywany na numer węzła @p node;
+ * @param[in] target   – wskaźnik na napis reprezentujący numer
+ *                       odpowiadający węzłowi @p node.
+ * @return Wskaźnik na kopię numeru @p source lub NULL, jeśli nie udało się
+ *         alokować pamięci (wówczas nic nie zostaje zarezerwowane).
+ */
+char *reserveReverseFwd(TrieContext *ctx, PoolIndex node,
+                        char const *source, char const *target);
+
+/** @brief Anuluje rezerwację miejsca na przekierowanie.
+ * Anuluje rezerwację dokonaną funkcją @ref reserveReverseFwd i zwalnia
+ * kopię numeru, a jeśli tablica numerów węzła @p node nie jest już
+ * używana, to również tablicę. Nie usuwa nieużywanych węzłów drzewa.
+ * @param[in, out] ctx   – wskaźnik na pule pamięci;
+ * @param[in] node       – indeks węzła drzewa odwrotności przekierowań;
+ * @param[in] sourceCopy – kopia numeru zwrócona przez funkcję
+ *                         @ref reserveReverseFwd.
+ */
+void cancelReverseFwd(TrieContext *ctx, PoolIndex node, char *sourceCopy);
+
+/** @brief Przekierowuje węzeł drzewa przekierowań.
+ * Usuwa dotychczasowe przekierowanie węzła @p node funkcją
+ * @ref deleteFwdData i przekierowuje go na węzeł @p reverse, zajmując
+ * miejsce zarezerwowane w jego tablicy numerów. Nie alokuje pamięci.
+ * @param[in, out] ctx   – wskaźnik na pule pamięci;
+ * @param[in] node       – indeks węzła drzewa przekierowań;
+ * @param[in] reverse    – indeks węzła drzewa odwrotności przekierowań;
+ * @param[in] sourceCopy – kopia numeru węzła @p node zwrócona przez
+ *                         funkcję @ref reserveReverseFwd dla węzła
+ *                         @p reverse.
+ */
+void setFwdData(TrieContext *ctx, PoolIndex node, PoolIndex reverse,
+                char *sourceCopy);
+
+/** @brief Zapisuje w dzienniku przekierowanie węzła przed jego zmianą.
+ * W trakcie transakcji zapisuje w dzienniku dotychczasowe przekierowanie
+ * węzła @p node, które zostanie zaraz zastąpione funkcją @ref setFwdData,
+ * i rezerwuje na nie miejsce w tablicy numerów jego węzła drzewa
+ * odwrotności przekierowań, więc przywrócenie go nie wymaga alokowania
+ * pamięci, a węzeł ten nie zostanie do końca transakcji usunięty. Poza
+ * transakcją nic nie robi.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] node     – indeks węzła drzewa przekierowań;
+ * @param[in] source   – wskaźnik na napis reprezentujący numer węzła
+ *                       @p node.
+ * @return Wartość @p true, jeśli przekierowanie zostało zapisane lub nie
+ *         trwa transakcja.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci (wówczas
+ *         nic nie zostaje zapisane).
+ */
+bool trieJournalFwdData(TrieContext *ctx, PoolIndex node, char const *source);
+
+/**
+ * Wyznacza punkt dziennika, do którego można następnie wycofać zmiany
+ * drzew.
+ * @param[in] ctx – wskaźnik na pule pamięci.
+ * @return Liczba wpisów dziennika.
+ */
+size_t trieJournalMark(TrieContext const *ctx);
+
+/** @brief Wycofuje zmiany drzew zapisane w dzienniku.
+ * Wycofuje w odwrotnej kolejności zmiany zapisane w dzienniku po punkcie
+ * @p mark: usuwa utworzone węzły, scala rozdzielone krawędzie, przywraca
+ * przekierowania węzłów i dołącza z powrotem odłączone poddrzewa. Drzewa
+ * wracają do stanu z chwili wyznaczenia punktu @p mark (z dokładnością do
+ * kolejności elementów tablic numerów). Działa w czasie proporcjonalnym do
+ * liczby wycofywanych zmian i nie alokuje pamięci, również na odroczone
+ * zwolnienie usuwanych obiektów, bo miejsce na nie zarezerwowano przy
+ * zapisywaniu wpisów (zob. @ref epochReserve). Rezerwacje funkcji
+ * @ref reserveReverseFwd dokonane po punkcie @p mark należy wcześniej
+ * anulować.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] mark     – punkt dziennika zwrócony przez funkcję
+ *                       @ref trieJournalMark.
+ */
+void trieJournalUndo(TrieContext *ctx, size_t mark);
+
+/**
+ * Kończy udaną modyfikację drzew rozpoczętą w punkcie dziennika @p mark.
+ * Poza transakcją usuwa z dziennika wpisy zapisane po tym punkcie wraz
+ * z zarezerwowanym dla nich miejscem na odroczone zwolnienia, a w trakcie
+ * transakcji nic nie robi.
+ * @param[in, out] ctx – wskaźnik na pule pamięci;
+ * @param[in] mark     – punkt dziennika zwrócony przez funkcję
+ *                       @ref trieJournalMark.
+ */
+void trieJournalRelease(TrieContext *ctx, size_t mark);
+
+/**
+ * Rozpoczyna transakcję: od tej chwili wszystkie zmiany drzew pozostają
+ * w dzienniku do wywołania funkcji @ref trieCommit lub @ref trieRollback.
+ * @param[in, out] ctx – wskaźnik na pule pamięci, w których nie trwa
+ *                       transakcja.
+ */
+void trieBegin(TrieContext *ctx);
+
+/** @brief Zatwierdza transakcję.
+ * Kończy transakcję, zachowując jej zmiany: anuluje rezerwacje potrzebne do
+ * przywrócenia zastąpionych przekierowań, usuwa nieużywane już węzły obu
+ * drzew i pozwala funkcji @ref trieReclaim zwolnić poddrzewa odłączone
+ * w trakcie transakcji. Działa w czasie proporcjonalnym do liczby zmian
+ * transakcji (z dokładnością do czynnika logarytmicznego) i nie alokuje
+ * pamięci, również na odroczone zwolnienie usuwanych obiektów.
+ * @param[in, out] ctx – wskaźnik na pule pamięci, w których trwa
+ *                       transakcja.
+ */
+void trieCommit(TrieContext *ctx);
+
+/**
+ * Kończy transakcję, wycofując wszystkie jej zmiany funkcją
+ * @ref trieJournalUndo. Nie alokuje pamięci.
+ * @param[in, out] ctx – wskaźnik na pule pamięci, w których trwa
+ *                       transakcja.
+ */
+void trieRollback(TrieContext *ctx);
 
 /**
  * Znajduje węzeł, na który przekierowany jest @p node.
- * @param[in] node – wskaźnik na węzeł drzewa przekierowań.
- * @return Wskaźnik na węzeł, na który przekierowany jest @p node.
+ * @param[in] ctx  – wskaźnik na pule pamięci;
+ * @param[in] node – indeks węzła drzewa przekierowań.
+ * @return Indeks węzła, na który przekierowany jest @p node.
  */
-TrieNode *getFwdNode(TrieNode *node);
+PoolIndex getFwdNode(TrieContext const *ctx, PoolIndex node);
 
 /**
- * Ustawia nowy węzeł, na który przekierowany jest @p node.
- * @param[out] node     – wskaźnik na węzeł drzewa przekierowań;
- * @param[in] nodeToAdd – wskaźnik na nowy węzeł, na który przekierowany ma
- *                        być @p node.
+ * Znajduje numer, na który przekierowany jest @p node.
+ * @param[in] ctx  – wskaźnik na pule pamięci;
+ * @param[in] node – indeks węzła drzewa przekierowań.
+ * @return Wskaźnik na napis reprezentujący numer, na który przekierowany jest
+ *         @p node, lub NULL, jeśli węzeł nie jest przekierowany.
  */
-void setFwdNode(TrieNode *node, TrieNode *nodeToAdd);
+char const *getFwdNumber(TrieContext const *ctx, PoolIndex node);
 
 /**
- * Znajduje węzeł listy przechowywany w @p node.
- * @param[in] node – wskaźnik na węzeł drzewa.
- * @return Wskaźnik na węzeł listy przechowywany w @p node.
+ * Znajduje tablicę numerów przekierowanych na numer węzła @p node.
+ * @param[in] ctx  – wskaźnik na pule pamięci;
+ * @param[in] node – indeks węzła drzewa odwrotności przekierowań.
+ * @return Wskaźnik na tablicę numerów lub NULL, jeśli żaden numer nie jest
+ *         przekierowany na numer węzła @p node.
  */
-ListNode *getListNode(TrieNode *node);
+SourceArray const *getSources(TrieContext const *ctx, PoolIndex node);
 
 /**
- * Ustawia nowy węzeł listy przechowywany w @p node.
- * @param[out] node     – wskaźnik na węzeł drzewa;
- * @param[in] nodeToAdd – wskaźnik na węzeł listy.
+ * Znajduje syna węzła @p node odpowiadającego cyfrze @p digit.
+ * @param[in] ctx   – wskaźnik na pule pamięci;
+ * @param[in] node  – indeks węzła drzewa;
+ * @param[in] digit – wartość cyfry.
+ * @return Indeks syna lub @ref POOL_NULL, jeśli taki syn nie istnieje.
  */
-void setListNode(TrieNode *node, ListNode *nodeToAdd);
+PoolIndex getChild(TrieContext const *ctx, PoolIndex node,
+                   unsigned int digit);
 
-/** @brief Zamienia prefiks numeru.
- * Zamienia prefiks numeru @p num złożony z jego pierwszych @p index cyfr
- * na prefiks odpowiadający węzłowi @p newPrefix i zwraca otrzymany numer
- * (nie zmieniając przy tym @p num).
- * @param[in] num           – wskaźnik na numer, którego prefiks ma
- *                            być zastąpiony;
- * @param[in] newPrefixNode – wskaźnik na węzeł drzewa;
- * @param[in] index         – indeks, do którego rozważamy prefiks do
- *                            zastąpienia.
- * @return Wskaźnik na napis z podmienionym prefiksem lub NULL, jeśli nie
- *         udało się alokować pamięci.
+/**
+ * Znajduje etykietę krawędzi prowadzącej do węzła @p node.
+ * @param[in] ctx  – wskaźnik na pule pamięci;
+ * @param[in] node – indeks węzła drzewa.
+ * @return Etykieta krawędzi prowadzącej od ojca do węzła @p node.
  */
-char *changePrefix(char const *num, TrieNode *newPrefixNode,
-                   size_t index);
+uint32_t getLabel(TrieContext const *ctx, PoolIndex node);
 
 #endif /* TRIE_H */